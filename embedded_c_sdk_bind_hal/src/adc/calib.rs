@@ -0,0 +1,186 @@
+use crate::ll_api::ll_cmd::*;
+
+const ADC_FULL_SCALE: u32 = 4095;
+
+/// Calibration data of the ADC, converts raw samples to millivolts and degrees in fixed point.
+///
+/// `vdda_mv()` measures the supply from a `AdcInput::Vref` sample, the converters take the
+/// supply so the results do not depend on the exact supply voltage.
+#[repr(C)]
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub struct AdcCalibration {
+    /// Offset found by the last calibration, added to raw samples.
+    pub offset: i32,
+    /// Nominal voltage of the internal reference.
+    pub vrefint_mv: u32,
+    /// Temperature sensor voltage at `ts_ref_c`.
+    pub ts_ref_mv: i32,
+    /// Temperature of the factory sensor point.
+    pub ts_ref_c: i32,
+    /// Temperature sensor voltage change per degree, in uV.
+    pub ts_slope_uv: i32,
+}
+
+impl AdcCalibration {
+    /// Reads the calibration data, the ADC must have been initialized (and so calibrated) by one
+    /// of the ADC drivers.
+    pub fn read() -> Result<Self, i32> {
+        let mut cal = AdcCalibration {
+            offset: 0,
+            vrefint_mv: 0,
+            ts_ref_mv: 0,
+            ts_ref_c: 0,
+            ts_slope_uv: 0,
+        };
+        let result = ll_invoke_inner!(
+            INVOKE_ID_ADC_GET_CALIBRATION,
+            &mut cal as *mut AdcCalibration
+        );
+        if result == 0 {
+            Ok(cal)
+        } else {
+            Err(result)
+        }
+    }
+
+    /// Applies the calibration offset to a raw sample.
+    pub fn corrected(&self, raw: u16) -> u16 {
+        (raw as i32 + self.offset).clamp(0, ADC_FULL_SCALE as i32) as u16
+    }
+
+    /// Returns the supply (reference) voltage in mV measured from a raw `Vref` sample, 0 for a
+    /// zero sample.
+    pub fn vdda_mv(&self, raw_vref: u16) -> u32 {
+        let vref = self.corrected(raw_vref) as u32;
+        if vref == 0 {
+            return 0;
+        }
+        (self.vrefint_mv * ADC_FULL_SCALE + vref / 2) / vref
+    }
+
+    /// Converts raw samples to mV.
+    ///
+    /// # Arguments
+    /// * `raw` - Raw samples of one input.
+    /// * `vdda_mv` - Supply voltage, see `vdda_mv()`.
+    /// * `out` - Receives `min(raw.len(), out.len())` results.
+    ///
+    /// # Returns
+    /// The number of converted samples.
+    pub fn to_mv(&self, raw: &[u16], vdda_mv: u32, out: &mut [u16]) -> usize {
+        let scale = self.mv_scale(vdda_mv);
+        let len = raw.len().min(out.len());
+        for (mv, raw) in out[..len].iter_mut().zip(raw) {
+            *mv = ((self.corrected(*raw) as u32 * scale + 0x8000) >> 16) as u16;
+        }
+        len
+    }
+
+    /// Converts raw temperature sensor samples to hundredths of a degree Celsius.
+    ///
+    /// # Arguments
+    /// * `raw` - Raw samples of `AdcInput::Temp`.
+    /// * `vdda_mv` - Supply voltage, see `vdda_mv()`.
+    /// * `out` - Receives `min(raw.len(), out.len())` results.
+    ///
+    /// # Returns
+    /// The number of converted samples.
+    pub fn to_centi_celsius(&self, raw: &[u16], vdda_mv: u32, out: &mut [i16]) -> usize {
+        let scale = self.mv_scale(vdda_mv);
+        //Q8 hundredths of a degree per mV
+        let per_mv = if self.ts_slope_uv == 0 {
+            0
+        } else {
+            (100_000 << 8) / self.ts_slope_uv
+        };
+        let ref_q16 = self.ts_ref_mv << 16;
+        let ref_c100 = self.ts_ref_c * 100;
+
+        let len = raw.len().min(out.len());
+        for (c100, raw) in out[..len].iter_mut().zip(raw) {
+            //mV in Q16 down to Q4 keeps the product in 32 bits
+            let diff = ((self.corrected(*raw) as u32 * scale) as i32 - ref_q16) >> 12;
+            let val = ref_c100 + ((diff * per_mv + (1 << 11)) >> 12);
+            *c100 = val.clamp(i16::MIN as i32, i16::MAX as i32) as i16;
+        }
+        len
+    }
+
+    /// mV per LSB in Q16, one division per buffer.
+    fn mv_scale(&self, vdda_mv: u32) -> u32 {
+        ((vdda_mv << 16) + ADC_FULL_SCALE / 2) / ADC_FULL_SCALE
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    const CAL: AdcCalibration = AdcCalibration {
+        offset: -3,
+        vrefint_mv: 1200,
+        ts_ref_mv: 1430,
+        ts_ref_c: 25,
+        ts_slope_uv: -4300,
+    };
+
+    #[test]
+    fn offset_and_vdda() {
+        assert_eq!(CAL.corrected(0), 0);
+        assert_eq!(CAL.corrected(100), 97);
+        assert_eq!(CAL.corrected(4095), 4092);
+        assert_eq!(CAL.vdda_mv(3), 0);
+
+        //1200 mV reference read at 3.3 V: 1489.09 + 3
+        assert_eq!(CAL.vdda_mv(1492), 3300);
+        assert_eq!(CAL.vdda_mv(1365 + 3), 3600);
+    }
+
+    #[test]
+    fn mv_against_reference() {
+        let raw: [u16; 6] = [3, 500, 1000, 2048, 3000, 4095];
+        let mut out = [0_u16; 6];
+        for vdda in [2500_u32, 3300, 3600] {
+            assert_eq!(CAL.to_mv(&raw, vdda, &mut out), raw.len());
+            for (raw, mv) in raw.iter().zip(out) {
+                let expect = CAL.corrected(*raw) as f64 * vdda as f64 / 4095.0;
+                assert!(
+                    (mv as f64 - expect).abs() <= 1.0,
+                    "{} {} {}",
+                    raw,
+                    mv,
+                    expect
+                );
+            }
+        }
+
+        let mut short = [0_u16; 2];
+        assert_eq!(CAL.to_mv(&raw, 3300, &mut short), 2);
+    }
+
+    #[test]
+    fn celsius_against_reference() {
+        let vdda = 3300_u32;
+        //sensor voltages from -40 to 125 degC
+        let mut raw = [0_u16; 12];
+        for (idx, raw) in raw.iter_mut().enumerate() {
+            let temp = -40.0 + idx as f64 * 15.0;
+            let mv = 1430.0 - 4.3 * (temp - 25.0);
+            *raw = (mv * 4095.0 / vdda as f64 + 3.0).round() as u16;
+        }
+
+        let mut out = [0_i16; 12];
+        assert_eq!(CAL.to_centi_celsius(&raw, vdda, &mut out), raw.len());
+        for (raw, c100) in raw.iter().zip(out) {
+            let mv = CAL.corrected(*raw) as f64 * vdda as f64 / 4095.0;
+            let expect = (25.0 - (mv - 1430.0) / 4.3) * 100.0;
+            assert!(
+                (c100 as f64 - expect).abs() <= 3.0,
+                "{} {} {}",
+                raw,
+                c100,
+                expect
+            );
+        }
+    }
+}
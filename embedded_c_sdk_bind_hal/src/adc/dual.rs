@@ -0,0 +1,180 @@
+use super::{scan::ScanAdc, AdcInput, AdcSampleTime};
+use crate::dma::{
+    Config, Dma, DmaBlock, DmaDataSize, DmaDir, DmaDst, DmaRequest, DmaSrc, DmaStream,
+    DmaStreamError,
+};
+use crate::ll_api::{ll_cmd::*, AdcScanCtrl};
+
+/// One ADC1/ADC2 result pair converted at the same instant, as packed by the ADC1 data
+/// register in dual mode.
+#[repr(transparent)]
+#[derive(Clone, Copy, Default, PartialEq, Eq, PartialOrd, Debug)]
+pub struct DualSample(u32);
+
+impl DualSample {
+    /// Zero pair, to initialize static buffers.
+    pub const ZERO: DualSample = DualSample(0);
+
+    /// Sample of the ADC1 input of the pair.
+    pub fn adc1(&self) -> u16 {
+        self.0 as u16
+    }
+
+    /// Sample of the ADC2 input of the pair.
+    pub fn adc2(&self) -> u16 {
+        (self.0 >> 16) as u16
+    }
+}
+
+impl DmaDataSize for DualSample {}
+
+/// ADC1 and ADC2 in regular simultaneous mode, both inputs of a pair are sampled at the same
+/// instant, e.g. voltage and current for power metering. The DMA moves one 32-bit word per
+/// pair, a frame holds one `DualSample` per pair in the order of `pairs`.
+///
+/// Uses both ADCs, `Adc`/`AdcBuffered`/`AdcScan` must not run at the same time.
+pub struct DualAdc {
+    dma: Dma,
+    data_reg: usize,
+    pairs: usize,
+    adc: ScanAdc,
+}
+
+impl DualAdc {
+    /// Configures both regular sequences and claims the ADC DMA channel.
+    ///
+    /// # Arguments
+    /// * `pairs` - 1..=16 `(adc1, adc2)` inputs, converted in this order. ADC2 has no `Temp` and
+    ///   `Vref` inputs. The pins are set to analog mode.
+    /// * `sample_time` - Sample time of every input.
+    pub fn new(pairs: &[(AdcInput, AdcInput)], sample_time: AdcSampleTime) -> Result<Self, i32> {
+        if pairs.is_empty() || pairs.len() > 16 {
+            return Err(-1);
+        }
+        let mut seq = [0_u8; 32];
+        for (idx, (adc1, adc2)) in pairs.iter().enumerate() {
+            seq[2 * idx] = *adc1 as u8;
+            seq[2 * idx + 1] = *adc2 as u8;
+        }
+
+        let dma = Dma::request(DmaRequest::Adc1)?;
+        let mut data_reg: u32 = 0;
+        let result = ll_invoke_inner!(
+            INVOKE_ID_ADC_DUAL_INIT,
+            seq.as_ptr(),
+            pairs.len(),
+            sample_time,
+            &mut data_reg as *mut u32
+        );
+        if result != 0 {
+            return Err(result);
+        }
+
+        Ok(DualAdc {
+            dma,
+            data_reg: data_reg as usize,
+            pairs: pairs.len(),
+            adc: ScanAdc,
+        })
+    }
+
+    /// Returns the number of pairs in a frame.
+    pub fn pairs(&self) -> usize {
+        self.pairs
+    }
+
+    /// Sets the frame rate of `into_stream()`, see `AdcScan::set_sample_rate()`.
+    pub fn set_sample_rate(&mut self, hz: u32) -> Result<(), i32> {
+        self.adc.set_rate(hz)
+    }
+
+    /// Converts every pair once.
+    ///
+    /// # Arguments
+    /// * `frame` - Receives one sample per pair, must hold at least `pairs()` items.
+    pub fn read(&mut self, frame: &mut [DualSample]) -> Result<(), i32> {
+        self.start(frame)?;
+        let result = self.dma.wait();
+        self.dma.stop()?;
+        result
+    }
+
+    /// Like `read()`, waits for the DMA without blocking the executor.
+    #[cfg(feature = "embassy")]
+    pub async fn async_read(&mut self, frame: &mut [DualSample]) -> Result<(), i32> {
+        self.start(frame)?;
+        let _guard = crate::dma::DmaStopGuard(&self.dma);
+        self.dma.async_wait().await
+    }
+
+    /// Converts the pairs continuously into a double buffer of `N / pairs()` frames per half,
+    /// at the rate set with `set_sample_rate()`.
+    ///
+    /// # Arguments
+    /// * `buf` - Two halves of `N` samples, `N` must be a multiple of `pairs()`.
+    pub fn into_stream<const N: usize>(
+        self,
+        buf: &'static mut [[DualSample; N]; 2],
+    ) -> Result<DualAdcStream<N>, i32> {
+        if N == 0 || N % self.pairs != 0 {
+            return Err(-10);
+        }
+
+        let DualAdc {
+            dma,
+            data_reg,
+            pairs,
+            adc,
+        } = self;
+        let mut stream = DmaStream::new(dma, data_reg, buf)?;
+        stream.start()?;
+        adc.ctrl(AdcScanCtrl::Continuous)?;
+
+        Ok(DualAdcStream {
+            stream,
+            pairs,
+            _adc: adc,
+        })
+    }
+
+    fn start(&mut self, frame: &mut [DualSample]) -> Result<(), i32> {
+        let frame = match frame.get_mut(..self.pairs) {
+            Some(frame) => frame,
+            None => return Err(-10),
+        };
+        let config = Config::new(
+            DmaSrc::<DualSample>::Addr(self.data_reg),
+            DmaDst::Ref(frame),
+            DmaDir::P2M,
+            false,
+        );
+        self.dma.init(&config, None)?;
+        self.dma.start()?;
+        self.adc.ctrl(AdcScanCtrl::OneShot)
+    }
+}
+
+/// Continuous dual conversion, see `DualAdc::into_stream()`.
+pub struct DualAdcStream<const N: usize> {
+    stream: DmaStream<DualSample, N>,
+    pairs: usize,
+    _adc: ScanAdc,
+}
+
+impl<const N: usize> DualAdcStream<N> {
+    /// Returns the number of pairs in a frame, a block holds `N / pairs()` frames.
+    pub fn pairs(&self) -> usize {
+        self.pairs
+    }
+
+    /// Returns the oldest filled block of frames, see `DmaStream::read()`.
+    pub fn read(&mut self) -> nb::Result<DmaBlock<'_, DualSample, N>, DmaStreamError> {
+        self.stream.read()
+    }
+
+    /// Waits for the next filled block without blocking the executor.
+    #[cfg(feature = "embassy")]
+    pub async fn async_read(&mut self) -> Result<DmaBlock<'_, DualSample, N>, DmaStreamError> {
+        self.stream.async_read().await
+    }
+}
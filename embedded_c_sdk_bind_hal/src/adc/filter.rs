@@ -0,0 +1,202 @@
+/// Decimation applied by the EOC interrupt before a sample enters the `AdcBuffered` ring.
+///
+/// All filters use integer math, one output replaces `ratio` input samples, so the ring and
+/// the consumer see `ratio` times fewer samples.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum AdcFilter {
+    /// Every sample enters the ring (default).
+    None,
+    /// Mean of `n` samples, 1..=65535.
+    Boxcar(u16),
+    /// Sum of `4^bits` samples shifted right by `bits`, 1..=4. Adds `bits` bits of resolution
+    /// when the input carries some noise, a 12-bit ADC reads 0..=(4095 << bits).
+    Oversample(u8),
+    /// Cascaded integrator-comb decimator of `order` 1..=3 stages, the output is scaled back
+    /// to the input range. `ratio^order * 4095` must fit into 32 bits.
+    Cic { order: u8, ratio: u16 },
+    /// First order low-pass `y += (x - y) >> shift`, `shift` 1..=15, one output every
+    /// `ratio` samples.
+    LowPass { shift: u8, ratio: u16 },
+}
+
+const CIC_MAX_ORDER: usize = 3;
+const ADC_MAX_SAMPLE: u64 = 4095;
+
+/// Per channel state of an `AdcFilter`.
+pub(crate) struct Decimator {
+    filter: AdcFilter,
+    ratio: u32,
+    gain: u32,
+    count: u32,
+    acc: [u32; CIC_MAX_ORDER],
+    comb: [u32; CIC_MAX_ORDER],
+}
+
+impl Decimator {
+    pub(crate) const fn new() -> Self {
+        Decimator {
+            filter: AdcFilter::None,
+            ratio: 1,
+            gain: 1,
+            count: 0,
+            acc: [0; CIC_MAX_ORDER],
+            comb: [0; CIC_MAX_ORDER],
+        }
+    }
+
+    /// Switches to `filter` and clears the state, the old settings stay on error.
+    pub(crate) fn set(&mut self, filter: AdcFilter) -> Result<(), i32> {
+        let (ratio, gain) = match filter {
+            AdcFilter::None => (1, 1),
+            AdcFilter::Boxcar(n) if n > 0 => (n as u32, n as u32),
+            AdcFilter::Oversample(bits) if bits >= 1 && bits <= 4 => (1 << (2 * bits), 1 << bits),
+            AdcFilter::Cic { order, ratio }
+                if order >= 1
+                    && order as usize <= CIC_MAX_ORDER
+                    && ratio > 0
+                    && (ratio as u64).pow(order as u32) * ADC_MAX_SAMPLE <= u32::MAX as u64 =>
+            {
+                (ratio as u32, (ratio as u32).pow(order as u32))
+            }
+            AdcFilter::LowPass { shift, ratio } if shift >= 1 && shift <= 15 && ratio > 0 => {
+                (ratio as u32, 1)
+            }
+            _ => return Err(-10),
+        };
+
+        *self = Decimator::new();
+        self.filter = filter;
+        self.ratio = ratio;
+        self.gain = gain;
+        Ok(())
+    }
+
+    /// Feeds one raw sample, returns the output sample at the end of every decimation period.
+    pub(crate) fn push(&mut self, val: u16) -> Option<u32> {
+        let x = val as u32;
+        match self.filter {
+            AdcFilter::None => return Some(x),
+            AdcFilter::Boxcar(_) | AdcFilter::Oversample(_) => {
+                self.acc[0] += x;
+            }
+            AdcFilter::Cic { order, .. } => {
+                //integrators wrap, the combs undo the wrap as long as the output fits 32 bits
+                let mut input = x;
+                for acc in &mut self.acc[..order as usize] {
+                    *acc = acc.wrapping_add(input);
+                    input = *acc;
+                }
+            }
+            AdcFilter::LowPass { shift, .. } => {
+                //y in Q15, x < 2^16 so x << 15 and the difference fit an i32
+                let y = self.acc[0] as i32;
+                let y = y + (((x << 15) as i32 - y) >> shift);
+                self.acc[0] = y as u32;
+            }
+        }
+
+        self.count += 1;
+        if self.count < self.ratio {
+            return None;
+        }
+        self.count = 0;
+
+        let out = match self.filter {
+            AdcFilter::Boxcar(_) | AdcFilter::Oversample(_) => {
+                let sum = self.acc[0];
+                self.acc[0] = 0;
+                self.scale(sum)
+            }
+            AdcFilter::Cic { order, .. } => {
+                let mut output = self.acc[order as usize - 1];
+                for comb in &mut self.comb[..order as usize] {
+                    let diff = output.wrapping_sub(*comb);
+                    *comb = output;
+                    output = diff;
+                }
+                self.scale(output)
+            }
+            AdcFilter::LowPass { .. } => (self.acc[0] + 0x4000) >> 15,
+            AdcFilter::None => x,
+        };
+        Some(out)
+    }
+
+    //no hardware divider on Cortex-M0, shift when possible
+    fn scale(&self, sum: u32) -> u32 {
+        if self.gain.is_power_of_two() {
+            sum >> self.gain.trailing_zeros()
+        } else {
+            sum / self.gain
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn feed(dec: &mut Decimator, val: u16, times: usize) -> Option<u32> {
+        let mut out = None;
+        for _ in 0..times {
+            if let Some(val) = dec.push(val) {
+                assert!(out.is_none());
+                out = Some(val);
+            }
+        }
+        out
+    }
+
+    #[test]
+    fn boxcar_and_oversample() {
+        let mut dec = Decimator::new();
+        assert_eq!(dec.push(123), Some(123));
+
+        dec.set(AdcFilter::Boxcar(3)).unwrap();
+        assert_eq!(dec.push(10), None);
+        assert_eq!(dec.push(20), None);
+        assert_eq!(dec.push(60), Some(30));
+
+        dec.set(AdcFilter::Oversample(2)).unwrap();
+        assert_eq!(feed(&mut dec, 4095, 16), Some(4095 << 2));
+        assert_eq!(feed(&mut dec, 100, 8), None);
+        assert_eq!(feed(&mut dec, 101, 8), Some(402)); //100.5 with 2 extra bits
+
+        assert_eq!(dec.set(AdcFilter::Oversample(5)), Err(-10));
+        assert_eq!(dec.set(AdcFilter::Boxcar(0)), Err(-10));
+        assert_eq!(feed(&mut dec, 4, 16), Some(16)); //Oversample(2) kept
+    }
+
+    #[test]
+    fn cic_and_low_pass() {
+        let mut dec = Decimator::new();
+        dec.set(AdcFilter::Cic {
+            order: 3,
+            ratio: 16,
+        })
+        .unwrap();
+        let mut last = None;
+        for _ in 0..4 {
+            last = feed(&mut dec, 4095, 16);
+        }
+        assert_eq!(last, Some(4095)); //settled after order periods
+        assert_eq!(
+            dec.set(AdcFilter::Cic {
+                order: 3,
+                ratio: 128
+            }),
+            Err(-10)
+        );
+        assert_eq!(dec.set(AdcFilter::Cic { order: 4, ratio: 2 }), Err(-10));
+
+        dec.set(AdcFilter::LowPass { shift: 2, ratio: 4 }).unwrap();
+        let mut last = 0;
+        for _ in 0..16 {
+            if let Some(val) = feed(&mut dec, 2000, 4) {
+                assert!(val >= last && val <= 2000);
+                last = val;
+            }
+        }
+        assert_eq!(last, 2000);
+    }
+}
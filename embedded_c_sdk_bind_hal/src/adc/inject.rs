@@ -0,0 +1,141 @@
+use super::{Adc, AdcInput, AdcSampleTime};
+use crate::ll_api::ll_cmd::*;
+#[cfg(feature = "embassy")]
+use embassy_sync::waitqueue::AtomicWaker;
+use portable_atomic::{AtomicBool, Ordering};
+
+const ADC_INJECT_IRQ: u32 = 0x01;
+const ADC_INJECT_TRIG_PWM: u32 = 0x02;
+const ADC_INJECT_NOT_DONE: i32 = -5;
+
+static INJECT_BUSY: AtomicBool = AtomicBool::new(false);
+#[cfg(feature = "embassy")]
+static INJECT_WAKER: AtomicWaker = AtomicWaker::new();
+
+/// Releases the injected group when dropped.
+pub(crate) struct InjectGuard;
+
+impl InjectGuard {
+    fn take() -> Result<Self, i32> {
+        if INJECT_BUSY.swap(true, Ordering::Acquire) {
+            return Err(-300);
+        }
+        Ok(InjectGuard)
+    }
+}
+
+impl Drop for InjectGuard {
+    fn drop(&mut self) {
+        INJECT_BUSY.store(false, Ordering::Release);
+    }
+}
+
+impl Adc {
+    /// Converts up to 4 inputs with the injected group and returns the samples in the order of
+    /// `inputs`.
+    ///
+    /// The injected group pre-empts a running regular conversion (`AdcBuffered`, `AdcScan`,
+    /// `DualAdc`), which carries on afterwards, so spot reads do not stop the stream. The sample
+    /// time is also used by the regular sequence if it converts the same input.
+    ///
+    /// # Arguments
+    /// * `inputs` - 1..=4 inputs.
+    /// * `sample_time` - Sample time of every input.
+    ///
+    /// # Returns
+    /// `Err(-300)` while another injection runs.
+    pub fn inject<const N: usize>(
+        inputs: &[AdcInput; N],
+        sample_time: AdcSampleTime,
+    ) -> Result<[u16; N], i32> {
+        let _guard = InjectGuard::take()?;
+        Self::inject_start(inputs, sample_time, 0)?;
+
+        let mut buf = [0_u16; N];
+        let result = ll_invoke_inner!(INVOKE_ID_ADC_INJECT_READ, buf.as_mut_ptr(), N, 1);
+        if result == 0 {
+            Ok(buf)
+        } else {
+            Err(result)
+        }
+    }
+
+    /// Like `inject()`, waits for the injected end of conversion interrupt without blocking the
+    /// executor.
+    #[cfg(feature = "embassy")]
+    pub async fn async_inject<const N: usize>(
+        inputs: &[AdcInput; N],
+        sample_time: AdcSampleTime,
+    ) -> Result<[u16; N], i32> {
+        let _guard = InjectGuard::take()?;
+        Self::inject_start(inputs, sample_time, ADC_INJECT_IRQ)?;
+
+        let mut buf = [0_u16; N];
+        core::future::poll_fn(|cx| {
+            INJECT_WAKER.register(cx.waker());
+            match ll_invoke_inner!(INVOKE_ID_ADC_INJECT_READ, buf.as_mut_ptr(), N, 0) {
+                ADC_INJECT_NOT_DONE => core::task::Poll::Pending,
+                0 => core::task::Poll::Ready(Ok(())),
+                code => core::task::Poll::Ready(Err(code)),
+            }
+        })
+        .await?;
+        Ok(buf)
+    }
+
+    fn inject_start<const N: usize>(
+        inputs: &[AdcInput; N],
+        sample_time: AdcSampleTime,
+        flags: u32,
+    ) -> Result<(), i32> {
+        let result = ll_invoke_inner!(
+            INVOKE_ID_ADC_INJECT_START,
+            inputs.as_ptr(),
+            N,
+            sample_time,
+            flags
+        );
+        if result == 0 {
+            Ok(())
+        } else {
+            Err(result)
+        }
+    }
+}
+
+/// Injected group converted by the hardware at every sample point of the motor PWM, keeps the
+/// group reserved until dropped.
+pub(crate) struct InjectTriggered {
+    _guard: InjectGuard,
+}
+
+impl InjectTriggered {
+    pub(crate) fn start<const N: usize>(
+        inputs: &[AdcInput; N],
+        sample_time: AdcSampleTime,
+    ) -> Result<Self, i32> {
+        let guard = InjectGuard::take()?;
+        Adc::inject_start(inputs, sample_time, ADC_INJECT_TRIG_PWM)?;
+        Ok(InjectTriggered { _guard: guard })
+    }
+
+    /// Copies the results of the last conversion of `count` inputs into `out`, `WouldBlock` if
+    /// there was no new conversion since the last read.
+    pub(crate) fn read(count: usize, out: &mut [u16]) -> nb::Result<(), i32> {
+        if out.len() < count {
+            return Err(nb::Error::Other(-10));
+        }
+        match ll_invoke_inner!(INVOKE_ID_ADC_INJECT_READ, out.as_mut_ptr(), count, 0) {
+            0 => Ok(()),
+            ADC_INJECT_NOT_DONE => Err(nb::Error::WouldBlock),
+            code => Err(nb::Error::Other(code)),
+        }
+    }
+}
+
+#[allow(non_snake_case)]
+#[no_mangle]
+unsafe extern "C" fn ADC_JEOC_hook_rs() {
+    #[cfg(feature = "embassy")]
+    INJECT_WAKER.wake();
+}
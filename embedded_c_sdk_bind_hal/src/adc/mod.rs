@@ -1,9 +1,26 @@
 use crate::common::atomic_ring_buffer::RingBuffer;
 use crate::ll_api::{ll_cmd::*, AdcCtrl};
+use core::cell::RefCell;
+use critical_section::Mutex;
+use filter::Decimator;
 #[cfg(feature = "_adc-buffered")]
 use paste::paste;
+use portable_atomic::{AtomicU32, Ordering};
 
-pub use crate::ll_api::AdcChannel;
+mod calib;
+mod dual;
+mod filter;
+mod inject;
+mod scan;
+mod watchdog;
+
+pub use crate::ll_api::{AdcChannel, AdcInput, AdcSampleTime};
+pub use calib::AdcCalibration;
+pub use dual::*;
+pub use filter::AdcFilter;
+pub(crate) use inject::InjectTriggered;
+pub use scan::*;
+pub use watchdog::AdcWatchdog;
 
 #[cfg(not(feature = "adc-data-type-u8"))]
 pub type AdcDataType = u16;
@@ -80,7 +97,40 @@ impl Drop for Adc {
     }
 }
 
-pub struct AdcChData(RingBuffer<AdcDataType>);
+/// Ring of one buffered channel. The EOC interrupt is the only writer and `AdcBuffered` the
+/// only reader, neither side masks interrupts to access it.
+pub struct AdcChData {
+    ring: RingBuffer<AdcDataType>,
+    filter: Mutex<RefCell<Decimator>>,
+    overruns: AtomicU32,
+}
+
+impl AdcChData {
+    pub const fn new() -> Self {
+        AdcChData {
+            ring: RingBuffer::new(),
+            filter: Mutex::new(RefCell::new(Decimator::new())),
+            overruns: AtomicU32::new(0),
+        }
+    }
+
+    /// Runs the channel filter on a raw sample and stores the output. A full ring keeps its
+    /// samples and counts the new one as overrun, the reader side is never touched here.
+    #[allow(dead_code)]
+    fn on_sample(&self, val: u16) {
+        let out = critical_section::with(|cs| self.filter.borrow(cs).borrow_mut().push(val));
+        if let Some(out) = out {
+            let out = out.min(AdcDataType::MAX as u32) as AdcDataType;
+            let pushed = match unsafe { self.ring.try_writer() } {
+                Some(mut writer) => writer.push_one(out),
+                None => false,
+            };
+            if !pushed {
+                self.overruns.fetch_add(1, Ordering::Relaxed);
+            }
+        }
+    }
+}
 
 pub struct AdcBuffered<'a> {
     ch: AdcChannel,
@@ -113,12 +163,51 @@ impl<'a> AdcBuffered<'a> {
     /// * `buffer` - The mutable buffer to be used for storing conversion results.
     pub fn set_buf(&self, buffer: &mut [u16]) {
         let len = buffer.len();
-        unsafe { self.data.0.init(buffer.as_mut_ptr(), len) };
+        unsafe { self.data.ring.init(buffer.as_mut_ptr(), len) };
+        self.data.overruns.store(0, Ordering::Relaxed);
+    }
+
+    /// Sets the sample rate of the next `start()`. The TIM3 update event triggers every
+    /// conversion, so the samples are evenly spaced; 0 converts back to back (default).
+    ///
+    /// TIM3 paces the conversions while a rate is set, `try_start()` fails with `Err(-3)` if PWM
+    /// channels or another driver run it.
+    ///
+    /// # Arguments
+    /// * `hz` - 0 or up to the conversion rate of the 13.5 cycles sample time, ADC clock / 26,
+    ///   `Err(-2)` above.
+    pub fn set_sample_rate(&self, hz: u32) -> Result<(), i32> {
+        let result = ll_invoke_inner!(INVOKE_ID_ADC_CTRL, self.ch, AdcCtrl::SetRate, hz);
+        if result == 0 {
+            Ok(())
+        } else {
+            Err(result)
+        }
+    }
+
+    /// Sets the decimation filter run by the EOC interrupt, the ring then receives one sample
+    /// per decimation period. The filter state is cleared.
+    ///
+    /// # Arguments
+    /// * `filter` - See `AdcFilter`, `Err(-10)` for out of range parameters.
+    pub fn set_filter(&self, filter: AdcFilter) -> Result<(), i32> {
+        critical_section::with(|cs| self.data.filter.borrow(cs).borrow_mut().set(filter))
     }
 
     /// Starts the ADC conversion process.
     pub fn start(&self) {
-        ll_invoke_inner!(INVOKE_ID_ADC_CTRL, self.ch, AdcCtrl::Start);
+        let _ = self.try_start();
+    }
+
+    /// Like `start()`, returns `Err(-3)` if a sample rate is set and TIM3 is run by PWM
+    /// channels or another driver, the ADC is then not triggered.
+    pub fn try_start(&self) -> Result<(), i32> {
+        let result = ll_invoke_inner!(INVOKE_ID_ADC_CTRL, self.ch, AdcCtrl::Start);
+        if result == 0 {
+            Ok(())
+        } else {
+            Err(result)
+        }
     }
 
     /// Stops the ADC conversion process.
@@ -131,9 +220,8 @@ impl<'a> AdcBuffered<'a> {
     /// # Returns
     /// An `Option<AdcDataType>` containing the conversion result if available, or `None` otherwise.
     pub fn read(&self) -> Option<AdcDataType> {
-        let mut result = None;
-        critical_section::with(|_| result = unsafe { self.data.0.reader().pop_one() });
-        return result;
+        let mut reader = unsafe { self.data.ring.try_reader() }?;
+        reader.pop_one()
     }
 
     /// Reads multiple conversion results from the ADC data buffer into the provided buffer.
@@ -144,18 +232,32 @@ impl<'a> AdcBuffered<'a> {
     /// # Returns
     /// The number of conversion results read.
     pub fn read_multiple(&self, buf: &mut [AdcDataType]) -> usize {
+        let mut reader = match unsafe { self.data.ring.try_reader() } {
+            Some(reader) => reader,
+            None => return 0,
+        };
+
+        //at most two contiguous parts when the filled area wraps
         let mut result = 0;
-        critical_section::with(|_| {
-            let mut reader = unsafe { self.data.0.reader() };
-            for b in buf {
-                if let Some(data) = reader.pop_one() {
-                    *b = data;
-                    result += 1;
-                }
+        while result < buf.len() {
+            let dst = &mut buf[result..];
+            let n = reader.pop(|src| {
+                let n = src.len().min(dst.len());
+                dst[..n].copy_from_slice(&src[..n]);
+                n
+            });
+            if n == 0 {
+                break;
             }
-        });
+            result += n;
+        }
+
+        result
+    }
 
-        return result;
+    /// Returns the number of samples dropped because the buffer was full and clears the count.
+    pub fn take_overruns(&self) -> u32 {
+        self.data.overruns.swap(0, Ordering::Relaxed)
     }
 }
 
@@ -169,19 +271,15 @@ impl<'a> Drop for AdcBuffered<'a> {
 macro_rules! impl_adc_ch_data {
     ($adc_ch:expr) => {
         paste! {
-            pub static [<ADC_CH $adc_ch _DATA>]: AdcChData = AdcChData ( RingBuffer::new() );
+            pub static [<ADC_CH $adc_ch _DATA>]: AdcChData = AdcChData::new();
         }
 
         paste! {
             #[allow(non_snake_case)]
             #[no_mangle]
-            unsafe extern "C" fn [<ADC_CH $adc_ch _EOC_hook_rs>] (val: AdcDataType) {//fn: ADC_CH{ch}_EOC_hook_rs(val)
+            unsafe extern "C" fn [<ADC_CH $adc_ch _EOC_hook_rs>] (val: u16) {//fn: ADC_CH{ch}_EOC_hook_rs(val)
                 paste! {
-                    let ch_data = &[<ADC_CH $adc_ch _DATA>].0;
-                    if ch_data.is_full() {
-                        ch_data.reader().pop_one();
-                    }
-                    ch_data.writer().push_one(val);
+                    [<ADC_CH $adc_ch _DATA>].on_sample(val);
                 }
             }
         }
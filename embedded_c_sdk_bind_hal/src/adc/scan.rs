@@ -0,0 +1,185 @@
+use super::{AdcInput, AdcSampleTime};
+use crate::dma::{
+    Config, Dma, DmaBlock, DmaDir, DmaDst, DmaRequest, DmaSrc, DmaStream, DmaStreamError,
+};
+use crate::ll_api::{ll_cmd::*, AdcScanCtrl};
+
+/// Stops the scan sequence and the ADC when dropped.
+pub(super) struct ScanAdc;
+
+impl ScanAdc {
+    pub(super) fn ctrl(&self, ctrl: AdcScanCtrl) -> Result<(), i32> {
+        let result = ll_invoke_inner!(INVOKE_ID_ADC_SCAN_CTRL, ctrl);
+        if result == 0 {
+            Ok(())
+        } else {
+            Err(result)
+        }
+    }
+
+    pub(super) fn set_rate(&self, hz: u32) -> Result<(), i32> {
+        let result = ll_invoke_inner!(INVOKE_ID_ADC_SCAN_CTRL, AdcScanCtrl::SetRate, hz);
+        if result == 0 {
+            Ok(())
+        } else {
+            Err(result)
+        }
+    }
+}
+
+impl Drop for ScanAdc {
+    fn drop(&mut self) {
+        let _ = self.ctrl(AdcScanCtrl::Stop);
+    }
+}
+
+/// Converts several inputs with one trigger, the DMA writes one frame per sequence with the
+/// samples in the order of `inputs`.
+///
+/// Uses the whole ADC, `Adc`/`AdcBuffered` must not run at the same time.
+pub struct AdcScan {
+    dma: Dma,
+    data_reg: usize,
+    inputs: usize,
+    adc: ScanAdc,
+}
+
+impl AdcScan {
+    /// Configures the regular sequence and claims the ADC DMA channel.
+    ///
+    /// # Arguments
+    /// * `inputs` - 1..=16 inputs, converted in this order. The pins are set to analog mode.
+    /// * `sample_time` - Sample time of every input.
+    pub fn new(inputs: &[AdcInput], sample_time: AdcSampleTime) -> Result<Self, i32> {
+        let dma = Dma::request(DmaRequest::Adc1)?;
+        let mut data_reg: u32 = 0;
+        let result = ll_invoke_inner!(
+            INVOKE_ID_ADC_SCAN_INIT,
+            inputs.as_ptr(),
+            inputs.len(),
+            sample_time,
+            0,
+            &mut data_reg as *mut u32
+        );
+        if result != 0 {
+            return Err(result);
+        }
+
+        Ok(AdcScan {
+            dma,
+            data_reg: data_reg as usize,
+            inputs: inputs.len(),
+            adc: ScanAdc,
+        })
+    }
+
+    /// Returns the number of samples in a frame.
+    pub fn inputs(&self) -> usize {
+        self.inputs
+    }
+
+    /// Sets the frame rate of `into_stream()`. The TIM3 update event triggers one sequence per
+    /// period, so the frames are evenly spaced independent of the CPU load; 0 converts back to
+    /// back (default). `read()` always converts at once.
+    ///
+    /// TIM3 paces the frames while the stream runs, starting it fails with `Err(-3)` if PWM
+    /// channels or another driver run TIM3.
+    ///
+    /// # Arguments
+    /// * `hz` - 0 or a rate at which the conversion time of the whole sequence, sample times
+    ///   plus 12.5 ADC clocks per input, fits into one period, `Err(-2)` otherwise.
+    pub fn set_sample_rate(&mut self, hz: u32) -> Result<(), i32> {
+        self.adc.set_rate(hz)
+    }
+
+    /// Converts every input once.
+    ///
+    /// # Arguments
+    /// * `frame` - Receives one sample per input, must hold at least `inputs()` items.
+    pub fn read(&mut self, frame: &mut [u16]) -> Result<(), i32> {
+        self.start(frame)?;
+        let result = self.dma.wait();
+        self.dma.stop()?;
+        result
+    }
+
+    /// Like `read()`, waits for the DMA without blocking the executor.
+    #[cfg(feature = "embassy")]
+    pub async fn async_read(&mut self, frame: &mut [u16]) -> Result<(), i32> {
+        self.start(frame)?;
+        let _guard = crate::dma::DmaStopGuard(&self.dma);
+        self.dma.async_wait().await
+    }
+
+    /// Converts the sequence continuously into a double buffer of `N / inputs()` frames per half,
+    /// at the rate set with `set_sample_rate()`.
+    ///
+    /// # Arguments
+    /// * `buf` - Two halves of `N` samples, `N` must be a multiple of `inputs()`.
+    pub fn into_stream<const N: usize>(
+        self,
+        buf: &'static mut [[u16; N]; 2],
+    ) -> Result<AdcScanStream<N>, i32> {
+        if N == 0 || N % self.inputs != 0 {
+            return Err(-10);
+        }
+
+        let AdcScan {
+            dma,
+            data_reg,
+            inputs,
+            adc,
+        } = self;
+        let mut stream = DmaStream::new(dma, data_reg, buf)?;
+        stream.start()?;
+        adc.ctrl(AdcScanCtrl::Continuous)?;
+
+        Ok(AdcScanStream {
+            stream,
+            inputs,
+            _adc: adc,
+        })
+    }
+
+    fn start(&mut self, frame: &mut [u16]) -> Result<(), i32> {
+        let frame = match frame.get_mut(..self.inputs) {
+            Some(frame) => frame,
+            None => return Err(-10),
+        };
+        let config = Config::new(
+            DmaSrc::<u16>::Addr(self.data_reg),
+            DmaDst::Ref(frame),
+            DmaDir::P2M,
+            false,
+        );
+        self.dma.init(&config, None)?;
+        self.dma.start()?;
+        self.adc.ctrl(AdcScanCtrl::OneShot)
+    }
+}
+
+/// Continuous scan, see `AdcScan::into_stream()`.
+pub struct AdcScanStream<const N: usize> {
+    stream: DmaStream<u16, N>,
+    inputs: usize,
+    _adc: ScanAdc,
+}
+
+impl<const N: usize> AdcScanStream<N> {
+    /// Returns the number of samples in a frame, a block holds `N / inputs()` frames.
+    pub fn inputs(&self) -> usize {
+        self.inputs
+    }
+
+    /// Returns the oldest filled block of interleaved frames, see `DmaStream::read()`.
+    /// Iterate the frames with `block.chunks_exact(stream.inputs())`.
+    pub fn read(&mut self) -> nb::Result<DmaBlock<'_, u16, N>, DmaStreamError> {
+        self.stream.read()
+    }
+
+    /// Waits for the next filled block without blocking the executor.
+    #[cfg(feature = "embassy")]
+    pub async fn async_read(&mut self) -> Result<DmaBlock<'_, u16, N>, DmaStreamError> {
+        self.stream.async_read().await
+    }
+}
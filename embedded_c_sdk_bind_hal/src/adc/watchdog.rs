@@ -0,0 +1,131 @@
+use super::{Adc, AdcInput};
+use crate::ll_api::{ll_cmd::*, AdcWatchdogCtrl};
+#[cfg(feature = "embassy")]
+use embassy_sync::waitqueue::AtomicWaker;
+use portable_atomic::{AtomicBool, AtomicPtr, Ordering};
+
+const ADC_IN_ALL: u32 = 18; //ADC_IN_MAX
+
+static WATCHDOG_TAKEN: AtomicBool = AtomicBool::new(false);
+static WATCHDOG_FIRED: AtomicBool = AtomicBool::new(false);
+static WATCHDOG_CALLBACK: AtomicPtr<()> = AtomicPtr::new(core::ptr::null_mut());
+#[cfg(feature = "embassy")]
+static WATCHDOG_WAKER: AtomicWaker = AtomicWaker::new();
+
+/// The ADC analog watchdog, compares every regular conversion with a window in hardware.
+///
+/// The watchdog watches the samples of a running `AdcBuffered`, `AdcScan` or `DualAdc`
+/// stream (ADC1 side) and costs no CPU time until a sample leaves the window. Each `arm()`
+/// reports one event, the interrupt is disabled again until the next `arm()`.
+pub struct AdcWatchdog {
+    _private: (),
+}
+
+impl Adc {
+    /// Sets up the analog watchdog, see `AdcWatchdog`.
+    ///
+    /// # Arguments
+    /// * `input` - The input to watch, `None` watches every input of the regular sequence.
+    /// * `low` - Lowest sample inside the window.
+    /// * `high` - Highest sample inside the window, up to 4095.
+    ///
+    /// # Returns
+    /// `Err(-300)` if the watchdog is in use.
+    pub fn watchdog(input: Option<AdcInput>, low: u16, high: u16) -> Result<AdcWatchdog, i32> {
+        if WATCHDOG_TAKEN.swap(true, Ordering::Acquire) {
+            return Err(-300);
+        }
+        let watchdog = AdcWatchdog { _private: () };
+        watchdog.set_window(input, low, high)?;
+        Ok(watchdog)
+    }
+}
+
+impl AdcWatchdog {
+    /// Changes the watched input and window, the watchdog must be armed again.
+    pub fn set_window(&self, input: Option<AdcInput>, low: u16, high: u16) -> Result<(), i32> {
+        let input = match input {
+            Some(input) => input as u32,
+            None => ADC_IN_ALL,
+        };
+        let result = ll_invoke_inner!(
+            INVOKE_ID_ADC_WATCHDOG,
+            AdcWatchdogCtrl::Set,
+            input,
+            low,
+            high
+        );
+        if result == 0 {
+            Ok(())
+        } else {
+            Err(result)
+        }
+    }
+
+    /// Enables the watchdog interrupt for the next sample outside the window.
+    pub fn arm(&self) -> Result<(), i32> {
+        WATCHDOG_FIRED.store(false, Ordering::Release);
+        let result = ll_invoke_inner!(INVOKE_ID_ADC_WATCHDOG, AdcWatchdogCtrl::Arm);
+        if result == 0 {
+            Ok(())
+        } else {
+            Err(result)
+        }
+    }
+
+    /// Returns true once after the watchdog fired.
+    pub fn fired(&self) -> bool {
+        WATCHDOG_FIRED.swap(false, Ordering::AcqRel)
+    }
+
+    /// Arms the watchdog and calls `callback` from the ADC interrupt when a sample leaves the
+    /// window. Call `arm()` again, e.g. from the callback, for the next event.
+    ///
+    /// # Arguments
+    /// * `callback` - Runs in interrupt context, keep it short.
+    pub fn on_trigger(&self, callback: fn()) -> Result<(), i32> {
+        WATCHDOG_CALLBACK.store(callback as *mut (), Ordering::Release);
+        self.arm()
+    }
+
+    /// Removes the callback, the watchdog stays as it is.
+    pub fn remove_callback(&self) {
+        WATCHDOG_CALLBACK.store(core::ptr::null_mut(), Ordering::Release);
+    }
+
+    /// Arms the watchdog and waits until a sample leaves the window.
+    #[cfg(feature = "embassy")]
+    pub async fn wait(&self) -> Result<(), i32> {
+        self.arm()?;
+        core::future::poll_fn(|cx| {
+            WATCHDOG_WAKER.register(cx.waker());
+            if WATCHDOG_FIRED.swap(false, Ordering::AcqRel) {
+                core::task::Poll::Ready(Ok(()))
+            } else {
+                core::task::Poll::Pending
+            }
+        })
+        .await
+    }
+}
+
+impl Drop for AdcWatchdog {
+    fn drop(&mut self) {
+        ll_invoke_inner!(INVOKE_ID_ADC_WATCHDOG, AdcWatchdogCtrl::Disable);
+        WATCHDOG_CALLBACK.store(core::ptr::null_mut(), Ordering::Release);
+        WATCHDOG_TAKEN.store(false, Ordering::Release);
+    }
+}
+
+#[allow(non_snake_case)]
+#[no_mangle]
+unsafe extern "C" fn ADC_AWD_hook_rs() {
+    WATCHDOG_FIRED.store(true, Ordering::Release);
+    let callback = WATCHDOG_CALLBACK.load(Ordering::Acquire);
+    if !callback.is_null() {
+        let callback: fn() = core::mem::transmute(callback);
+        callback();
+    }
+    #[cfg(feature = "embassy")]
+    WATCHDOG_WAKER.wake();
+}
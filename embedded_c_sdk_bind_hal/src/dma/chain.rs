@@ -0,0 +1,135 @@
+use super::{Dma, DmaDataSize, DmaDir};
+use crate::ll_api::{ll_cmd::*, DmaFlags, DmaIrq};
+use core::marker::PhantomData;
+use core::mem::size_of;
+use portable_atomic::Ordering;
+
+const SEG_SRC_INC: u8 = 0x01;
+const SEG_DST_INC: u8 = 0x02;
+
+/// One segment of a DMA chain, see `Dma::chain()`.
+///
+/// A segment moves 1..=65535 items, the constructors return `Err(-10)` for longer buffers,
+/// split them into several segments. An empty segment makes the chain fail with `Err(-5)`.
+#[repr(C)]
+#[derive(Clone, Copy, Debug)]
+pub struct DmaSegment<'a> {
+    src: u32,
+    dst: u32,
+    count: u16,
+    width: u8,
+    flags: u8,
+    _buf: PhantomData<&'a ()>,
+}
+
+impl<'a> DmaSegment<'a> {
+    /// Reads `src` into the register at `dst`, e.g. a header in flash or a payload in RAM
+    /// written to a peripheral data register.
+    pub fn gather<T: DmaDataSize>(src: &'a [T], dst: usize) -> Result<Self, i32> {
+        Self::build::<T>(src.as_ptr() as usize, dst, src.len(), SEG_SRC_INC)
+    }
+
+    /// Fills `dst` from the register at `src`.
+    pub fn scatter<T: DmaDataSize>(src: usize, dst: &'a mut [T]) -> Result<Self, i32> {
+        Self::build::<T>(src, dst.as_mut_ptr() as usize, dst.len(), SEG_DST_INC)
+    }
+
+    /// Copies `src` into `dst`, for memory to memory chains.
+    pub fn copy<T: DmaDataSize>(src: &'a [T], dst: &'a mut [T]) -> Result<Self, i32> {
+        let len = src.len().min(dst.len());
+        Self::build::<T>(
+            src.as_ptr() as usize,
+            dst.as_mut_ptr() as usize,
+            len,
+            SEG_SRC_INC | SEG_DST_INC,
+        )
+    }
+
+    /// Moves `count` items from the register at `src` to the register at `dst`, e.g. a CRC
+    /// result appended to a frame.
+    pub fn register<T: DmaDataSize>(src: usize, dst: usize, count: usize) -> Result<Self, i32> {
+        Self::build::<T>(src, dst, count, 0)
+    }
+
+    fn build<T>(src: usize, dst: usize, len: usize, flags: u8) -> Result<Self, i32> {
+        if len > 0xFFFF {
+            return Err(-10);
+        }
+        Ok(DmaSegment {
+            src: src as u32,
+            dst: dst as u32,
+            count: len as u16, //0 is rejected by dma_chain_start()
+            width: size_of::<T>() as u8,
+            flags,
+            _buf: PhantomData,
+        })
+    }
+}
+
+impl Dma {
+    /// Runs `segments` back to back and waits for the last one.
+    ///
+    /// The transfer complete interrupt of the channel loads the next segment, so the caller
+    /// does not need one init/start/wait round per segment. The peripheral request of the
+    /// channel paces every segment unless `dir` is `DmaDir::M2M`.
+    ///
+    /// # Arguments
+    /// * `dir` - Direction of all segments, for `M2P` `dst` is the peripheral side, for `P2M` `src`.
+    /// * `segments` - The chain, 1..=65535 segments.
+    pub fn chain(&self, dir: DmaDir, segments: &[DmaSegment]) -> Result<(), i32> {
+        self.chain_start(dir, segments)?;
+        let result = self.wait();
+        self.stop()?;
+        result
+    }
+
+    /// Like `chain()`, waits for the last segment without blocking the executor.
+    #[cfg(feature = "embassy")]
+    pub async fn async_chain(&self, dir: DmaDir, segments: &[DmaSegment<'_>]) -> Result<(), i32> {
+        self.chain_start(dir, segments)?;
+        let _guard = super::DmaStopGuard(self);
+        self.async_wait().await
+    }
+
+    fn chain_start(&self, dir: DmaDir, segments: &[DmaSegment]) -> Result<(), i32> {
+        let dir = match dir {
+            DmaDir::M2M => DmaFlags::MemToMem,
+            DmaDir::P2M => DmaFlags::PeriphToMem,
+            DmaDir::M2P => DmaFlags::MemToPeriph,
+        };
+        let state = self.state();
+        state.events.store(0, Ordering::Release);
+        state.irq_mask.store(
+            DmaIrq::Complete as u8 | DmaIrq::Error as u8,
+            Ordering::Relaxed,
+        );
+
+        let result = ll_invoke_inner!(
+            INVOKE_ID_DMA_CHAIN_START,
+            self.ch,
+            dir,
+            segments.as_ptr(),
+            segments.len()
+        );
+        if result == 0 {
+            Ok(())
+        } else {
+            Err(result)
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn segment_rejects_oversize() {
+        let seg = DmaSegment::register::<u16>(0x4000_0000, 0x2000_0000, 0xFFFF).unwrap();
+        assert_eq!((seg.count, seg.width, seg.flags), (0xFFFF, 2, 0));
+        assert_eq!(
+            DmaSegment::register::<u8>(0x4000_0000, 0x2000_0000, 0x10000).err(),
+            Some(-10)
+        );
+    }
+}
@@ -0,0 +1,240 @@
+use super::{Config, Dma, DmaDataSize, DmaDir, DmaDst, DmaRequest, DmaSrc};
+use core::mem::size_of;
+
+/// Default size in bytes below which `DmaMem` copies with the CPU, the DMA setup costs more
+/// than a short CPU loop.
+pub const DMA_MEM_CPU_THRESHOLD: usize = 64;
+
+const DMA_MAX_COUNT: usize = 0xFFFF;
+
+#[repr(C, align(4))]
+struct Pattern<T>([T; 4]);
+
+/// Memory to memory copy and fill on a reserved DMA channel.
+///
+/// Transfers use 32-bit words when both buffers and the length are word aligned, then half
+/// words, then the item size. Buffers shorter than the CPU threshold are handled by the CPU.
+pub struct DmaMem {
+    dma: Dma,
+    cpu_threshold: usize,
+}
+
+impl DmaMem {
+    /// Reserves a free channel for memory transfers, see `Dma::request()`.
+    pub fn new() -> Result<Self, i32> {
+        Ok(Self::with_dma(Dma::request(DmaRequest::Mem)?))
+    }
+
+    /// Uses `dma` for memory transfers.
+    pub fn with_dma(dma: Dma) -> Self {
+        DmaMem {
+            dma,
+            cpu_threshold: DMA_MEM_CPU_THRESHOLD,
+        }
+    }
+
+    /// Sets the size in bytes below which the CPU is used, 0 always uses the DMA.
+    pub fn set_cpu_threshold(&mut self, bytes: usize) {
+        self.cpu_threshold = bytes;
+    }
+
+    /// Copies `min(dst.len(), src.len())` items from `src` to `dst`.
+    pub fn copy<T: DmaDataSize + Copy>(&mut self, dst: &mut [T], src: &[T]) -> Result<(), i32> {
+        let len = dst.len().min(src.len());
+        if len * size_of::<T>() < self.cpu_threshold {
+            dst[..len].copy_from_slice(&src[..len]);
+            return Ok(());
+        }
+
+        let job = Job::new::<T>(dst.as_mut_ptr() as usize, src.as_ptr() as usize, len, true);
+        for (idx, (dst, src, count)) in job.enumerate() {
+            self.arm(idx == 0, job.width, dst, src, count, true)?;
+            let result = self.dma.wait();
+            self.dma.stop()?;
+            result?;
+        }
+        Ok(())
+    }
+
+    /// Sets every item of `dst` to `value`.
+    pub fn fill<T: DmaDataSize + Copy>(&mut self, dst: &mut [T], value: T) -> Result<(), i32> {
+        if dst.len() * size_of::<T>() < self.cpu_threshold {
+            dst.fill(value);
+            return Ok(());
+        }
+
+        let pattern = Pattern([value; 4]);
+        let src = &pattern as *const Pattern<T> as usize;
+        let job = Job::new::<T>(dst.as_mut_ptr() as usize, src, dst.len(), false);
+        for (idx, (dst, src, count)) in job.enumerate() {
+            self.arm(idx == 0, job.width, dst, src, count, false)?;
+            let result = self.dma.wait();
+            self.dma.stop()?;
+            result?;
+        }
+        Ok(())
+    }
+
+    /// Like `copy()`, waits for the transfer complete interrupt without blocking the executor.
+    #[cfg(feature = "embassy")]
+    pub async fn async_copy<T: DmaDataSize + Copy>(
+        &mut self,
+        dst: &mut [T],
+        src: &[T],
+    ) -> Result<(), i32> {
+        let len = dst.len().min(src.len());
+        if len * size_of::<T>() < self.cpu_threshold {
+            dst[..len].copy_from_slice(&src[..len]);
+            return Ok(());
+        }
+
+        let job = Job::new::<T>(dst.as_mut_ptr() as usize, src.as_ptr() as usize, len, true);
+        let _guard = super::DmaStopGuard(&self.dma);
+        for (idx, (dst, src, count)) in job.enumerate() {
+            self.arm(idx == 0, job.width, dst, src, count, true)?;
+            self.dma.async_wait().await?;
+        }
+        Ok(())
+    }
+
+    /// Like `fill()`, waits for the transfer complete interrupt without blocking the executor.
+    #[cfg(feature = "embassy")]
+    pub async fn async_fill<T: DmaDataSize + Copy>(
+        &mut self,
+        dst: &mut [T],
+        value: T,
+    ) -> Result<(), i32> {
+        if dst.len() * size_of::<T>() < self.cpu_threshold {
+            dst.fill(value);
+            return Ok(());
+        }
+
+        let pattern = Pattern([value; 4]);
+        let src = &pattern as *const Pattern<T> as usize;
+        let job = Job::new::<T>(dst.as_mut_ptr() as usize, src, dst.len(), false);
+        let _guard = super::DmaStopGuard(&self.dma);
+        for (idx, (dst, src, count)) in job.enumerate() {
+            self.arm(idx == 0, job.width, dst, src, count, false)?;
+            self.dma.async_wait().await?;
+        }
+        Ok(())
+    }
+
+    /// Sets the channel up for the first chunk of a job, the following chunks keep the data
+    /// size and increments and only rewrite the addresses and the count with `Dma::reload()`.
+    fn arm(
+        &self,
+        first: bool,
+        width: usize,
+        dst: usize,
+        src: usize,
+        count: usize,
+        src_inc: bool,
+    ) -> Result<(), i32> {
+        if !first {
+            return self.dma.reload(src, dst, count);
+        }
+        match width {
+            4 => self.init::<u32>(dst, src, count, src_inc)?,
+            2 => self.init::<u16>(dst, src, count, src_inc)?,
+            _ => self.init::<u8>(dst, src, count, src_inc)?,
+        }
+        self.dma.start()
+    }
+
+    fn init<W: DmaDataSize>(
+        &self,
+        dst: usize,
+        src: usize,
+        count: usize,
+        src_inc: bool,
+    ) -> Result<(), i32> {
+        let dst = unsafe { core::slice::from_raw_parts_mut(dst as *mut W, count) };
+        let src = if src_inc {
+            DmaSrc::Ref(unsafe { core::slice::from_raw_parts(src as *const W, count) })
+        } else {
+            DmaSrc::Addr(src)
+        };
+        let config = Config::new(src, DmaDst::Ref(dst), DmaDir::M2M, false);
+        self.dma.init(&config, None)
+    }
+}
+
+/// Splits a transfer into chunks of at most `DMA_MAX_COUNT` items of `width` bytes.
+#[derive(Clone, Copy)]
+struct Job {
+    dst: usize,
+    src: usize,
+    bytes: usize,
+    width: usize,
+    src_inc: bool,
+}
+
+impl Job {
+    fn new<T>(dst: usize, src: usize, len: usize, src_inc: bool) -> Self {
+        let bytes = len * size_of::<T>();
+        let align = dst | src | bytes;
+        let width = if align & 3 == 0 {
+            4
+        } else if align & 1 == 0 {
+            2
+        } else {
+            1
+        };
+
+        Job {
+            dst,
+            src,
+            bytes,
+            width,
+            src_inc,
+        }
+    }
+}
+
+impl Iterator for Job {
+    type Item = (usize, usize, usize);
+
+    fn next(&mut self) -> Option<Self::Item> {
+        if self.bytes == 0 {
+            return None;
+        }
+
+        let count = (self.bytes / self.width).min(DMA_MAX_COUNT);
+        let chunk = (self.dst, self.src, count);
+        let size = count * self.width;
+        self.dst += size;
+        if self.src_inc {
+            self.src += size;
+        }
+        self.bytes -= size;
+        Some(chunk)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn job_width_and_chunks() {
+        let mut job = Job::new::<u8>(0x2000_0000, 0x2000_1000, 8, true);
+        assert_eq!(job.width, 4);
+        assert_eq!(job.next(), Some((0x2000_0000, 0x2000_1000, 2)));
+        assert_eq!(job.next(), None);
+
+        let job = Job::new::<u8>(0x2000_0002, 0x2000_1000, 6, true);
+        assert_eq!(job.width, 2);
+
+        let job = Job::new::<u16>(0x2000_0000, 0x2000_1000, 3, true);
+        assert_eq!(job.width, 2);
+
+        let mut job = Job::new::<u8>(0x2000_0001, 0x2000_1000, 0x30000, false);
+        assert_eq!(job.width, 1);
+        assert_eq!(job.next(), Some((0x2000_0001, 0x2000_1000, 0xFFFF)));
+        assert_eq!(job.next(), Some((0x2001_0000, 0x2000_1000, 0xFFFF)));
+        assert_eq!(job.next(), Some((0x2001_FFFF, 0x2000_1000, 0xFFFF)));
+        assert_eq!(job.next(), Some((0x2002_FFFE, 0x2000_1000, 3)));
+        assert_eq!(job.next(), None);
+    }
+}
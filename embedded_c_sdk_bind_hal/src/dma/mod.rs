@@ -0,0 +1,511 @@
+mod chain;
+pub mod mem;
+mod stream;
+
+use crate::ll_api::{ll_cmd::*, DmaCtrl, DmaFlags, DmaIrq};
+pub use crate::ll_api::{DmaChannel, DmaRequest};
+pub use chain::*;
+#[cfg(feature = "embassy")]
+use embassy_sync::waitqueue::AtomicWaker;
+use portable_atomic::{AtomicPtr, AtomicU32, AtomicU8, Ordering};
+pub use stream::*;
+
+pub trait DmaDataSize: PartialOrd {}
+
+impl DmaDataSize for i8 {}
+impl DmaDataSize for i16 {}
+impl DmaDataSize for i32 {}
+impl DmaDataSize for u8 {}
+impl DmaDataSize for u16 {}
+impl DmaDataSize for u32 {}
+
+pub struct Config<'a, ST, DT> {
+    pub src: DmaSrc<'a, ST>,
+    pub dst: DmaDst<'a, DT>,
+    pub dir: DmaDir,
+    pub circular: bool,
+}
+
+#[derive(Debug, PartialEq, Eq)]
+pub enum DmaSrc<'a, T> {
+    Ref(&'a [T]),
+    Addr(usize),
+}
+
+#[derive(Debug, PartialEq, Eq)]
+pub enum DmaDst<'a, T> {
+    Ref(&'a mut [T]),
+    Addr(usize),
+}
+
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum DmaDir {
+    /// Memory to memory direction
+    M2M,
+    /// Peripheral to memory direction
+    P2M,
+    /// Memory to peripheral direction
+    M2P,
+}
+
+impl<'a, ST, DT> Config<'a, ST, DT> {
+    pub const fn new(
+        src: DmaSrc<'a, ST>,
+        dst: DmaDst<'a, DT>,
+        dir: DmaDir,
+        circular: bool,
+    ) -> Self {
+        Self {
+            src,
+            dst,
+            dir,
+            circular,
+        }
+    }
+
+    pub fn set_src(&mut self, src: DmaSrc<'a, ST>) {
+        self.src = src
+    }
+
+    pub fn set_dst(&mut self, dst: DmaDst<'a, DT>) {
+        self.dst = dst
+    }
+
+    pub fn set_dir(&mut self, dir: DmaDir) {
+        self.dir = dir
+    }
+
+    pub fn set_circular(&mut self, circular: bool) {
+        self.circular = circular
+    }
+
+    pub fn build(&self) -> Result<DmaParam, i32> {
+        let mut src_inc = false;
+        let mut dst_inc = false;
+        let (src_addr, src_buff_size) = match self.src {
+            DmaSrc::Ref(buff) => {
+                let addr = buff.as_ptr() as usize;
+                let size = buff.len();
+                src_inc = true;
+                (addr, size)
+            }
+            DmaSrc::Addr(addr) => (addr, 0),
+        };
+
+        let (dst_addr, dst_buff_size) = match &self.dst {
+            DmaDst::Ref(buff) => {
+                let addr = (*buff).as_ptr() as usize;
+                let size = buff.len();
+                dst_inc = true;
+                (addr, size)
+            }
+            DmaDst::Addr(addr) => (*addr, 0),
+        };
+
+        let src_data_size = match core::mem::size_of::<ST>() {
+            1 => DmaFlags::SrcByte,
+            2 => DmaFlags::SrcHalfWord,
+            4 => DmaFlags::SrcWord,
+            _ => return Err(-100),
+        };
+
+        let dst_data_size = match core::mem::size_of::<DT>() {
+            1 => DmaFlags::DstByte,
+            2 => DmaFlags::DstHalfWord,
+            4 => DmaFlags::DstWord,
+            _ => return Err(-200),
+        };
+
+        let dir = match self.dir {
+            DmaDir::M2M => DmaFlags::MemToMem,
+            DmaDir::P2M => DmaFlags::PeriphToMem,
+            DmaDir::M2P => DmaFlags::MemToPeriph,
+        };
+
+        let circular = if self.circular {
+            DmaFlags::CircularOn
+        } else {
+            DmaFlags::None
+        };
+
+        let inc = match (src_inc, dst_inc) {
+            (true, true) => DmaFlags::BothInc,
+            (true, false) => DmaFlags::SrcInc,
+            (false, true) => DmaFlags::DstInc,
+            (false, false) => DmaFlags::None,
+        };
+
+        let flags =
+            src_data_size as u32 | dst_data_size as u32 | dir as u32 | inc as u32 | circular as u32;
+
+        Ok(DmaParam {
+            src_addr,
+            src_buff_size,
+            dst_addr,
+            dst_buff_size,
+            flags,
+        })
+    }
+}
+
+pub struct DmaParam {
+    src_addr: usize,
+    src_buff_size: usize,
+    dst_addr: usize,
+    dst_buff_size: usize,
+    flags: u32,
+}
+
+/// Events reported by the DMA channel interrupt.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub struct DmaEvent(u8);
+
+impl DmaEvent {
+    /// The transfer is complete, in circular mode the second half of the buffer is done.
+    pub fn is_complete(&self) -> bool {
+        self.0 & DmaIrq::Complete as u8 != 0
+    }
+
+    /// The first half of the buffer is done.
+    pub fn is_half(&self) -> bool {
+        self.0 & DmaIrq::Half as u8 != 0
+    }
+
+    /// Transfer error, the channel is disabled by hardware.
+    pub fn is_error(&self) -> bool {
+        self.0 & DmaIrq::Error as u8 != 0
+    }
+}
+
+const DMA_CH_COUNT: usize = 8;
+
+struct DmaChState {
+    callback: AtomicPtr<()>,
+    irq_mask: AtomicU8,
+    events: AtomicU8,
+    blocks: AtomicU32, //half and complete events counted by the irq, for DmaStream
+    laps: AtomicU32,   //complete events only, for DmaRing
+    #[cfg(feature = "embassy")]
+    waker: AtomicWaker,
+}
+
+const NEW_CH_STATE: DmaChState = DmaChState {
+    callback: AtomicPtr::new(core::ptr::null_mut()),
+    irq_mask: AtomicU8::new(0),
+    events: AtomicU8::new(0),
+    blocks: AtomicU32::new(0),
+    laps: AtomicU32::new(0),
+    #[cfg(feature = "embassy")]
+    waker: AtomicWaker::new(),
+};
+static DMA_CH_STATE: [DmaChState; DMA_CH_COUNT] = [NEW_CH_STATE; DMA_CH_COUNT];
+
+static DMA_CH_TAKEN: AtomicU8 = AtomicU8::new(0);
+
+const DMA_CH_LIST: [DmaChannel; DMA_CH_COUNT] = [
+    DmaChannel::CH0,
+    DmaChannel::CH1,
+    DmaChannel::CH2,
+    DmaChannel::CH3,
+    DmaChannel::CH4,
+    DmaChannel::CH5,
+    DmaChannel::CH6,
+    DmaChannel::CH7,
+];
+
+#[derive(Debug)]
+pub struct Dma {
+    ch: DmaChannel,
+    owned: bool,
+}
+
+impl Clone for Dma {
+    /// The clone shares the channel but does not own it, dropping it does not release the channel.
+    fn clone(&self) -> Self {
+        Dma {
+            ch: self.ch,
+            owned: false,
+        }
+    }
+}
+
+impl Dma {
+    /// Creates a handle for `ch` without claiming it, see `take()` and `request()`.
+    pub fn new(ch: DmaChannel) -> Self {
+        Dma { ch, owned: false }
+    }
+
+    /// Claims `ch` for exclusive use, released when the returned handle is dropped.
+    ///
+    /// # Returns
+    /// * `Err(-300)` if the channel is already taken.
+    pub fn take(ch: DmaChannel) -> Result<Self, i32> {
+        let bit = 1 << ch as u8;
+        if DMA_CH_TAKEN.fetch_or(bit, Ordering::AcqRel) & bit != 0 {
+            return Err(-300);
+        }
+
+        Ok(Dma { ch, owned: true })
+    }
+
+    /// Claims a free channel wired to the peripheral `request`, released when the returned
+    /// handle is dropped.
+    ///
+    /// Memory to memory requests take the highest free channel, leaving the low channels to
+    /// the peripherals.
+    ///
+    /// # Returns
+    /// * `Err(-300)` if all channels able to serve the request are taken.
+    /// * `Err(-301)` if the chip has no channel for the request.
+    pub fn request(request: DmaRequest) -> Result<Self, i32> {
+        let mask = ll_invoke_inner!(INVOKE_ID_DMA_REQUEST_CHANNELS, request);
+        if mask < 0 {
+            return Err(mask);
+        }
+        let mask = mask as u8;
+        if mask == 0 {
+            return Err(-301);
+        }
+
+        let mut taken = DMA_CH_TAKEN.load(Ordering::Acquire);
+        loop {
+            let free = mask & !taken;
+            if free == 0 {
+                return Err(-300);
+            }
+            let idx = if request == DmaRequest::Mem {
+                7 - free.leading_zeros()
+            } else {
+                free.trailing_zeros()
+            };
+            match DMA_CH_TAKEN.compare_exchange_weak(
+                taken,
+                taken | (1 << idx),
+                Ordering::AcqRel,
+                Ordering::Acquire,
+            ) {
+                Ok(_) => {
+                    return Ok(Dma {
+                        ch: DMA_CH_LIST[idx as usize],
+                        owned: true,
+                    })
+                }
+                Err(current) => taken = current,
+            }
+        }
+    }
+
+    /// Returns the channel of this handle.
+    pub fn channel(&self) -> DmaChannel {
+        self.ch
+    }
+
+    pub fn init<ST, DT>(&self, config: &Config<ST, DT>, extra: Option<u32>) -> Result<(), i32> {
+        let extra_flags = if let Some(extra) = extra { extra } else { 0 };
+        let param = config.build()?;
+        let result = ll_invoke_inner!(
+            INVOKE_ID_DMA_INIT,
+            self.ch,
+            param.src_addr,
+            param.src_buff_size,
+            param.dst_addr,
+            param.dst_buff_size,
+            param.flags,
+            extra_flags
+        );
+        if result == 0 {
+            Ok(())
+        } else {
+            Err(result)
+        }
+    }
+
+    pub fn start(&self) -> Result<(), i32> {
+        self.state().events.store(0, Ordering::Release);
+        let result = ll_invoke_inner!(INVOKE_ID_DMA_CTRL, self.ch, DmaCtrl::Start, 0);
+        if result == 0 {
+            Ok(())
+        } else {
+            Err(result)
+        }
+    }
+
+    /// Re-arms the channel with new addresses and transfer count and starts it.
+    ///
+    /// Only the address and count registers are rewritten, direction, data size, increment
+    /// and circular mode stay as set by `init()`, so this is cheap enough for small and
+    /// frequent transfers.
+    ///
+    /// # Arguments
+    /// * `src` - Source address, memory or peripheral register as given to `init()`.
+    /// * `dst` - Destination address.
+    /// * `count` - Number of data items to transfer, 1..=65535.
+    pub fn reload(&self, src: usize, dst: usize, count: usize) -> Result<(), i32> {
+        self.state().events.store(0, Ordering::Release);
+        let result = ll_invoke_inner!(INVOKE_ID_DMA_RELOAD, self.ch, src, dst, count);
+        if result == 0 {
+            Ok(())
+        } else {
+            Err(result)
+        }
+    }
+
+    pub fn stop(&self) -> Result<(), i32> {
+        let result = ll_invoke_inner!(INVOKE_ID_DMA_CTRL, self.ch, DmaCtrl::Stop, 0);
+        if result == 0 {
+            Ok(())
+        } else {
+            Err(result)
+        }
+    }
+
+    pub fn wait(&self) -> Result<(), i32> {
+        let result = ll_invoke_inner!(INVOKE_ID_DMA_CTRL, self.ch, DmaCtrl::Wait, 0);
+        if result == 0 {
+            Ok(())
+        } else {
+            Err(result)
+        }
+    }
+
+    /// Calls `callback` from the DMA interrupt when the transfer completes or fails.
+    ///
+    /// # Arguments
+    /// * `callback` - Runs in interrupt context, keep it short.
+    pub fn on_complete(&self, callback: fn(DmaEvent)) -> Result<(), i32> {
+        self.on_event(callback, false)
+    }
+
+    /// Calls `callback` from the DMA interrupt on transfer complete and error,
+    /// and on half transfer too when `half` is true, e.g. for circular buffers.
+    ///
+    /// # Arguments
+    /// * `callback` - Runs in interrupt context, keep it short.
+    /// * `half` - Also report the half transfer event.
+    pub fn on_event(&self, callback: fn(DmaEvent), half: bool) -> Result<(), i32> {
+        let mut mask = DmaIrq::Complete as u8 | DmaIrq::Error as u8;
+        if half {
+            mask |= DmaIrq::Half as u8;
+        }
+        self.state()
+            .callback
+            .store(callback as *mut (), Ordering::Release);
+        self.irq_enable(mask)
+    }
+
+    /// Removes the callback and disables the channel interrupt.
+    pub fn remove_callback(&self) -> Result<(), i32> {
+        let result = self.irq_enable(0);
+        self.state()
+            .callback
+            .store(core::ptr::null_mut(), Ordering::Release);
+        result
+    }
+
+    /// Waits for the transfer started by `start()` to complete, without blocking the executor.
+    ///
+    /// Enables the transfer complete and error interrupts of the channel, returns `Err(-4)`
+    /// on a transfer error.
+    #[cfg(feature = "embassy")]
+    pub async fn async_wait(&self) -> Result<(), i32> {
+        let state = self.state();
+        let mask = state.irq_mask.load(Ordering::Relaxed);
+        let wanted = mask | DmaIrq::Complete as u8 | DmaIrq::Error as u8;
+        if wanted != mask {
+            self.irq_enable(wanted)?;
+        }
+
+        core::future::poll_fn(|cx| {
+            state.waker.register(cx.waker());
+            let events = state.events.load(Ordering::Acquire);
+            if events & DmaIrq::Error as u8 != 0 {
+                core::task::Poll::Ready(Err(-4))
+            } else if events & DmaIrq::Complete as u8 != 0 {
+                core::task::Poll::Ready(Ok(()))
+            } else {
+                core::task::Poll::Pending
+            }
+        })
+        .await
+    }
+
+    fn state(&self) -> &'static DmaChState {
+        &DMA_CH_STATE[self.ch as usize]
+    }
+
+    pub(crate) fn irq_enable(&self, mask: u8) -> Result<(), i32> {
+        self.state().irq_mask.store(mask, Ordering::Relaxed);
+        let result = ll_invoke_inner!(INVOKE_ID_DMA_CTRL, self.ch, DmaCtrl::Irq, mask);
+        if result == 0 {
+            Ok(())
+        } else {
+            Err(result)
+        }
+    }
+}
+
+/// Stops the channel when dropped, keeps a cancelled async transfer from writing into a
+/// released buffer.
+#[cfg(feature = "embassy")]
+pub(crate) struct DmaStopGuard<'a>(pub(crate) &'a Dma);
+
+#[cfg(feature = "embassy")]
+impl Drop for DmaStopGuard<'_> {
+    fn drop(&mut self) {
+        let _ = self.0.stop();
+    }
+}
+
+/// An owning handle stops the channel and removes its callback before releasing it, the next
+/// owner starts clean. Clones and `Dma::new()` handles leave the channel alone.
+impl Drop for Dma {
+    fn drop(&mut self) {
+        if self.owned {
+            ll_invoke_inner!(INVOKE_ID_DMA_DEINIT, self.ch);
+            let state = self.state();
+            state
+                .callback
+                .store(core::ptr::null_mut(), Ordering::Release);
+            state.irq_mask.store(0, Ordering::Relaxed);
+            DMA_CH_TAKEN.fetch_and(!(1 << self.ch as u8), Ordering::AcqRel);
+        }
+    }
+}
+
+fn dma_irq(ch: usize, flags: u32) {
+    let state = &DMA_CH_STATE[ch];
+    let blocks =
+        (flags & DmaIrq::Half as u32 != 0) as u32 + (flags & DmaIrq::Complete as u32 != 0) as u32;
+    if blocks != 0 {
+        state.blocks.fetch_add(blocks, Ordering::Release);
+    }
+    if flags & DmaIrq::Complete as u32 != 0 {
+        state.laps.fetch_add(1, Ordering::Release);
+    }
+    state.events.fetch_or(flags as u8, Ordering::Release);
+
+    let callback = state.callback.load(Ordering::Acquire);
+    if !callback.is_null() {
+        let callback: fn(DmaEvent) = unsafe { core::mem::transmute(callback) };
+        callback(DmaEvent(flags as u8));
+    }
+
+    #[cfg(feature = "embassy")]
+    state.waker.wake();
+}
+
+macro_rules! impl_dma_hook {
+    ($($ch:literal),*) => {
+        $(
+            paste::paste! {
+                #[allow(non_snake_case)]
+                #[no_mangle]
+                unsafe extern "C" fn [<DMA_CH $ch _hook_rs>] (flags: u32) {//fn: DMA_CH{ch}_hook_rs(flags)
+                    dma_irq($ch, flags);
+                }
+            }
+        )*
+    };
+}
+
+impl_dma_hook!(0, 1, 2, 3, 4, 5, 6, 7);
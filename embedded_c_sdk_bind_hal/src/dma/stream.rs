@@ -0,0 +1,404 @@
+use super::{Config, Dma, DmaChState, DmaDataSize, DmaDir, DmaDst, DmaSrc};
+use crate::ll_api::{ll_cmd::*, DmaCtrl, DmaIrq};
+use core::cell::Cell;
+use core::ops::Deref;
+use portable_atomic::Ordering;
+
+#[derive(Debug, PartialEq, Eq, Clone, Copy)]
+pub enum DmaStreamError {
+    /// At least one block was overwritten before it was read, the stream skipped to the newest block.
+    Overrun,
+    /// Transfer error, the channel is stopped by hardware.
+    Transfer,
+    /// A `DmaTxStream` block was not refilled in time and the DMA sent it again, the stream
+    /// skipped to the block after the one being sent.
+    Underrun,
+}
+
+/// Continuous peripheral to memory transfer into a double buffer.
+///
+/// The channel runs in circular mode over both halves of `buf`. The half transfer and transfer
+/// complete interrupts mark a half as done, `read()` hands it out as a `&[T; N]` while the DMA
+/// fills the other half, so no sample is copied and there is no gap between blocks.
+///
+/// ```ignore
+/// static mut BUF: [[u16; 64]; 2] = [[0; 64]; 2];
+/// let mut stream = DmaStream::new(Dma::request(DmaRequest::Adc1)?, ADC1_RDATAR, unsafe { &mut *addr_of_mut!(BUF) })?;
+/// stream.start()?;
+/// loop {
+///     if let Ok(block) = nb::block!(stream.read()) {
+///         process(&block);
+///     }
+/// }
+/// ```
+pub struct DmaStream<T: DmaDataSize + 'static, const N: usize> {
+    dma: Dma,
+    buf: &'static mut [[T; N]; 2],
+    read: u32,
+}
+
+impl<T: DmaDataSize + 'static, const N: usize> DmaStream<T, N> {
+    /// Sets up `dma` to copy from the peripheral register at `src_addr` into `buf`.
+    ///
+    /// # Arguments
+    /// * `dma` - A channel wired to the peripheral request, e.g. from `Dma::request()`.
+    /// * `src_addr` - Peripheral data register, read with the width of `T`.
+    /// * `buf` - Two blocks of `N` items, 2 * N must not exceed 65535.
+    pub fn new(dma: Dma, src_addr: usize, buf: &'static mut [[T; N]; 2]) -> Result<Self, i32> {
+        {
+            let flat =
+                unsafe { core::slice::from_raw_parts_mut(buf.as_mut_ptr() as *mut T, 2 * N) };
+            let config: Config<T, T> =
+                Config::new(DmaSrc::Addr(src_addr), DmaDst::Ref(flat), DmaDir::P2M, true);
+            dma.init(&config, None)?;
+        }
+        dma.irq_enable(DmaIrq::Complete as u8 | DmaIrq::Half as u8 | DmaIrq::Error as u8)?;
+
+        Ok(DmaStream { dma, buf, read: 0 })
+    }
+
+    /// Starts streaming from the first half of the buffer.
+    pub fn start(&mut self) -> Result<(), i32> {
+        self.read = 0;
+        self.dma.state().blocks.store(0, Ordering::Release);
+        self.dma.start()
+    }
+
+    pub fn stop(&mut self) -> Result<(), i32> {
+        self.dma.stop()
+    }
+
+    /// Returns the oldest filled block which has not been read yet.
+    ///
+    /// # Returns
+    /// * `WouldBlock` if the DMA is still filling the next block.
+    /// * `DmaStreamError::Overrun` if blocks were lost, the next `read()` returns the newest block.
+    pub fn read(&mut self) -> nb::Result<DmaBlock<'_, T, N>, DmaStreamError> {
+        let state = self.dma.state();
+        if state.events.load(Ordering::Acquire) & DmaIrq::Error as u8 != 0 {
+            return Err(nb::Error::Other(DmaStreamError::Transfer));
+        }
+
+        let done = state.blocks.load(Ordering::Acquire);
+        match done.wrapping_sub(self.read) {
+            0 => Err(nb::Error::WouldBlock),
+            1 => {
+                let data = &self.buf[(self.read & 1) as usize];
+                self.read = done;
+                Ok(DmaBlock {
+                    data,
+                    state,
+                    seq: done,
+                })
+            }
+            _ => {
+                self.read = done.wrapping_sub(1);
+                Err(nb::Error::Other(DmaStreamError::Overrun))
+            }
+        }
+    }
+
+    /// Waits for the next filled block without blocking the executor.
+    #[cfg(feature = "embassy")]
+    pub async fn async_read(&mut self) -> Result<DmaBlock<'_, T, N>, DmaStreamError> {
+        let state = self.dma.state();
+        let read = self.read;
+        core::future::poll_fn(|cx| {
+            state.waker.register(cx.waker());
+            if state.blocks.load(Ordering::Acquire) != read
+                || state.events.load(Ordering::Acquire) & DmaIrq::Error as u8 != 0
+            {
+                core::task::Poll::Ready(())
+            } else {
+                core::task::Poll::Pending
+            }
+        })
+        .await;
+
+        match self.read() {
+            Ok(block) => Ok(block),
+            Err(nb::Error::Other(err)) => Err(err),
+            Err(nb::Error::WouldBlock) => unreachable!(),
+        }
+    }
+}
+
+impl<T: DmaDataSize + 'static, const N: usize> Drop for DmaStream<T, N> {
+    fn drop(&mut self) {
+        let _ = self.dma.stop();
+        let _ = self.dma.irq_enable(0);
+    }
+}
+
+/// Continuous memory to peripheral transfer from a double buffer, the counterpart of
+/// `DmaStream`.
+///
+/// The channel runs in circular mode over both halves of `buf`. Both halves are filled through
+/// `buf_mut()` before `start()`, then `write()` hands out each half the DMA has finished sending
+/// so it can be refilled while the DMA sends the other half.
+pub struct DmaTxStream<T: DmaDataSize + 'static, const N: usize> {
+    dma: Dma,
+    buf: &'static mut [[T; N]; 2],
+    written: u32,
+}
+
+impl<T: DmaDataSize + 'static, const N: usize> DmaTxStream<T, N> {
+    /// Sets up `dma` to copy from `buf` into the peripheral register at `dst_addr`.
+    ///
+    /// # Arguments
+    /// * `dma` - A channel wired to the peripheral request, e.g. from `Dma::request()`.
+    /// * `dst_addr` - Peripheral data register, written with the width of `T`.
+    /// * `buf` - Two blocks of `N` items, 2 * N must not exceed 65535.
+    pub fn new(dma: Dma, dst_addr: usize, buf: &'static mut [[T; N]; 2]) -> Result<Self, i32> {
+        {
+            let flat = unsafe { core::slice::from_raw_parts(buf.as_ptr() as *const T, 2 * N) };
+            let config: Config<T, T> =
+                Config::new(DmaSrc::Ref(flat), DmaDst::Addr(dst_addr), DmaDir::M2P, true);
+            dma.init(&config, None)?;
+        }
+        dma.irq_enable(DmaIrq::Complete as u8 | DmaIrq::Half as u8 | DmaIrq::Error as u8)?;
+
+        Ok(DmaTxStream {
+            dma,
+            buf,
+            written: 2,
+        })
+    }
+
+    /// Both halves, to fill before `start()`.
+    pub fn buf_mut(&mut self) -> &mut [[T; N]; 2] {
+        self.buf
+    }
+
+    /// Starts sending from the first half of the buffer.
+    pub fn start(&mut self) -> Result<(), i32> {
+        self.written = 2;
+        self.dma.state().blocks.store(0, Ordering::Release);
+        self.dma.start()
+    }
+
+    pub fn stop(&mut self) -> Result<(), i32> {
+        self.dma.stop()
+    }
+
+    /// Returns the number of blocks sent since `start()`.
+    pub fn sent(&self) -> u32 {
+        self.dma.state().blocks.load(Ordering::Acquire)
+    }
+
+    /// Returns the half the DMA sends after the current one, to be refilled before the current
+    /// one is done.
+    ///
+    /// # Returns
+    /// * `WouldBlock` while both halves are still queued.
+    /// * `DmaStreamError::Underrun` if a half was sent twice, the next `write()` returns the
+    ///   half after the one being sent.
+    pub fn write(&mut self) -> nb::Result<&mut [T; N], DmaStreamError> {
+        let state = self.dma.state();
+        if state.events.load(Ordering::Acquire) & DmaIrq::Error as u8 != 0 {
+            return Err(nb::Error::Other(DmaStreamError::Transfer));
+        }
+
+        let sent = state.blocks.load(Ordering::Acquire);
+        match sent.wrapping_add(2).wrapping_sub(self.written) {
+            0 => Err(nb::Error::WouldBlock),
+            1 => {
+                let idx = (self.written & 1) as usize;
+                self.written = self.written.wrapping_add(1);
+                Ok(&mut self.buf[idx])
+            }
+            _ => {
+                self.written = sent.wrapping_add(1);
+                Err(nb::Error::Other(DmaStreamError::Underrun))
+            }
+        }
+    }
+
+    /// Waits for a free half without blocking the executor, see `write()`.
+    #[cfg(feature = "embassy")]
+    pub async fn async_write(&mut self) -> Result<&mut [T; N], DmaStreamError> {
+        let state = self.dma.state();
+        let written = self.written;
+        core::future::poll_fn(|cx| {
+            state.waker.register(cx.waker());
+            if state
+                .blocks
+                .load(Ordering::Acquire)
+                .wrapping_add(2)
+                .wrapping_sub(written)
+                != 0
+                || state.events.load(Ordering::Acquire) & DmaIrq::Error as u8 != 0
+            {
+                core::task::Poll::Ready(())
+            } else {
+                core::task::Poll::Pending
+            }
+        })
+        .await;
+
+        match self.write() {
+            Ok(block) => Ok(block),
+            Err(nb::Error::Other(err)) => Err(err),
+            Err(nb::Error::WouldBlock) => unreachable!(),
+        }
+    }
+}
+
+impl<T: DmaDataSize + 'static, const N: usize> Drop for DmaTxStream<T, N> {
+    fn drop(&mut self) {
+        let _ = self.dma.stop();
+        let _ = self.dma.irq_enable(0);
+    }
+}
+
+/// Continuous peripheral to memory transfer into a ring, read item by item.
+///
+/// Unlike `DmaStream` an item can be read as soon as the DMA has moved it. The write position
+/// comes from the transfer counter and the laps from the transfer complete interrupt, items
+/// are numbered from `start()` on and wrap after 2^32 items.
+pub struct DmaRing<T: DmaDataSize + Copy + 'static, const N: usize> {
+    dma: Dma,
+    buf: &'static mut [T; N],
+    last: Cell<u32>,
+}
+
+impl<T: DmaDataSize + Copy + 'static, const N: usize> DmaRing<T, N> {
+    /// Sets up `dma` to copy from the peripheral register at `src_addr` into `buf`.
+    ///
+    /// # Arguments
+    /// * `dma` - A channel wired to the peripheral request, e.g. from `Dma::request()`.
+    /// * `src_addr` - Peripheral data register, read with the width of `T`.
+    /// * `buf` - The ring, `N` must be a power of two up to 32768.
+    pub fn new(dma: Dma, src_addr: usize, buf: &'static mut [T; N]) -> Result<Self, i32> {
+        if !N.is_power_of_two() || N > 32768 {
+            return Err(-10);
+        }
+        {
+            let config: Config<T, T> = Config::new(
+                DmaSrc::Addr(src_addr),
+                DmaDst::Ref(&mut buf[..]),
+                DmaDir::P2M,
+                true,
+            );
+            dma.init(&config, None)?;
+        }
+        dma.irq_enable(DmaIrq::Complete as u8 | DmaIrq::Error as u8)?;
+
+        Ok(DmaRing {
+            dma,
+            buf,
+            last: Cell::new(0),
+        })
+    }
+
+    /// Starts writing at item 0.
+    pub fn start(&mut self) -> Result<(), i32> {
+        self.last.set(0);
+        self.dma.state().laps.store(0, Ordering::Release);
+        self.dma.start()
+    }
+
+    pub fn stop(&mut self) -> Result<(), i32> {
+        self.dma.stop()
+    }
+
+    /// Returns the number of items written since `start()`.
+    ///
+    /// Must not be called with interrupts disabled, a pending lap would be missed.
+    pub fn written(&self) -> u32 {
+        let state = self.dma.state();
+        loop {
+            let laps = state.laps.load(Ordering::Acquire);
+            let left = ll_invoke_inner!(INVOKE_ID_DMA_CTRL, self.dma.ch, DmaCtrl::GetCount, 0);
+            if state.laps.load(Ordering::Acquire) == laps {
+                let written = ring_written(N as u32, laps, left as u32, self.last.get());
+                self.last.set(written);
+                return written;
+            }
+        }
+    }
+
+    /// Returns item `idx`. It is valid if `written() - idx` is in `1..=N` before and after the
+    /// read.
+    pub fn item(&self, idx: u32) -> T {
+        let ptr = &self.buf[idx as usize & (N - 1)] as *const T;
+        unsafe { core::ptr::read_volatile(ptr) }
+    }
+
+    /// True if the DMA stopped on a transfer error.
+    pub fn is_error(&self) -> bool {
+        self.dma.state().events.load(Ordering::Acquire) & DmaIrq::Error as u8 != 0
+    }
+}
+
+impl<T: DmaDataSize + Copy + 'static, const N: usize> Drop for DmaRing<T, N> {
+    fn drop(&mut self) {
+        let _ = self.dma.stop();
+        let _ = self.dma.irq_enable(0);
+    }
+}
+
+/// Items written into a ring of `n` items after `laps` transfer complete interrupts with the
+/// counter at `left`, not less than `last` returned before.
+fn ring_written(n: u32, laps: u32, left: u32, last: u32) -> u32 {
+    let pos = n.wrapping_sub(left) & (n - 1);
+    let written = laps.wrapping_mul(n).wrapping_add(pos);
+    //the counter reloaded but the lap interrupt did not run yet
+    if (written.wrapping_sub(last) as i32) < 0 {
+        written.wrapping_add(n)
+    } else {
+        written
+    }
+}
+
+/// A filled half of a `DmaStream` buffer, the DMA writes the other half meanwhile.
+pub struct DmaBlock<'a, T, const N: usize> {
+    data: &'a [T; N],
+    state: &'static DmaChState,
+    seq: u32,
+}
+
+impl<T, const N: usize> DmaBlock<'_, T, N> {
+    /// True if the DMA has started to overwrite this block, i.e. it was held longer than
+    /// one block time and the data may be torn.
+    pub fn is_overrun(&self) -> bool {
+        self.state.blocks.load(Ordering::Acquire) != self.seq
+    }
+}
+
+impl<T, const N: usize> Deref for DmaBlock<'_, T, N> {
+    type Target = [T; N];
+
+    fn deref(&self) -> &Self::Target {
+        self.data
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::dma::{dma_irq, DMA_CH_STATE};
+
+    #[test]
+    fn ring_written_counts_laps() {
+        const N: u32 = 8;
+        const CH: usize = 7;
+        let state = &DMA_CH_STATE[CH];
+        state.laps.store(0, Ordering::Release);
+        let mut last = 0;
+        for item in 1..=5 * N {
+            //the counter reloads at the end of a lap, the irq runs at the next item
+            let left = N - item % N;
+            let laps = state.laps.load(Ordering::Acquire);
+            last = ring_written(N, laps, left, last);
+            assert_eq!(last, item);
+            if item % N == N / 2 {
+                dma_irq(CH, DmaIrq::Half as u32);
+            }
+            if item % N == 0 {
+                dma_irq(CH, DmaIrq::Complete as u32 | DmaIrq::Half as u32);
+            }
+        }
+        assert_eq!(state.laps.load(Ordering::Acquire), 5);
+    }
+}
@@ -13,6 +13,7 @@ pub mod print;
 pub mod pwm;
 pub mod spi;
 pub mod tick;
+pub mod timer;
 pub mod usart;
 
 pub use common::format;
@@ -21,6 +22,9 @@ pub use ll_api::ll_cmd::*;
 #[cfg(feature = "print-log-csdk")]
 pub use embedded_c_sdk_bind_print_macros::{print, println};
 
+#[cfg(all(feature = "defmt", feature = "print-log"))]
+compile_error!("`defmt` and `print-log` share the log UART, enable only one of them");
+
 #[macro_export]
 macro_rules! ll_invoke {
     ( $( $x:expr ),* ) => {
@@ -1,3 +1,24 @@
+//LOG
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+#[repr(u32)]
+pub(crate) enum LogCtrl {
+    Flush = 0,
+    SetPolicy = 1,
+    GetDropped = 2,
+}
+
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+#[repr(u32)]
+/// What the log buffer does when a message does not fit
+pub enum LogPolicy {
+    /// Keep the buffered output, drop a message that does not fit whole
+    DropNew = 0,
+    /// Overwrite the oldest buffered output
+    DropOld = 1,
+    /// Wait until the output fits, sending from the caller's context
+    Block = 2,
+}
+
 //GPIO
 #[derive(Clone, Copy, PartialEq, Eq, Debug)]
 #[repr(u8)]
@@ -175,6 +196,16 @@ pub enum UsartHwFlowCtrl {
     CtsRts = 192,
 }
 
+#[derive(Clone, Copy, PartialEq, Eq, Debug)]
+#[repr(u32)]
+/// Pattern measured by autobaud
+pub enum UsartAutobaud {
+    /// Sync char 0x55 ('U'), timed over 8 bits
+    Sync0x55 = 0,
+    /// Start bit width, any char with bit0 = 1
+    StartBit = 1,
+}
+
 //PWM
 #[derive(Clone, Copy, PartialEq, Eq, Debug)]
 #[repr(u8)]
@@ -199,6 +230,9 @@ pub enum PwmCtrl {
     GetMaxDuty = 4,
     SetPeriod = 5,
     GetPeriod = 6,
+    DmaOn = 7,
+    DmaOff = 8,
+    GetDmaReq = 9,
 }
 
 #[derive(Clone, Copy, Debug, PartialEq, Eq)]
@@ -208,6 +242,18 @@ pub enum PwmPolarity {
     ActiveLow = 11,
 }
 
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+#[repr(u32)]
+pub(crate) enum MotorCtrl {
+    Enable = 0,
+    Disable = 1,
+    GetStatus = 2,
+    UpdateIrq = 3,
+    SampleDelay = 4,
+    Polarity = 5,
+    GetMaxDuty = 6,
+}
+
 //ADC
 #[derive(Clone, Copy, PartialEq, Eq, Debug)]
 #[repr(u8)]
@@ -227,6 +273,62 @@ pub enum AdcCtrl {
     Start = 0,
     Stop = 1,
     Convert = 2,
+    SetRate = 3,
+}
+
+/// Analog inputs of the chip for scan mode, `In0..In15` are the ADC_IN pins.
+#[derive(Clone, Copy, PartialEq, Eq, Debug)]
+#[repr(u8)]
+pub enum AdcInput {
+    In0,
+    In1,
+    In2,
+    In3,
+    In4,
+    In5,
+    In6,
+    In7,
+    In8,
+    In9,
+    In10,
+    In11,
+    In12,
+    In13,
+    In14,
+    In15,
+    Temp,
+    Vref,
+}
+
+/// Sample time in ADC clock cycles.
+#[derive(Clone, Copy, PartialEq, Eq, Debug)]
+#[repr(u32)]
+pub enum AdcSampleTime {
+    Cycles1_5 = 0,
+    Cycles7_5 = 1,
+    Cycles13_5 = 2,
+    Cycles28_5 = 3,
+    Cycles41_5 = 4,
+    Cycles55_5 = 5,
+    Cycles71_5 = 6,
+    Cycles239_5 = 7,
+}
+
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+#[repr(u32)]
+pub(crate) enum AdcScanCtrl {
+    OneShot = 0,
+    Continuous = 1,
+    Stop = 2,
+    SetRate = 3,
+}
+
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+#[repr(u32)]
+pub(crate) enum AdcWatchdogCtrl {
+    Set = 0,
+    Arm = 1,
+    Disable = 2,
 }
 
 //I2C BUS
@@ -260,12 +362,53 @@ pub enum DmaChannel {
     CH7,
 }
 
+/// Peripheral DMA requests, `Dma::request()` picks a free channel wired to the request.
+#[derive(Clone, Copy, PartialEq, Eq, Debug)]
+#[repr(u8)]
+pub enum DmaRequest {
+    /// Memory to memory, any channel.
+    Mem,
+    Adc1,
+    Spi1Rx,
+    Spi1Tx,
+    Spi2Rx,
+    Spi2Tx,
+    Usart1Rx,
+    Usart1Tx,
+    Usart2Rx,
+    Usart2Tx,
+    Usart3Rx,
+    Usart3Tx,
+    I2c1Rx,
+    I2c1Tx,
+    I2c2Rx,
+    I2c2Tx,
+    Tim1Up,
+    Tim2Up,
+    Tim3Up,
+    Tim4Up,
+    Tim1Ch1,
+    Tim2Ch1,
+    Tim3Ch1,
+    Tim4Ch1,
+}
+
 #[derive(Clone, Copy, Debug, PartialEq, Eq)]
 #[repr(u32)]
 pub(crate) enum DmaCtrl {
     Start = 0,
     Stop = 1,
     Wait = 2,
+    Irq = 3,
+    GetCount = 4,
+}
+
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+#[repr(u8)]
+pub(crate) enum DmaIrq {
+    Complete = 0x02,
+    Half = 0x04,
+    Error = 0x08,
 }
 
 #[derive(Clone, Copy, Debug, PartialEq, Eq)]
@@ -294,6 +437,42 @@ pub(crate) enum DmaFlags {
     CircularOn = 1 << 8,
 }
 
+//TIM
+/// General purpose and advanced timers, used exclusively by one timer driver at a time.
+#[derive(Clone, Copy, PartialEq, Eq, Debug)]
+#[repr(u8)]
+pub enum Tim {
+    Tim1,
+    Tim2,
+    Tim3,
+    Tim4,
+}
+
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+#[repr(u32)]
+pub(crate) enum CaptureCtrl {
+    Start = 0,
+    Stop = 1,
+    ReadPwm = 2,
+    EdgeIrq = 3,
+}
+
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+#[repr(u32)]
+pub(crate) enum EncoderCtrl {
+    Read = 0,
+    Set = 1,
+    GetClock = 2,
+}
+
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+#[repr(u32)]
+pub(crate) enum HwTimerCtrl {
+    Now = 0,
+    SetAlarm = 1,
+    Cancel = 2,
+}
+
 pub mod ll_cmd {
     //INVOKE
     pub type InvokeParam = ::core::ffi::c_uint;
@@ -303,6 +482,8 @@ pub mod ll_cmd {
     pub const INVOKE_ID_DELAY_NANO: InvokeParam = 201;
     pub const INVOKE_ID_LOG_PUTS: InvokeParam = 202;
     pub const INVOKE_ID_LOG_PRINT: InvokeParam = 203;
+    pub const INVOKE_ID_LOG_CTRL: InvokeParam = 204;
+    pub const INVOKE_ID_LOG_PUT_FRAME: InvokeParam = 205;
     pub const INVOKE_ID_GPIO_INIT: InvokeParam = 300;
     pub const INVOKE_ID_GPIO_SET: InvokeParam = 301;
     pub const INVOKE_ID_GPIO_GET_INPUT: InvokeParam = 302;
@@ -317,14 +498,26 @@ pub mod ll_cmd {
     pub const INVOKE_ID_USART_INIT: InvokeParam = 500;
     pub const INVOKE_ID_USART_DEINIT: InvokeParam = 501;
     pub const INVOKE_ID_USART_WRITE: InvokeParam = 502;
+    pub const INVOKE_ID_USART_SET_BAUDRATE: InvokeParam = 503;
+    pub const INVOKE_ID_USART_AUTOBAUD: InvokeParam = 504;
     pub const INVOKE_ID_USART_CUSTOM_BASE: InvokeParam = 550;
     pub const INVOKE_ID_PWM_INIT: InvokeParam = 600;
     pub const INVOKE_ID_PWM_DEINIT: InvokeParam = 601;
     pub const INVOKE_ID_PWM_CTRL: InvokeParam = 602;
+    pub const INVOKE_ID_PWM_MOTOR_INIT: InvokeParam = 603;
+    pub const INVOKE_ID_PWM_MOTOR_DEINIT: InvokeParam = 604;
+    pub const INVOKE_ID_PWM_MOTOR_CTRL: InvokeParam = 605;
     pub const INVOKE_ID_PWM_CUSTOM_BASE: InvokeParam = 650;
     pub const INVOKE_ID_ADC_INIT: InvokeParam = 700;
     pub const INVOKE_ID_ADC_DEINIT: InvokeParam = 701;
     pub const INVOKE_ID_ADC_CTRL: InvokeParam = 702;
+    pub const INVOKE_ID_ADC_SCAN_INIT: InvokeParam = 703;
+    pub const INVOKE_ID_ADC_SCAN_CTRL: InvokeParam = 704;
+    pub const INVOKE_ID_ADC_DUAL_INIT: InvokeParam = 705;
+    pub const INVOKE_ID_ADC_INJECT_START: InvokeParam = 706;
+    pub const INVOKE_ID_ADC_INJECT_READ: InvokeParam = 707;
+    pub const INVOKE_ID_ADC_WATCHDOG: InvokeParam = 708;
+    pub const INVOKE_ID_ADC_GET_CALIBRATION: InvokeParam = 709;
     pub const INVOKE_ID_ADC_CUSTOM_BASE: InvokeParam = 750;
     pub const INVOKE_ID_I2C_INIT: InvokeParam = 800;
     pub const INVOKE_ID_I2C_DEINIT: InvokeParam = 801;
@@ -335,6 +528,19 @@ pub mod ll_cmd {
     pub const INVOKE_ID_DMA_INIT: InvokeParam = 900;
     pub const INVOKE_ID_DMA_DEINIT: InvokeParam = 901;
     pub const INVOKE_ID_DMA_CTRL: InvokeParam = 902;
+    pub const INVOKE_ID_DMA_RELOAD: InvokeParam = 903;
+    pub const INVOKE_ID_DMA_REQUEST_CHANNELS: InvokeParam = 904;
+    pub const INVOKE_ID_DMA_CHAIN_START: InvokeParam = 905;
+    pub const INVOKE_ID_TIM_CAPTURE_INIT: InvokeParam = 1000;
+    pub const INVOKE_ID_TIM_CAPTURE_DEINIT: InvokeParam = 1001;
+    pub const INVOKE_ID_TIM_CAPTURE_CTRL: InvokeParam = 1002;
+    pub const INVOKE_ID_TIM_ENCODER_INIT: InvokeParam = 1003;
+    pub const INVOKE_ID_TIM_ENCODER_DEINIT: InvokeParam = 1004;
+    pub const INVOKE_ID_TIM_ENCODER_CTRL: InvokeParam = 1005;
+    pub const INVOKE_ID_TIM_HWTIMER_INIT: InvokeParam = 1006;
+    pub const INVOKE_ID_TIM_HWTIMER_DEINIT: InvokeParam = 1007;
+    pub const INVOKE_ID_TIM_HWTIMER_CTRL: InvokeParam = 1008;
+    pub const INVOKE_ID_TIM_CUSTOM_BASE: InvokeParam = 1050;
 
     //For user custom
     pub const INVOKE_ID_DEV_CUSTOM_BASE: InvokeParam = 10_000;
@@ -1,4 +1,6 @@
 use crate::ll_api::ll_cmd::*;
+use crate::ll_api::LogCtrl;
+pub use crate::ll_api::LogPolicy;
 
 #[cfg(all(feature = "print-log", not(feature = "print-log-csdk")))]
 #[macro_export]
@@ -34,6 +36,27 @@ macro_rules! print {
     ($($arg:tt)*) => {{}};
 }
 
+/// Sends out everything left in the log buffer, blocking until the last char is on the wire.
+///
+/// Log output is queued and sent by the UART interrupt, call this before a reset or
+/// from a panic handler so the last messages are not lost.
+pub fn log_flush() {
+    ll_invoke_inner!(INVOKE_ID_LOG_CTRL, LogCtrl::Flush, 0);
+}
+
+/// Sets what happens when the log buffer is full, default is `LogPolicy::DropNew`.
+///
+/// # Arguments
+/// * `policy` - The overflow policy.
+pub fn set_log_policy(policy: LogPolicy) {
+    ll_invoke_inner!(INVOKE_ID_LOG_CTRL, LogCtrl::SetPolicy, policy);
+}
+
+/// Returns the number of log chars dropped so far because the buffer was full.
+pub fn log_dropped() -> u32 {
+    ll_invoke_inner!(INVOKE_ID_LOG_CTRL, LogCtrl::GetDropped, 0) as u32
+}
+
 pub struct Printer;
 
 impl core::fmt::Write for Printer {
@@ -44,3 +67,233 @@ impl core::fmt::Write for Printer {
         Ok(())
     }
 }
+
+/// Frame encoder behind print!/println! with the `print-log-interned` feature.
+///
+/// A frame is `END id args.. END` with SLIP escaping. The id is the address of the format
+/// string in the `.csdk_log_str` section, ints are LEB128 varints (`%d` zigzag first),
+/// strings and arrays are a varint length followed by the bytes. The frame is encoded
+/// with interrupts enabled into a scratch buffer on the stack of the caller, then queued
+/// whole by the log buffer, so frames from ISRs do not interleave with it. Frames longer
+/// than 128 bytes or not fitting in the log buffer are dropped whole.
+/// Decode on the host with `print-macros/tools/csdk_log_decode.py`.
+#[cfg(feature = "print-log-interned")]
+#[doc(hidden)]
+pub struct LogFrame {
+    buf: [u8; 128],
+    len: usize,
+    overflow: bool,
+}
+
+#[cfg(feature = "print-log-interned")]
+impl LogFrame {
+    const END: u8 = 0xC0;
+    const ESC: u8 = 0xDB;
+    const ESC_END: u8 = 0xDC;
+    const ESC_ESC: u8 = 0xDD;
+
+    pub fn new(id: u32) -> Self {
+        let mut frame = LogFrame {
+            buf: [0; 128],
+            len: 0,
+            overflow: false,
+        };
+        frame.raw(Self::END);
+        frame.uint(id);
+        frame
+    }
+
+    fn raw(&mut self, byte: u8) {
+        if self.len == self.buf.len() {
+            self.overflow = true;
+            return;
+        }
+        self.buf[self.len] = byte;
+        self.len += 1;
+    }
+
+    fn put(&mut self, byte: u8) {
+        match byte {
+            Self::END => {
+                self.raw(Self::ESC);
+                self.raw(Self::ESC_END);
+            }
+            Self::ESC => {
+                self.raw(Self::ESC);
+                self.raw(Self::ESC_ESC);
+            }
+            _ => self.raw(byte),
+        }
+    }
+
+    pub fn uint(&mut self, mut val: u32) {
+        while val >= 0x80 {
+            self.put(val as u8 | 0x80);
+            val >>= 7;
+        }
+        self.put(val as u8);
+    }
+
+    pub fn int(&mut self, val: i32) {
+        self.uint(((val << 1) ^ (val >> 31)) as u32);
+    }
+
+    pub fn uint64(&mut self, mut val: u64) {
+        while val >= 0x80 {
+            self.put(val as u8 | 0x80);
+            val >>= 7;
+        }
+        self.put(val as u8);
+    }
+
+    pub fn int64(&mut self, val: i64) {
+        self.uint64(((val << 1) ^ (val >> 63)) as u64);
+    }
+
+    pub fn bytes(&mut self, ptr: *const u8, len: usize) {
+        self.uint(len as u32);
+        for i in 0..len {
+            if self.overflow {
+                break;
+            }
+            self.put(unsafe { *ptr.add(i) });
+        }
+    }
+
+    pub fn cstr(&mut self, ptr: *const u8) {
+        let mut len = 0;
+        while unsafe { *ptr.add(len) } != 0 {
+            len += 1;
+        }
+        self.bytes(ptr, len);
+    }
+
+    pub fn end(mut self) {
+        self.raw(Self::END);
+        if !self.overflow {
+            ll_invoke_inner!(INVOKE_ID_LOG_PUT_FRAME, self.buf.as_ptr(), self.len);
+        }
+    }
+}
+
+#[cfg(feature = "defmt")]
+pub use defmt_logger::defmt_dropped;
+
+#[cfg(feature = "defmt")]
+mod defmt_logger {
+    use crate::ll_api::ll_cmd::*;
+    use crate::tick::{Tick, TICK_FREQ_HZ};
+    use portable_atomic::{AtomicU32, AtomicU8, Ordering};
+
+    /// defmt global logger, encoded frames go to the log UART through the log buffer.
+    ///
+    /// A frame is encoded with interrupts enabled into the scratch buffer of its nesting
+    /// level, then queued whole by the log buffer or dropped whole when it does not fit, so
+    /// the host decoder never sees a torn frame. Interrupts are masked only while the log
+    /// buffer copies the finished frame. The frames are sent by the UART interrupt.
+    #[defmt::global_logger]
+    struct Logger;
+
+    /// Thread mode and two interrupt preemption levels.
+    const LEVELS: usize = 3;
+    const FRAME_SIZE: usize = 128;
+
+    struct Frame {
+        encoder: defmt::Encoder,
+        buf: [u8; FRAME_SIZE],
+        len: usize,
+        overflow: bool,
+    }
+
+    const NEW_FRAME: Frame = Frame {
+        encoder: defmt::Encoder::new(),
+        buf: [0; FRAME_SIZE],
+        len: 0,
+        overflow: false,
+    };
+
+    /// Frames being encoded, one per nesting level. A frame interrupted by another logging
+    /// context is resumed after that context released its own, deeper frame.
+    static mut FRAMES: [Frame; LEVELS] = [NEW_FRAME; LEVELS];
+    static DEPTH: AtomicU8 = AtomicU8::new(0);
+    static DROPPED: AtomicU32 = AtomicU32::new(0);
+
+    /// Returns the number of defmt frames dropped before reaching the log buffer, because
+    /// they were longer than 128 bytes or nested deeper than 3 levels. Frames dropped by a
+    /// full log buffer are counted in bytes by `log_dropped()`.
+    pub fn defmt_dropped() -> u32 {
+        DROPPED.load(Ordering::Relaxed)
+    }
+
+    /// The frame of the running context, `None` if it nests too deep.
+    fn current() -> Option<&'static mut Frame> {
+        let depth = DEPTH.load(Ordering::Acquire) as usize;
+        if depth == 0 || depth > LEVELS {
+            return None;
+        }
+        Some(unsafe { &mut (*core::ptr::addr_of_mut!(FRAMES))[depth - 1] })
+    }
+
+    impl Frame {
+        fn encode(&mut self, op: impl FnOnce(&mut defmt::Encoder, &mut dyn FnMut(&[u8]))) {
+            let Frame {
+                encoder,
+                buf,
+                len,
+                overflow,
+            } = self;
+            let mut sink = |bytes: &[u8]| {
+                if *len + bytes.len() > buf.len() {
+                    *overflow = true;
+                    return;
+                }
+                buf[*len..*len + bytes.len()].copy_from_slice(bytes);
+                *len += bytes.len();
+            };
+            op(encoder, &mut sink);
+        }
+    }
+
+    unsafe impl defmt::Logger for Logger {
+        fn acquire() {
+            DEPTH.fetch_add(1, Ordering::AcqRel);
+            if let Some(frame) = current() {
+                frame.len = 0;
+                frame.overflow = false;
+                frame.encode(|encoder, sink| encoder.start_frame(sink));
+            }
+        }
+
+        unsafe fn flush() {
+            super::log_flush();
+        }
+
+        unsafe fn release() {
+            match current() {
+                Some(frame) => {
+                    frame.encode(|encoder, sink| encoder.end_frame(sink));
+                    if frame.overflow {
+                        DROPPED.fetch_add(1, Ordering::Relaxed);
+                    } else {
+                        ll_invoke_inner!(INVOKE_ID_LOG_PUT_FRAME, frame.buf.as_ptr(), frame.len);
+                    }
+                }
+                None => {
+                    DROPPED.fetch_add(1, Ordering::Relaxed);
+                }
+            }
+            DEPTH.fetch_sub(1, Ordering::AcqRel);
+        }
+
+        unsafe fn write(bytes: &[u8]) {
+            if let Some(frame) = current() {
+                frame.encode(|encoder, sink| encoder.write(bytes, sink));
+            }
+        }
+    }
+
+    defmt::timestamp!(
+        "{=u64:us}",
+        (Tick::tick() as u64) * 1_000_000 / TICK_FREQ_HZ as u64
+    );
+}
@@ -0,0 +1,331 @@
+mod motor;
+mod stream;
+pub mod ws2812;
+
+use crate::ll_api::{ll_cmd::*, PwmCtrl};
+pub use crate::ll_api::{PwmChannel, PwmPolarity};
+use core::convert::Infallible;
+use fugit::TimerDurationU32;
+pub use motor::*;
+pub use stream::*;
+
+const PWM_INIT_OUTPUT_FREQ: u32 = 0x01;
+
+/// Channel state shared by `Pwm` and `PwmOut`.
+#[derive(Debug)]
+struct PwmChan {
+    ch: PwmChannel,
+    /// Address of the compare register, 0 if the C driver does not expose it.
+    ccr: usize,
+    role: ChanRole,
+}
+
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+enum ChanRole {
+    /// Initialized the channel, releases it when dropped.
+    Owner,
+    /// A clone of the owner, writes the channel but does not release it.
+    Shared,
+    /// The init failed, the handle neither writes nor releases the channel.
+    Invalid,
+}
+
+impl PwmChan {
+    fn init(ch: PwmChannel, freq: u32, flags: u32) -> Result<Self, i32> {
+        let mut ccr: u32 = 0;
+        let result = ll_invoke_inner!(INVOKE_ID_PWM_INIT, ch, freq, flags, &mut ccr as *mut u32);
+        if result == 0 {
+            Ok(PwmChan {
+                ch,
+                ccr: ccr as usize,
+                role: ChanRole::Owner,
+            })
+        } else {
+            Err(result)
+        }
+    }
+
+    fn is_valid(&self) -> bool {
+        self.role != ChanRole::Invalid
+    }
+
+    fn ctrl(&self, ctrl: PwmCtrl) -> i32 {
+        if !self.is_valid() {
+            return -3;
+        }
+        ll_invoke_inner!(INVOKE_ID_PWM_CTRL, self.ch, ctrl)
+    }
+
+    fn ctrl_param(&self, ctrl: PwmCtrl, param: u32) -> i32 {
+        if !self.is_valid() {
+            return -3;
+        }
+        ll_invoke_inner!(INVOKE_ID_PWM_CTRL, self.ch, ctrl, param)
+    }
+
+    fn set_polarity(&self, p: PwmPolarity) {
+        if self.is_valid() {
+            ll_invoke_inner!(INVOKE_ID_PWM_CTRL, self.ch, p);
+        }
+    }
+
+    fn get_duty(&self) -> u16 {
+        if self.ccr != 0 {
+            return unsafe { core::ptr::read_volatile(self.ccr as *const u16) };
+        }
+        self.ctrl(PwmCtrl::GetDuty).max(0) as u16
+    }
+
+    /// A single compare register write, latched at the next period by the preload.
+    fn set_duty(&self, duty: u16) {
+        if self.ccr != 0 {
+            unsafe { core::ptr::write_volatile(self.ccr as *mut u16, duty) };
+        } else {
+            self.ctrl_param(PwmCtrl::SetDuty, duty as u32);
+        }
+    }
+
+    fn get_max_duty(&self) -> u16 {
+        self.ctrl(PwmCtrl::GetMaxDuty).max(0) as u16
+    }
+}
+
+impl Clone for PwmChan {
+    fn clone(&self) -> Self {
+        let role = match self.role {
+            ChanRole::Invalid => ChanRole::Invalid,
+            _ => ChanRole::Shared,
+        };
+        PwmChan {
+            ch: self.ch,
+            ccr: self.ccr,
+            role,
+        }
+    }
+}
+
+impl Drop for PwmChan {
+    fn drop(&mut self) {
+        if self.role == ChanRole::Owner {
+            ll_invoke_inner!(INVOKE_ID_PWM_DEINIT, self.ch);
+        }
+    }
+}
+
+/// PWM output with a counter tick rate of `FREQ` Hz, the period and duty are set in ticks or as
+/// durations. The period defaults to 1000 ticks.
+///
+/// Channels on the same timer share the counter, so their `FREQ` must match and `set_period()`
+/// changes all of them. A clone drives the same channel, the original releases it when dropped.
+#[derive(Clone, Debug)]
+pub struct Pwm<const FREQ: u32> {
+    chan: PwmChan,
+}
+
+impl<const FREQ: u32> Pwm<FREQ> {
+    /// Creates a new PWM instance with the specified channel.
+    ///
+    /// # Arguments
+    /// * `ch` - The PWM channel to initialize.
+    ///
+    /// # Returns
+    /// A new `Pwm` instance configured for the given channel and frequency. If the channel
+    /// cannot be set up the instance does nothing, see `try_new()`.
+    pub fn new(ch: PwmChannel) -> Self {
+        Self::try_new(ch).unwrap_or(Pwm {
+            chan: PwmChan {
+                ch,
+                ccr: 0,
+                role: ChanRole::Invalid,
+            },
+        })
+    }
+
+    /// Creates a new PWM instance with the specified channel.
+    ///
+    /// # Returns
+    /// `Err(-2)` if `FREQ` is out of range, `Err(-3)` if another channel of the timer runs at
+    /// a different `FREQ` or `MotorPwm` uses the timer.
+    pub fn try_new(ch: PwmChannel) -> Result<Self, i32> {
+        let chan = PwmChan::init(ch, FREQ, 0)?;
+        Ok(Pwm { chan })
+    }
+
+    /// Enables the PWM output on the specified channel.
+    pub fn enable(&self) {
+        self.chan.ctrl(PwmCtrl::On);
+    }
+
+    /// Disables the PWM output on the specified channel.
+    pub fn disable(&self) {
+        self.chan.ctrl(PwmCtrl::Off);
+    }
+
+    /// Sets the polarity of the PWM output on the specified channel.
+    ///
+    /// # Arguments
+    /// * `p` - The polarity to set (`ActiveHigh` or `ActiveLow`).
+    pub fn set_polarity(&self, p: PwmPolarity) {
+        self.chan.set_polarity(p);
+    }
+
+    /// Retrieves the current duty cycle of the PWM output on the specified channel.
+    ///
+    /// # Returns
+    /// The current duty cycle as a `u16`.
+    pub fn get_duty(&self) -> u16 {
+        self.chan.get_duty()
+    }
+
+    /// Retrieves the current duty cycle of the PWM output on the specified channel and converts it to a duration.
+    ///
+    /// # Returns
+    /// The current duty cycle as a `TimerDurationU32`.
+    pub fn get_duty_time(&self) -> TimerDurationU32<FREQ> {
+        TimerDurationU32::from_ticks(self.get_duty() as u32)
+    }
+
+    /// Sets the duty cycle of the PWM output on the specified channel, it takes effect at the
+    /// start of the next period.
+    ///
+    /// # Arguments
+    /// * `duty` - The duty cycle to set.
+    pub fn set_duty(&self, duty: u16) {
+        self.chan.set_duty(duty);
+    }
+
+    /// Sets the duty cycle of the PWM output on the specified channel from a duration.
+    ///
+    /// # Arguments
+    /// * `duty` - The duty cycle duration.
+    pub fn set_duty_time(&self, duty: TimerDurationU32<FREQ>) {
+        self.set_duty(duty.ticks() as u16);
+    }
+
+    /// Retrieves the maximum duty cycle value of the PWM output.
+    ///
+    /// # Returns
+    /// The maximum duty cycle as a `u16`. If `0` is returned, it means the max duty cycle is `2^16`.
+    pub fn get_max_duty(&self) -> u16 {
+        self.chan.get_max_duty()
+    }
+
+    /// Retrieves the current period of the PWM output as a duration.
+    ///
+    /// # Returns
+    /// The current period as a `TimerDurationU32`.
+    pub fn get_period(&self) -> TimerDurationU32<FREQ> {
+        let result = self.chan.ctrl(PwmCtrl::GetPeriod).max(0);
+        TimerDurationU32::from_ticks(result as u32)
+    }
+
+    /// Sets the PWM frequency for the PWM output from a duration.
+    ///
+    /// # Arguments
+    /// * `period` - The desired period as a `TimerDurationU32`.
+    pub fn set_period(&self, period: TimerDurationU32<FREQ>) {
+        if !period.is_zero() {
+            self.chan.ctrl_param(PwmCtrl::SetPeriod, period.ticks());
+        }
+    }
+}
+
+impl<const FREQ: u32> embedded_hal::pwm::ErrorType for Pwm<FREQ> {
+    type Error = Infallible;
+}
+
+impl<const FREQ: u32> embedded_hal::pwm::SetDutyCycle for Pwm<FREQ> {
+    fn max_duty_cycle(&self) -> u16 {
+        self.get_max_duty()
+    }
+    fn set_duty_cycle(&mut self, duty: u16) -> Result<(), Self::Error> {
+        self.set_duty(duty);
+        Ok(())
+    }
+}
+
+/// PWM output at a given output frequency.
+///
+/// The prescaler is kept as small as possible, so the duty resolution is as fine as the timer
+/// clock allows, up to 65535 steps, see `max_duty()`.
+///
+/// | Channel | Timer | Pin  |
+/// |---------|-------|------|
+/// | CH0     | TIM1  | PA8  |
+/// | CH1     | TIM1  | PA11 |
+/// | CH2     | TIM2  | PA0  |
+/// | CH3     | TIM2  | PA1  |
+/// | CH4     | TIM3  | PA6  |
+/// | CH5     | TIM3  | PA7  |
+/// | CH6     | TIM4  | PB6  |
+/// | CH7     | TIM4  | PB7  |
+///
+/// The pin must be set to alternate push-pull mode. Channels on the same timer must use the same
+/// frequency. A timer run by another driver, e.g. TIM3 pacing the ADC at a sample rate, fails with
+/// `Err(-3)`.
+#[derive(Debug)]
+pub struct PwmOut {
+    chan: PwmChan,
+    max_duty: u16,
+}
+
+impl PwmOut {
+    /// Sets up a channel, the output stays disabled until `enable()`.
+    ///
+    /// # Arguments
+    /// * `ch` - The PWM channel.
+    /// * `hz` - Output frequency, at least 2 steps of the timer clock.
+    ///
+    /// # Returns
+    /// `Err(-2)` if the frequency is out of range, `Err(-3)` if another channel of the timer
+    /// runs at a different frequency.
+    pub fn new(ch: PwmChannel, hz: u32) -> Result<Self, i32> {
+        let chan = PwmChan::init(ch, hz, PWM_INIT_OUTPUT_FREQ)?;
+        let max_duty = chan.get_max_duty();
+        Ok(PwmOut { chan, max_duty })
+    }
+
+    /// Enables the output.
+    pub fn enable(&self) {
+        self.chan.ctrl(PwmCtrl::On);
+    }
+
+    /// Disables the output.
+    pub fn disable(&self) {
+        self.chan.ctrl(PwmCtrl::Off);
+    }
+
+    /// Sets the polarity of the output.
+    pub fn set_polarity(&self, p: PwmPolarity) {
+        self.chan.set_polarity(p);
+    }
+
+    /// Returns the duty of a full period.
+    pub fn max_duty(&self) -> u16 {
+        self.max_duty
+    }
+
+    /// Returns the current duty.
+    pub fn get_duty(&self) -> u16 {
+        self.chan.get_duty()
+    }
+
+    /// Sets the duty, 0..=`max_duty()`, it takes effect at the start of the next period.
+    pub fn set_duty(&self, duty: u16) {
+        self.chan.set_duty(duty.min(self.max_duty));
+    }
+}
+
+impl embedded_hal::pwm::ErrorType for PwmOut {
+    type Error = Infallible;
+}
+
+impl embedded_hal::pwm::SetDutyCycle for PwmOut {
+    fn max_duty_cycle(&self) -> u16 {
+        self.max_duty
+    }
+    fn set_duty_cycle(&mut self, duty: u16) -> Result<(), Self::Error> {
+        self.set_duty(duty);
+        Ok(())
+    }
+}
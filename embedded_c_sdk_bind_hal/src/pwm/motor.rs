@@ -0,0 +1,335 @@
+use super::PwmPolarity;
+use crate::adc::{AdcInput, AdcSampleTime, InjectTriggered};
+use crate::ll_api::{ll_cmd::*, MotorCtrl};
+use crate::timer::{Tim, TimClaim};
+#[cfg(feature = "embassy")]
+use embassy_sync::waitqueue::AtomicWaker;
+use portable_atomic::{AtomicBool, AtomicPtr, AtomicU16, AtomicU32, AtomicU8, Ordering};
+
+const MOTOR_BREAK_ENABLE: u32 = 0x01;
+const MOTOR_BREAK_ACTIVE_HIGH: u32 = 0x02;
+const MOTOR_POLARITY_HIGH_LOW: u32 = 0x01;
+const MOTOR_POLARITY_LOW_LOW: u32 = 0x02;
+const MOTOR_STATUS_ENABLED: i32 = 0x01;
+const MOTOR_EVENT_UPDATE: u32 = 0x01;
+const MOTOR_EVENT_BREAK: u32 = 0x02;
+
+static MOTOR_BREAK: AtomicBool = AtomicBool::new(false);
+static MOTOR_MAX_DUTY: AtomicU16 = AtomicU16::new(0);
+static MOTOR_CCR: AtomicU32 = AtomicU32::new(0);
+static MOTOR_SAMPLES: AtomicU8 = AtomicU8::new(0); //inputs converted at the sample point
+static MOTOR_UPDATE_CALLBACK: AtomicPtr<()> = AtomicPtr::new(core::ptr::null_mut());
+static MOTOR_BREAK_CALLBACK: AtomicPtr<()> = AtomicPtr::new(core::ptr::null_mut());
+#[cfg(feature = "embassy")]
+static MOTOR_BREAK_WAKER: AtomicWaker = AtomicWaker::new();
+
+/// Break input (BKIN, PB12) of `MotorPwm`.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum MotorBreak {
+    Off,
+    /// The outputs shut down while the input is low.
+    ActiveLow,
+    /// The outputs shut down while the input is high.
+    ActiveHigh,
+}
+
+/// Phase of `MotorPwm`, a complementary pair of high side and low side outputs.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+#[repr(u8)]
+pub enum MotorPhase {
+    /// OC1 on PA8, OC1N on PB13.
+    U,
+    /// OC2 on PA9, OC2N on PB14.
+    V,
+    /// OC3 on PA10, OC3N on PB15.
+    W,
+}
+
+/// Three-phase center-aligned PWM on TIM1 for half bridges, e.g. a BLDC or PMSM inverter.
+///
+/// Each phase drives a high side output and its complement with a dead-time between them. The
+/// duty of a phase is the high side on time, `0..=max_duty()`, and takes effect at the next
+/// period boundary. The break input shuts all outputs down in hardware, they stay off until
+/// `enable()`.
+///
+/// The period boundary (counter at 0) is the time to update the duties, see `on_update()`. The
+/// center of the period, where the low sides conduct, is the sample point for low side current
+/// shunts, see `sample_at_center()`.
+///
+/// Uses TIM1, `PwmChannel::CH0`/`CH1` and `PwmInput`/`InputCapture` on TIM1 are not available.
+/// Phases V and W share PA9/PA10 with the log UART (USART1), the log must be off once their
+/// pins are set to the alternate function.
+pub struct MotorPwm {
+    _tim: TimClaim,
+    ctl: MotorControl,
+    samples: Option<InjectTriggered>,
+}
+
+/// Duties and samples of the running `MotorPwm`, handed to its update callback.
+#[derive(Clone, Copy, Debug)]
+pub struct MotorControl {
+    ccr: usize,
+    max_duty: u16,
+}
+
+impl MotorControl {
+    pub fn max_duty(&self) -> u16 {
+        self.max_duty
+    }
+
+    /// Sets the duty of a phase, clamped to `max_duty()`.
+    pub fn set_duty(&self, phase: MotorPhase, duty: u16) {
+        let ccr = (self.ccr + 4 * phase as usize) as *mut u16;
+        unsafe { core::ptr::write_volatile(ccr, duty.min(self.max_duty)) };
+    }
+
+    /// Sets the duties of U, V and W.
+    pub fn set_duties(&self, duties: [u16; 3]) {
+        self.set_duty(MotorPhase::U, duties[0]);
+        self.set_duty(MotorPhase::V, duties[1]);
+        self.set_duty(MotorPhase::W, duties[2]);
+    }
+
+    pub fn get_duty(&self, phase: MotorPhase) -> u16 {
+        let ccr = (self.ccr + 4 * phase as usize) as *const u16;
+        unsafe { core::ptr::read_volatile(ccr) }
+    }
+
+    /// Copies the samples of the last sample point in the order of the
+    /// `MotorPwm::sample_at_center()` inputs.
+    ///
+    /// # Returns
+    /// `WouldBlock` if there was no new sample point since the last read.
+    pub fn read_samples(&self, out: &mut [u16]) -> nb::Result<(), i32> {
+        match MOTOR_SAMPLES.load(Ordering::Acquire) {
+            0 => Err(nb::Error::Other(-1)),
+            count => InjectTriggered::read(count as usize, out),
+        }
+    }
+}
+
+impl MotorPwm {
+    /// Sets up TIM1 with the outputs off.
+    ///
+    /// # Arguments
+    /// * `freq` - PWM frequency in Hz, the duty resolution is the timer clock / (2 * `freq`).
+    /// * `dead_time_ns` - Delay between switching one side off and the other on, rounded up to
+    ///   the dead-time generator steps, up to 1008 timer clocks.
+    /// * `brk` - Break input.
+    ///
+    /// # Returns
+    /// `Err(-300)` or `Err(-3)` if TIM1 is in use, `Err(-4)` if the dead-time is too long.
+    pub fn new(freq: u32, dead_time_ns: u32, brk: MotorBreak) -> Result<Self, i32> {
+        let tim = TimClaim::take(Tim::Tim1)?;
+        let flags = match brk {
+            MotorBreak::Off => 0,
+            MotorBreak::ActiveLow => MOTOR_BREAK_ENABLE,
+            MotorBreak::ActiveHigh => MOTOR_BREAK_ENABLE | MOTOR_BREAK_ACTIVE_HIGH,
+        };
+        let mut ccr: u32 = 0;
+        let result = ll_invoke_inner!(
+            INVOKE_ID_PWM_MOTOR_INIT,
+            freq,
+            dead_time_ns,
+            flags,
+            &mut ccr as *mut u32
+        );
+        if result != 0 {
+            return Err(result);
+        }
+
+        let mut motor = MotorPwm {
+            _tim: tim,
+            ctl: MotorControl {
+                ccr: ccr as usize,
+                max_duty: 0,
+            },
+            samples: None,
+        };
+        motor.ctl.max_duty = motor.ctrl(MotorCtrl::GetMaxDuty, 0)? as u16;
+        MOTOR_CCR.store(ccr, Ordering::Release);
+        MOTOR_MAX_DUTY.store(motor.ctl.max_duty, Ordering::Release);
+        Ok(motor)
+    }
+
+    fn ctrl(&self, ctrl: MotorCtrl, param: u32) -> Result<i32, i32> {
+        let result = ll_invoke_inner!(INVOKE_ID_PWM_MOTOR_CTRL, ctrl, param);
+        if result >= 0 {
+            Ok(result)
+        } else {
+            Err(result)
+        }
+    }
+
+    /// Sets the active level of the high side and low side outputs, the outputs must be off.
+    /// The idle level of an output is its inactive level.
+    pub fn set_polarity(
+        &mut self,
+        high_side: PwmPolarity,
+        low_side: PwmPolarity,
+    ) -> Result<(), i32> {
+        let mut polarity = 0;
+        if high_side == PwmPolarity::ActiveLow {
+            polarity |= MOTOR_POLARITY_HIGH_LOW;
+        }
+        if low_side == PwmPolarity::ActiveLow {
+            polarity |= MOTOR_POLARITY_LOW_LOW;
+        }
+        self.ctrl(MotorCtrl::Polarity, polarity).map(|_| ())
+    }
+
+    /// Turns the outputs on, also after a break.
+    ///
+    /// # Returns
+    /// `Err(-6)` while the break input is active.
+    pub fn enable(&mut self) -> Result<(), i32> {
+        MOTOR_BREAK.store(false, Ordering::Release);
+        self.ctrl(MotorCtrl::Enable, 0).map(|_| ())
+    }
+
+    /// Turns the outputs off, they go to their inactive level.
+    pub fn disable(&mut self) {
+        let _ = self.ctrl(MotorCtrl::Disable, 0);
+    }
+
+    /// True while the outputs are on, false after `disable()` or a break.
+    pub fn is_enabled(&self) -> bool {
+        match self.ctrl(MotorCtrl::GetStatus, 0) {
+            Ok(status) => status & MOTOR_STATUS_ENABLED != 0,
+            Err(_) => false,
+        }
+    }
+
+    /// Returns the duty and sample access, also handed to the `on_update()` callback.
+    pub fn control(&self) -> MotorControl {
+        self.ctl
+    }
+
+    pub fn max_duty(&self) -> u16 {
+        self.ctl.max_duty
+    }
+
+    /// Sets the duty of a phase, clamped to `max_duty()`.
+    pub fn set_duty(&self, phase: MotorPhase, duty: u16) {
+        self.ctl.set_duty(phase, duty)
+    }
+
+    /// Sets the duties of U, V and W.
+    pub fn set_duties(&self, duties: [u16; 3]) {
+        self.ctl.set_duties(duties)
+    }
+
+    pub fn get_duty(&self, phase: MotorPhase) -> u16 {
+        self.ctl.get_duty(phase)
+    }
+
+    /// Calls `callback` from the TIM1 update interrupt at every period boundary, the duties set
+    /// by the callback apply to the next period. `None` disables the interrupt.
+    ///
+    /// # Arguments
+    /// * `callback` - Runs in interrupt context and must finish within the period, e.g. reads
+    ///   the samples of the last center and sets the next duties.
+    pub fn on_update(&mut self, callback: Option<fn(MotorControl)>) {
+        let ptr = match callback {
+            Some(callback) => callback as *mut (),
+            None => core::ptr::null_mut(),
+        };
+        MOTOR_UPDATE_CALLBACK.store(ptr, Ordering::Release);
+        let _ = self.ctrl(MotorCtrl::UpdateIrq, callback.is_some() as u32);
+    }
+
+    /// Calls `callback` from the break interrupt when the break input shuts the outputs down.
+    pub fn on_break(&mut self, callback: Option<fn()>) {
+        let ptr = match callback {
+            Some(callback) => callback as *mut (),
+            None => core::ptr::null_mut(),
+        };
+        MOTOR_BREAK_CALLBACK.store(ptr, Ordering::Release);
+    }
+
+    /// True if the break input shut the outputs down since the last `enable()`.
+    pub fn break_tripped(&self) -> bool {
+        MOTOR_BREAK.load(Ordering::Acquire)
+    }
+
+    /// Waits until the break input shuts the outputs down.
+    #[cfg(feature = "embassy")]
+    pub async fn wait_break(&self) {
+        core::future::poll_fn(|cx| {
+            MOTOR_BREAK_WAKER.register(cx.waker());
+            if MOTOR_BREAK.load(Ordering::Acquire) {
+                core::task::Poll::Ready(())
+            } else {
+                core::task::Poll::Pending
+            }
+        })
+        .await
+    }
+
+    /// Converts up to 4 inputs with the ADC injected group at every center of the period, without
+    /// any CPU work. Read the results with `read_samples()`, e.g. from the `on_update()` callback.
+    /// The injected group is reserved for the motor until it is dropped.
+    ///
+    /// # Returns
+    /// `Err(-300)` while `Adc::inject()` runs.
+    pub fn sample_at_center<const N: usize>(
+        &mut self,
+        inputs: &[AdcInput; N],
+        sample_time: AdcSampleTime,
+    ) -> Result<(), i32> {
+        MOTOR_SAMPLES.store(0, Ordering::Release);
+        self.samples = None;
+        self.samples = Some(InjectTriggered::start(inputs, sample_time)?);
+        MOTOR_SAMPLES.store(N as u8, Ordering::Release);
+        Ok(())
+    }
+
+    /// Moves the sample point `ticks` timer clocks past the center, e.g. to skip switching
+    /// noise.
+    pub fn set_sample_delay(&mut self, ticks: u16) -> Result<(), i32> {
+        self.ctrl(MotorCtrl::SampleDelay, ticks as u32).map(|_| ())
+    }
+
+    /// Copies the samples of the last sample point in the order of the `sample_at_center()`
+    /// inputs.
+    ///
+    /// # Returns
+    /// `WouldBlock` if there was no new sample point since the last read.
+    pub fn read_samples(&self, out: &mut [u16]) -> nb::Result<(), i32> {
+        self.ctl.read_samples(out)
+    }
+}
+
+impl Drop for MotorPwm {
+    fn drop(&mut self) {
+        ll_invoke_inner!(INVOKE_ID_PWM_MOTOR_DEINIT);
+        MOTOR_SAMPLES.store(0, Ordering::Release);
+        MOTOR_UPDATE_CALLBACK.store(core::ptr::null_mut(), Ordering::Release);
+        MOTOR_BREAK_CALLBACK.store(core::ptr::null_mut(), Ordering::Release);
+    }
+}
+
+#[allow(non_snake_case)]
+#[no_mangle]
+unsafe extern "C" fn PWM_MOTOR_hook_rs(events: u32) {
+    if events & MOTOR_EVENT_UPDATE != 0 {
+        let callback = MOTOR_UPDATE_CALLBACK.load(Ordering::Acquire);
+        if !callback.is_null() {
+            let callback: fn(MotorControl) = core::mem::transmute(callback);
+            callback(MotorControl {
+                ccr: MOTOR_CCR.load(Ordering::Relaxed) as usize,
+                max_duty: MOTOR_MAX_DUTY.load(Ordering::Relaxed),
+            });
+        }
+    }
+    if events & MOTOR_EVENT_BREAK != 0 {
+        MOTOR_BREAK.store(true, Ordering::Release);
+        let callback = MOTOR_BREAK_CALLBACK.load(Ordering::Acquire);
+        if !callback.is_null() {
+            let callback: fn() = core::mem::transmute(callback);
+            callback();
+        }
+        #[cfg(feature = "embassy")]
+        MOTOR_BREAK_WAKER.wake();
+    }
+}
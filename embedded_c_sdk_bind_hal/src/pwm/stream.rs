@@ -0,0 +1,95 @@
+use super::PwmOut;
+use crate::dma::{Dma, DmaRequest, DmaStreamError, DmaTxStream};
+use crate::ll_api::PwmCtrl;
+
+const TIM_UP_REQUESTS: [DmaRequest; 4] = [
+    DmaRequest::Tim1Up,
+    DmaRequest::Tim2Up,
+    DmaRequest::Tim3Up,
+    DmaRequest::Tim4Up,
+];
+
+/// Duty values written into the compare register of a `PwmOut` by the DMA, one per period.
+///
+/// The timer update event requests one transfer per period and the compare preload applies
+/// each value to the following period, so every period gets its own duty without any CPU work.
+/// The values run through a `DmaTxStream` double buffer, refill the half returned by `write()`
+/// while the DMA sends the other one.
+///
+/// Uses the update DMA request of the timer, one `PwmStream` per timer.
+pub struct PwmStream<const N: usize> {
+    stream: DmaTxStream<u16, N>,
+    pwm: PwmOut,
+}
+
+impl<const N: usize> PwmStream<N> {
+    /// Claims the update DMA channel of the timer of `pwm`.
+    ///
+    /// # Arguments
+    /// * `pwm` - The output, enabled by the caller.
+    /// * `buf` - Two halves of `N` duty values, 2 * N must not exceed 65535.
+    pub fn new(pwm: PwmOut, buf: &'static mut [[u16; N]; 2]) -> Result<Self, i32> {
+        if pwm.chan.ccr == 0 || N == 0 {
+            return Err(-10);
+        }
+        let req = pwm.chan.ctrl(PwmCtrl::GetDmaReq);
+        let req = match TIM_UP_REQUESTS.iter().find(|r| **r as i32 == req) {
+            Some(req) => *req,
+            None => return Err(-301),
+        };
+
+        let dma = Dma::request(req)?;
+        let stream = DmaTxStream::new(dma, pwm.chan.ccr, buf)?;
+        Ok(PwmStream { stream, pwm })
+    }
+
+    /// Returns the output.
+    pub fn pwm(&self) -> &PwmOut {
+        &self.pwm
+    }
+
+    /// Returns the duty of a full period.
+    pub fn max_duty(&self) -> u16 {
+        self.pwm.max_duty()
+    }
+
+    /// Both halves, to fill before `start()`.
+    pub fn buf_mut(&mut self) -> &mut [[u16; N]; 2] {
+        self.stream.buf_mut()
+    }
+
+    /// Starts with the first value of the first half, from the second timer period on.
+    pub fn start(&mut self) -> Result<(), i32> {
+        self.stream.start()?;
+        self.pwm.chan.ctrl(PwmCtrl::DmaOn);
+        Ok(())
+    }
+
+    /// Stops the DMA, the output keeps the last duty written.
+    pub fn stop(&mut self) -> Result<(), i32> {
+        self.pwm.chan.ctrl(PwmCtrl::DmaOff);
+        self.stream.stop()
+    }
+
+    /// Returns the number of halves sent since `start()`.
+    pub fn sent(&self) -> u32 {
+        self.stream.sent()
+    }
+
+    /// Returns the half to refill, see `DmaTxStream::write()`.
+    pub fn write(&mut self) -> nb::Result<&mut [u16; N], DmaStreamError> {
+        self.stream.write()
+    }
+
+    /// Waits for the half to refill without blocking the executor.
+    #[cfg(feature = "embassy")]
+    pub async fn async_write(&mut self) -> Result<&mut [u16; N], DmaStreamError> {
+        self.stream.async_write().await
+    }
+}
+
+impl<const N: usize> Drop for PwmStream<N> {
+    fn drop(&mut self) {
+        self.pwm.chan.ctrl(PwmCtrl::DmaOff);
+    }
+}
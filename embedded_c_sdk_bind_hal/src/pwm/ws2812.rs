@@ -0,0 +1,196 @@
+use super::{PwmChannel, PwmOut, PwmStream};
+use crate::dma::DmaStreamError;
+
+const WS2812_HZ: u32 = 800_000;
+const BITS_PER_LED: usize = 24;
+/// Low time latching the colors, in bit periods (300 us).
+const RESET_BITS: usize = 240;
+
+/// Color of one LED.
+#[derive(Clone, Copy, Default, PartialEq, Eq, Debug)]
+pub struct Rgb {
+    pub r: u8,
+    pub g: u8,
+    pub b: u8,
+}
+
+impl Rgb {
+    pub const fn new(r: u8, g: u8, b: u8) -> Self {
+        Rgb { r, g, b }
+    }
+}
+
+/// WS2812 / SK6812 LED strip driven by a `PwmStream` at 800 kHz, one PWM period per bit.
+///
+/// The colors are expanded to bit timings half a buffer at a time while the DMA sends the
+/// other half, so a strip of any length needs only `2 * N` duty values of RAM and the CPU
+/// encodes `N` bits every `N * 1.25` us.
+///
+/// ```ignore
+/// static mut LED_BUF: [[u16; 96]; 2] = [[0; 96]; 2];
+/// let mut strip = Ws2812::new(PwmChannel::CH0, unsafe { &mut *addr_of_mut!(LED_BUF) })?;
+/// strip.write(&[Rgb::new(255, 0, 0); 300])?;
+/// ```
+pub struct Ws2812<const N: usize> {
+    stream: PwmStream<N>,
+    t0: u16,
+    t1: u16,
+}
+
+impl<const N: usize> Ws2812<N> {
+    /// Sets up the PWM channel wired to the data input.
+    ///
+    /// # Arguments
+    /// * `ch` - The PWM channel, see `PwmOut` for the pins. The pin must be in alternate
+    ///   push-pull mode.
+    /// * `buf` - Two halves of `N` bit slots.
+    pub fn new(ch: PwmChannel, buf: &'static mut [[u16; N]; 2]) -> Result<Self, i32> {
+        let pwm = PwmOut::new(ch, WS2812_HZ)?;
+        let max = pwm.max_duty() as u32;
+        //0.4 us and 0.8 us high of a 1.25 us bit
+        let t0 = ((max * 8 + 12) / 25) as u16;
+        let t1 = ((max * 16 + 12) / 25) as u16;
+        pwm.set_duty(0);
+        pwm.enable();
+
+        let stream = PwmStream::new(pwm, buf)?;
+        Ok(Ws2812 { stream, t0, t1 })
+    }
+
+    /// Sends `colors` to the strip, returns once the strip has latched them.
+    pub fn write(&mut self, colors: &[Rgb]) -> Result<(), DmaStreamError> {
+        let last = self.begin(colors)?;
+        for seq in 2..=last {
+            match nb::block!(self.stream.write()) {
+                Ok(block) => encode(colors, seq * N, block, self.t0, self.t1),
+                Err(err) => {
+                    self.finish();
+                    return Err(err);
+                }
+            }
+        }
+        self.finish();
+        Ok(())
+    }
+
+    /// Like `write()`, waits for the DMA without blocking the executor.
+    #[cfg(feature = "embassy")]
+    pub async fn async_write(&mut self, colors: &[Rgb]) -> Result<(), DmaStreamError> {
+        let last = self.begin(colors)?;
+        for seq in 2..=last {
+            match self.stream.async_write().await {
+                Ok(block) => encode(colors, seq * N, block, self.t0, self.t1),
+                Err(err) => {
+                    self.finish();
+                    return Err(err);
+                }
+            }
+        }
+        self.finish();
+        Ok(())
+    }
+
+    /// Encodes the first two halves and starts the stream.
+    ///
+    /// # Returns
+    /// The last half to queue, when it can be queued every LED bit and `RESET_BITS` of low
+    /// have been sent.
+    fn begin(&mut self, colors: &[Rgb]) -> Result<usize, DmaStreamError> {
+        let data = (colors.len() * BITS_PER_LED).div_ceil(N);
+        let reset = RESET_BITS.div_ceil(N);
+
+        let (t0, t1) = (self.t0, self.t1);
+        let buf = self.stream.buf_mut();
+        encode(colors, 0, &mut buf[0], t0, t1);
+        encode(colors, N, &mut buf[1], t0, t1);
+        if self.stream.start().is_err() {
+            self.finish();
+            return Err(DmaStreamError::Transfer);
+        }
+        Ok(data + reset + 1)
+    }
+
+    fn finish(&mut self) {
+        let _ = self.stream.stop();
+        self.stream.pwm().set_duty(0);
+    }
+}
+
+/// Fills `out` with the duties of the GRB, MSB first bit stream of `colors` from bit
+/// `first_bit` on, 0 past the last LED.
+fn encode(colors: &[Rgb], first_bit: usize, out: &mut [u16], t0: u16, t1: u16) {
+    let mut led = first_bit / BITS_PER_LED;
+    let mut bit = first_bit % BITS_PER_LED;
+    let mut out = out.iter_mut();
+
+    while let Some(color) = colors.get(led) {
+        let grb = (color.g as u32) << 16 | (color.r as u32) << 8 | color.b as u32;
+        //MSB of the next bit at bit 31
+        let mut word = grb << (8 + bit);
+        for _ in bit..BITS_PER_LED {
+            match out.next() {
+                Some(duty) => *duty = if word & 0x8000_0000 != 0 { t1 } else { t0 },
+                None => return,
+            }
+            word <<= 1;
+        }
+        bit = 0;
+        led += 1;
+    }
+    for duty in out {
+        *duty = 0;
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    const T0: u16 = 29;
+    const T1: u16 = 58;
+
+    fn reference(colors: &[Rgb], bit: usize) -> u16 {
+        match colors.get(bit / 24) {
+            Some(c) => {
+                let grb = (c.g as u32) << 16 | (c.r as u32) << 8 | c.b as u32;
+                if grb & (1 << (23 - bit % 24)) != 0 {
+                    T1
+                } else {
+                    T0
+                }
+            }
+            None => 0,
+        }
+    }
+
+    #[test]
+    fn grb_msb_first() {
+        let colors = [Rgb::new(0x80, 0x01, 0xff)];
+        let mut out = [0xffff_u16; 30];
+        encode(&colors, 0, &mut out, T0, T1);
+        //green 0x01
+        assert_eq!(out[..8], [T0, T0, T0, T0, T0, T0, T0, T1]);
+        //red 0x80
+        assert_eq!(out[8..16], [T1, T0, T0, T0, T0, T0, T0, T0]);
+        assert_eq!(out[16..24], [T1; 8]);
+        assert_eq!(out[24..], [0; 6]);
+    }
+
+    #[test]
+    fn halves_split_anywhere() {
+        let colors = [
+            Rgb::new(0x12, 0x34, 0x56),
+            Rgb::new(0xa5, 0x5a, 0xc3),
+            Rgb::new(0x00, 0xff, 0x0f),
+        ];
+        for n in [5_usize, 17, 24, 40] {
+            let mut half = [0_u16; 40];
+            for first in (0..colors.len() * 24 + n).step_by(n) {
+                encode(&colors, first, &mut half[..n], T0, T1);
+                for (idx, duty) in half[..n].iter().enumerate() {
+                    assert_eq!(*duty, reference(&colors, first + idx), "{} {}", n, first);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,548 @@
+use super::{Tim, TimClaim};
+use crate::dma::{Dma, DmaRequest, DmaRing};
+use crate::ll_api::{ll_cmd::*, CaptureCtrl};
+#[cfg(feature = "embassy")]
+use embassy_sync::waitqueue::AtomicWaker;
+use portable_atomic::{AtomicU32, Ordering};
+
+const CAPTURE_MODE_PWM_INPUT: u32 = 0;
+const CAPTURE_MODE_EDGES: u32 = 1;
+const CAPTURE_FILTER_SHIFT: u32 = 4;
+const CAPTURE_EVENT_OVERFLOW: u32 = 0x01;
+const CAPTURE_NOT_READY: i32 = -5;
+
+const TIM_CH1_REQUESTS: [DmaRequest; 4] = [
+    DmaRequest::Tim1Ch1,
+    DmaRequest::Tim2Ch1,
+    DmaRequest::Tim3Ch1,
+    DmaRequest::Tim4Ch1,
+];
+
+/// Overflow records kept per timer, `next_edge()` must run at least once per 4 counter
+/// periods to extend the timestamps.
+const RECORDS: usize = 4;
+
+/// Counter overflows of an `InputCapture`, written by the timer interrupt.
+struct CaptureState {
+    overflows: AtomicU32,
+    /// `(dma_left << 16) | cnt` read by the interrupt of overflow `k`, in slot `k % RECORDS`.
+    records: [AtomicU32; RECORDS],
+    #[cfg(feature = "embassy")]
+    waker: AtomicWaker,
+}
+
+const NEW_CAPTURE_STATE: CaptureState = CaptureState {
+    overflows: AtomicU32::new(0),
+    records: [
+        AtomicU32::new(0),
+        AtomicU32::new(0),
+        AtomicU32::new(0),
+        AtomicU32::new(0),
+    ],
+    #[cfg(feature = "embassy")]
+    waker: AtomicWaker::new(),
+};
+
+static CAPTURE_STATE: [CaptureState; 4] = [NEW_CAPTURE_STATE; 4];
+
+/// Input edges timestamped by `InputCapture`.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+#[repr(u32)]
+pub enum CaptureEdge {
+    Rising = 0,
+    Falling = 1,
+    Both = 2,
+}
+
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum CaptureError {
+    /// Edges were lost, the ring or the overflow records were not read in time. Reading
+    /// resumes with the newest edge.
+    Overrun,
+}
+
+/// One period of the input measured by `PwmInput`, in counter ticks.
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub struct PwmMeasure {
+    /// From rising edge to rising edge.
+    pub period: u16,
+    /// From rising edge to falling edge.
+    pub high: u16,
+}
+
+impl PwmMeasure {
+    /// Returns the input frequency in Hz, 0 for a zero period.
+    pub fn hz(&self, tick_hz: u32) -> u32 {
+        if self.period == 0 {
+            return 0;
+        }
+        (tick_hz + self.period as u32 / 2) / self.period as u32
+    }
+
+    /// Returns the high time in permille of the period.
+    pub fn duty_permille(&self) -> u16 {
+        if self.period == 0 {
+            return 0;
+        }
+        ((self.high as u32 * 1000 + self.period as u32 / 2) / self.period as u32).min(1000) as u16
+    }
+}
+
+fn capture_ctrl(tim: Tim, ctrl: CaptureCtrl, out: *mut u16) -> i32 {
+    ll_invoke_inner!(INVOKE_ID_TIM_CAPTURE_CTRL, tim, ctrl, out)
+}
+
+/// Period and high time of a PWM input in one timer, without any interrupt.
+///
+/// The input is CH1 of the timer (TIM1: PA8, TIM2: PA0, TIM3: PA6, TIM4: PB6). Each rising edge
+/// latches the period and restarts the counter, the falling edge latches the high time. Periods
+/// longer than 65536 ticks read as stalled.
+#[derive(Debug)]
+pub struct PwmInput {
+    tim: TimClaim,
+    tick_hz: u32,
+}
+
+impl PwmInput {
+    /// Starts measuring on CH1 of `tim`.
+    ///
+    /// # Arguments
+    /// * `tim` - Timer used by no other driver, `Err(-300)` otherwise, `Err(-3)` if PWM channels
+    ///   or the ADC sample rate run on it.
+    /// * `tick_hz` - Counter tick rate, the resolution of the measurement.
+    /// * `filter` - Input filter 0..=15 of the timer, 0 is off.
+    pub fn new(tim: Tim, tick_hz: u32, filter: u8) -> Result<Self, i32> {
+        let tim = TimClaim::take(tim)?;
+        let flags = ((filter & 0x0F) as u32) << CAPTURE_FILTER_SHIFT;
+        let result = ll_invoke_inner!(
+            INVOKE_ID_TIM_CAPTURE_INIT,
+            tim.tim(),
+            CAPTURE_MODE_PWM_INPUT,
+            tick_hz,
+            flags,
+            0,
+            core::ptr::null_mut::<u32>()
+        );
+        if result != 0 {
+            return Err(result);
+        }
+        let input = PwmInput { tim, tick_hz };
+        capture_ctrl(input.tim.tim(), CaptureCtrl::Start, core::ptr::null_mut());
+        Ok(input)
+    }
+
+    pub fn tick_hz(&self) -> u32 {
+        self.tick_hz
+    }
+
+    /// Returns the period measured since the last read.
+    ///
+    /// # Returns
+    /// * `WouldBlock` if no new period ended.
+    /// * `Other(-6)` if there was no rising edge for 65536 ticks, the input is stalled or too slow
+    ///   for `tick_hz`.
+    pub fn read(&mut self) -> nb::Result<PwmMeasure, i32> {
+        let mut out = [0_u16; 2];
+        match capture_ctrl(self.tim.tim(), CaptureCtrl::ReadPwm, out.as_mut_ptr()) {
+            0 => Ok(PwmMeasure {
+                period: out[0],
+                high: out[1],
+            }),
+            CAPTURE_NOT_READY => Err(nb::Error::WouldBlock),
+            code => Err(nb::Error::Other(code)),
+        }
+    }
+}
+
+impl Drop for PwmInput {
+    fn drop(&mut self) {
+        ll_invoke_inner!(INVOKE_ID_TIM_CAPTURE_DEINIT, self.tim.tim());
+    }
+}
+
+/// Edge timestamps of an input, captured by the timer and moved into a ring by the DMA.
+///
+/// The input is CH1 of the timer (TIM1: PA8, TIM2: PA0, TIM3: PA6, TIM4: PB6). The counter runs
+/// free at the tick rate, every selected edge latches it and the DMA copies the 16-bit value, so
+/// edges cost no CPU time. The timer interrupts once per counter overflow only, `next_edge()`
+/// extends the values to 32-bit timestamps with the DMA position recorded by that interrupt.
+pub struct InputCapture<const N: usize> {
+    ring: DmaRing<u16, N>,
+    tim: TimClaim,
+    tick_hz: u32,
+    read: u32,
+    ext: EdgeExtender,
+}
+
+impl<const N: usize> InputCapture<N> {
+    /// Starts capturing edges on CH1 of `tim`.
+    ///
+    /// # Arguments
+    /// * `tim` - Timer used by no other driver, `Err(-300)` otherwise, `Err(-3)` if PWM channels
+    ///   or the ADC sample rate run on it.
+    /// * `tick_hz` - Counter tick rate, the resolution of the timestamps.
+    /// * `edge` - Edges to capture.
+    /// * `filter` - Input filter 0..=15 of the timer, 0 is off.
+    /// * `buf` - Ring of captures, `N` must be a power of two. Holds up to `N - 1` edges not read
+    ///   yet.
+    pub fn new(
+        tim: Tim,
+        tick_hz: u32,
+        edge: CaptureEdge,
+        filter: u8,
+        buf: &'static mut [u16; N],
+    ) -> Result<Self, i32> {
+        let tim = TimClaim::take(tim)?;
+        let dma = Dma::request(TIM_CH1_REQUESTS[tim.tim() as usize])?;
+
+        let flags = edge as u32 | ((filter & 0x0F) as u32) << CAPTURE_FILTER_SHIFT;
+        let mut ccr: u32 = 0;
+        let result = ll_invoke_inner!(
+            INVOKE_ID_TIM_CAPTURE_INIT,
+            tim.tim(),
+            CAPTURE_MODE_EDGES,
+            tick_hz,
+            flags,
+            dma.channel(),
+            &mut ccr as *mut u32
+        );
+        if result != 0 {
+            return Err(result);
+        }
+
+        let ring = match DmaRing::new(dma, ccr as usize, buf) {
+            Ok(ring) => ring,
+            Err(code) => {
+                ll_invoke_inner!(INVOKE_ID_TIM_CAPTURE_DEINIT, tim.tim());
+                return Err(code);
+            }
+        };
+        CAPTURE_STATE[tim.tim() as usize]
+            .overflows
+            .store(0, Ordering::Release);
+        let mut capture = InputCapture {
+            ring,
+            tim,
+            tick_hz,
+            read: 0,
+            ext: EdgeExtender::new(),
+        };
+        capture.ring.start()?;
+        capture_ctrl(capture.tim.tim(), CaptureCtrl::Start, core::ptr::null_mut());
+        Ok(capture)
+    }
+
+    pub fn tick_hz(&self) -> u32 {
+        self.tick_hz
+    }
+
+    /// Returns the number of captured edges not read yet.
+    pub fn pending(&self) -> u32 {
+        self.ring.written().wrapping_sub(self.read)
+    }
+
+    /// Returns the timestamp of the oldest edge not read yet, in ticks since the start. The
+    /// timestamps wrap after 2^32 ticks, use wrapping differences for periods.
+    pub fn next_edge(&mut self) -> nb::Result<u32, CaptureError> {
+        let state = &CAPTURE_STATE[self.tim.tim() as usize];
+        //edges moved before the snapshot, their overflows are all recorded
+        let written = self.ring.written();
+        let log = OverflowLog::snapshot(state, &self.ring, N);
+
+        if self.ring.is_error()
+            || written.wrapping_sub(self.read) >= N as u32
+            || log.total.wrapping_sub(self.ext.applied) > RECORDS as u32
+        {
+            return Err(nb::Error::Other(self.resync(state)));
+        }
+        if written == self.read {
+            self.ext.settle(self.read, |k| log.get(k));
+            return Err(nb::Error::WouldBlock);
+        }
+
+        let idx = self.read;
+        let value = self.ring.item(idx);
+        if self.ring.written().wrapping_sub(idx) > N as u32 {
+            return Err(nb::Error::Other(self.resync(state)));
+        }
+        self.read = idx.wrapping_add(1);
+        Ok(self.ext.extend(idx, value, |k| log.get(k)))
+    }
+
+    /// Waits for the next edge without blocking the executor, see `next_edge()`. The capture
+    /// interrupt is enabled only while no edge is pending.
+    #[cfg(feature = "embassy")]
+    pub async fn async_next_edge(&mut self) -> Result<u32, CaptureError> {
+        let tim = self.tim.tim();
+        core::future::poll_fn(|cx| {
+            CAPTURE_STATE[tim as usize].waker.register(cx.waker());
+            match self.next_edge() {
+                Err(nb::Error::WouldBlock) => {}
+                Ok(time) => return core::task::Poll::Ready(Ok(time)),
+                Err(nb::Error::Other(e)) => return core::task::Poll::Ready(Err(e)),
+            }
+            capture_ctrl(tim, CaptureCtrl::EdgeIrq, core::ptr::null_mut());
+            //an edge captured before the interrupt was enabled
+            match self.next_edge() {
+                Err(nb::Error::WouldBlock) => core::task::Poll::Pending,
+                Ok(time) => core::task::Poll::Ready(Ok(time)),
+                Err(nb::Error::Other(e)) => core::task::Poll::Ready(Err(e)),
+            }
+        })
+        .await
+    }
+
+    /// Skips to the newest edge after lost data.
+    fn resync(&mut self, state: &CaptureState) -> CaptureError {
+        let (total, written) = loop {
+            let total = state.overflows.load(Ordering::Acquire);
+            let written = self.ring.written();
+            if state.overflows.load(Ordering::Acquire) == total {
+                break (total, written);
+            }
+        };
+        self.read = written;
+        self.ext.resync(total, written);
+        CaptureError::Overrun
+    }
+}
+
+impl<const N: usize> Drop for InputCapture<N> {
+    fn drop(&mut self) {
+        capture_ctrl(self.tim.tim(), CaptureCtrl::Stop, core::ptr::null_mut());
+        ll_invoke_inner!(INVOKE_ID_TIM_CAPTURE_DEINIT, self.tim.tim());
+    }
+}
+
+/// Counter overflow, `pos` is the number of edges the DMA had moved when the interrupt read
+/// the counter value `cnt`.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+struct OverflowRecord {
+    pos: u32,
+    cnt: u16,
+}
+
+/// Consistent copy of the overflow records of a timer.
+struct OverflowLog {
+    total: u32,
+    records: [Option<OverflowRecord>; RECORDS],
+}
+
+impl OverflowLog {
+    fn snapshot<const N: usize>(state: &CaptureState, ring: &DmaRing<u16, N>, n: usize) -> Self {
+        loop {
+            let total = state.overflows.load(Ordering::Acquire);
+            let mut raw = [0_u32; RECORDS];
+            for (raw, rec) in raw.iter_mut().zip(&state.records) {
+                *raw = rec.load(Ordering::Acquire);
+            }
+            //every recorded position is at most written, and less than n behind it
+            let written = ring.written();
+            if state.overflows.load(Ordering::Acquire) != total {
+                continue;
+            }
+
+            let mut records = [None; RECORDS];
+            for k in total.saturating_sub(RECORDS as u32)..total {
+                let raw = raw[k as usize % RECORDS];
+                let slot = (n as u32).wrapping_sub(raw >> 16) & (n as u32 - 1);
+                let back = written.wrapping_sub(slot) & (n as u32 - 1);
+                records[k as usize % RECORDS] = Some(OverflowRecord {
+                    pos: written.wrapping_sub(back),
+                    cnt: raw as u16,
+                });
+            }
+            return OverflowLog { total, records };
+        }
+    }
+
+    fn get(&self, k: u32) -> Option<OverflowRecord> {
+        if k >= self.total || self.total - k > RECORDS as u32 {
+            return None;
+        }
+        self.records[k as usize % RECORDS]
+    }
+}
+
+/// Extends 16-bit captures of a free running counter to 32 bits.
+///
+/// Captures at or after the position of an overflow record happened after the overflow. A
+/// capture before it happened after the previous record and either late in the old counter
+/// period or early in the new one, before the interrupt ran. The value decides: early values up
+/// to the counter read by the interrupt belong to the new period, unless the old period fits
+/// too, i.e. the value is past the previous record and not older than the last timestamp.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+struct EdgeExtender {
+    /// Overflows applied, the upper 16 bits of the timestamps.
+    applied: u32,
+    prev_pos: u32,
+    prev_cnt: u16,
+    last: u32,
+}
+
+impl EdgeExtender {
+    const fn new() -> Self {
+        EdgeExtender {
+            applied: 0,
+            prev_pos: 0,
+            prev_cnt: 0,
+            last: 0,
+        }
+    }
+
+    fn apply(&mut self, rec: OverflowRecord) {
+        self.applied = self.applied.wrapping_add(1);
+        self.prev_pos = rec.pos;
+        self.prev_cnt = rec.cnt;
+    }
+
+    /// Applies the overflows before capture `read`, when no capture is pending.
+    fn settle(&mut self, read: u32, record: impl Fn(u32) -> Option<OverflowRecord>) {
+        while let Some(rec) = record(self.applied) {
+            if (read.wrapping_sub(rec.pos) as i32) < 0 {
+                break;
+            }
+            self.apply(rec);
+        }
+    }
+
+    /// Returns the timestamp of capture `idx` with counter value `value`.
+    fn extend(
+        &mut self,
+        idx: u32,
+        value: u16,
+        record: impl Fn(u32) -> Option<OverflowRecord>,
+    ) -> u32 {
+        while let Some(rec) = record(self.applied) {
+            if idx.wrapping_sub(rec.pos) as i32 >= 0 {
+                self.apply(rec);
+                continue;
+            }
+            let old = (self.applied << 16) | value as u32;
+            if idx.wrapping_sub(self.prev_pos) as i32 >= 0
+                && value <= rec.cnt
+                && (value < self.prev_cnt || (old.wrapping_sub(self.last) as i32) < 0)
+            {
+                self.apply(rec);
+            }
+            break;
+        }
+
+        self.last = (self.applied << 16) | value as u32;
+        self.last
+    }
+
+    /// Restarts after lost data, `total` overflows happened before capture `pos`.
+    fn resync(&mut self, total: u32, pos: u32) {
+        self.applied = total;
+        self.prev_pos = pos;
+        self.prev_cnt = 0;
+        self.last = total << 16;
+    }
+}
+
+#[allow(non_snake_case)]
+#[no_mangle]
+unsafe extern "C" fn TIM_CAPTURE_hook_rs(id: u32, events: u32, dma_left: u32, cnt: u32) {
+    let state = match CAPTURE_STATE.get(id as usize) {
+        Some(state) => state,
+        None => return,
+    };
+    if events & CAPTURE_EVENT_OVERFLOW != 0 {
+        let k = state.overflows.load(Ordering::Relaxed);
+        state.records[k as usize % RECORDS]
+            .store((dma_left << 16) | (cnt & 0xFFFF), Ordering::Release);
+        state.overflows.store(k.wrapping_add(1), Ordering::Release);
+    }
+    #[cfg(feature = "embassy")]
+    state.waker.wake();
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    /// Free running counter with edges and overflow interrupts of a fixed latency.
+    struct Sim {
+        edges: [u32; 16],
+        len: usize,
+        records: [OverflowRecord; 16],
+        overflows: u32,
+    }
+
+    impl Sim {
+        fn run(edges: &[u32], latency: u32, end: u32) -> Self {
+            let mut sim = Sim {
+                edges: [0; 16],
+                len: edges.len(),
+                records: [OverflowRecord { pos: 0, cnt: 0 }; 16],
+                overflows: 0,
+            };
+            sim.edges[..edges.len()].copy_from_slice(edges);
+            let mut ovf = 1_u32 << 16;
+            while ovf + latency < end {
+                //the interrupt reads the DMA position, then the counter
+                let read = ovf + latency;
+                let pos = edges.iter().filter(|t| **t < read).count() as u32;
+                sim.records[sim.overflows as usize] = OverflowRecord {
+                    pos,
+                    cnt: read as u16,
+                };
+                sim.overflows += 1;
+                ovf += 1 << 16;
+            }
+            sim
+        }
+
+        fn record(&self, k: u32) -> Option<OverflowRecord> {
+            if k < self.overflows {
+                Some(self.records[k as usize])
+            } else {
+                None
+            }
+        }
+
+        fn extend_all(&self) -> [u32; 16] {
+            let mut ext = EdgeExtender::new();
+            let mut out = [0; 16];
+            for idx in 0..self.len {
+                out[idx] = ext.extend(idx as u32, self.edges[idx] as u16, |k| self.record(k));
+            }
+            out
+        }
+    }
+
+    #[test]
+    fn extends_around_overflows() {
+        //edges just before and after overflows, before and after the interrupt ran
+        let edges = [
+            100, 65_530, 65_536, 65_540, 65_600, 131_000, 131_073, 140_000, 262_150, 262_200,
+        ];
+        for latency in [3, 20, 50] {
+            let sim = Sim::run(&edges, latency, 300_000);
+            let out = sim.extend_all();
+            assert_eq!(out[..edges.len()], edges, "latency {}", latency);
+        }
+    }
+
+    #[test]
+    fn slow_input_and_settle() {
+        //one edge every few counter periods, early in the period
+        let edges = [5, 200_000, 400_010, 655_370];
+        let sim = Sim::run(&edges, 10, 700_000);
+        assert_eq!(sim.extend_all()[..edges.len()], edges);
+
+        //waiting without pending edges applies the overflows which are behind
+        let mut ext = EdgeExtender::new();
+        assert_eq!(ext.extend(0, 5, |k| sim.record(k)), 5);
+        ext.settle(1, |k| sim.record(k).filter(|_| k < 2));
+        assert_eq!(ext.applied, 2);
+        assert_eq!(
+            ext.extend(1, 200_000_u32 as u16, |k| sim.record(k)),
+            200_000
+        );
+
+        ext.resync(8, 3);
+        assert_eq!(ext.extend(3, 1234, |_| None), (8 << 16) | 1234);
+    }
+}
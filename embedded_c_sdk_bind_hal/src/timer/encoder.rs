@@ -0,0 +1,166 @@
+use super::{Tim, TimClaim};
+use crate::ll_api::{ll_cmd::*, EncoderCtrl};
+
+const ENCODER_FILTER_SHIFT: u32 = 4;
+
+/// Edges counted by an `Encoder`.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+#[repr(u32)]
+pub enum EncoderMode {
+    /// Both edges of CH1 and CH2, four counts per quadrature cycle.
+    X4 = 0,
+    /// Both edges of CH1 only, two counts per quadrature cycle.
+    X2 = 1,
+}
+
+/// Position read with the time of the read.
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub struct EncoderSample {
+    pub position: i32,
+    /// Core clock cycles, wraps after 2^32.
+    pub time: u32,
+}
+
+impl EncoderSample {
+    /// Returns the counts per second from `since` to this sample, `None` if no time passed.
+    ///
+    /// The samples must be less than 2^32 core clock cycles apart.
+    pub fn counts_per_sec(&self, since: &EncoderSample, clock_hz: u32) -> Option<i32> {
+        let dt = self.time.wrapping_sub(since.time) as i64;
+        if dt == 0 {
+            return None;
+        }
+        let counts = self.position.wrapping_sub(since.position) as i64;
+        let scaled = counts * clock_hz as i64;
+        let rate = if scaled < 0 {
+            (scaled - dt / 2) / dt
+        } else {
+            (scaled + dt / 2) / dt
+        };
+        Some(rate.clamp(i32::MIN as i64, i32::MAX as i64) as i32)
+    }
+}
+
+fn encoder_ctrl(tim: Tim, ctrl: EncoderCtrl, out: *mut u32) -> i32 {
+    ll_invoke_inner!(INVOKE_ID_TIM_ENCODER_CTRL, tim, ctrl, out)
+}
+
+/// Quadrature encoder decoded by a timer in encoder mode.
+///
+/// The inputs are CH1/CH2 of the timer (TIM1: PA8/PA9, TIM2: PA0/PA1, TIM3: PA6/PA7,
+/// TIM4: PB6/PB7). The inputs clock the counter, so counts cost no CPU time up to the rate of
+/// the input filter. The timer interrupts three times per 65536 counts to extend the position
+/// to 32 bits, which wraps.
+#[derive(Debug)]
+pub struct Encoder {
+    tim: TimClaim,
+    clock_hz: u32,
+    last: EncoderSample,
+}
+
+impl Encoder {
+    /// Starts decoding CH1/CH2 of `tim` at position 0.
+    ///
+    /// # Arguments
+    /// * `tim` - Timer used by no other driver, `Err(-300)` otherwise, `Err(-3)` if PWM channels
+    ///   or the ADC sample rate run on it.
+    /// * `mode` - Edges counted.
+    /// * `filter` - Input filter 0..=15 of the timer, 0 is off. Higher values reject longer
+    ///   glitches and lower the maximum count rate.
+    pub fn new(tim: Tim, mode: EncoderMode, filter: u8) -> Result<Self, i32> {
+        let tim = TimClaim::take(tim)?;
+        let flags = mode as u32 | ((filter & 0x0F) as u32) << ENCODER_FILTER_SHIFT;
+        let result = ll_invoke_inner!(INVOKE_ID_TIM_ENCODER_INIT, tim.tim(), flags);
+        if result != 0 {
+            return Err(result);
+        }
+
+        let mut clock_hz: u32 = 0;
+        encoder_ctrl(tim.tim(), EncoderCtrl::GetClock, &mut clock_hz as *mut u32);
+        let mut encoder = Encoder {
+            tim,
+            clock_hz,
+            last: EncoderSample::default(),
+        };
+        encoder.last = encoder.sample();
+        Ok(encoder)
+    }
+
+    /// Returns the current position.
+    pub fn position(&self) -> i32 {
+        self.sample().position
+    }
+
+    /// Moves the position to `position` without losing counts in progress.
+    pub fn set_position(&mut self, position: i32) {
+        let mut out = [position as u32, 0];
+        encoder_ctrl(self.tim.tim(), EncoderCtrl::Set, out.as_mut_ptr());
+        self.last = self.sample();
+    }
+
+    /// Returns the current position with its timestamp, read together.
+    pub fn sample(&self) -> EncoderSample {
+        let mut out = [0_u32; 2];
+        encoder_ctrl(self.tim.tim(), EncoderCtrl::Read, out.as_mut_ptr());
+        EncoderSample {
+            position: out[0] as i32,
+            time: out[1],
+        }
+    }
+
+    /// Rate of the timestamps of `EncoderSample`, the core clock.
+    pub fn clock_hz(&self) -> u32 {
+        self.clock_hz
+    }
+
+    /// Returns the average counts per second since the previous call, or since `new()` or
+    /// `set_position()`.
+    ///
+    /// Calls must be less than 2^32 core clock cycles apart, e.g. 29 s at 144 MHz. The
+    /// resolution is one count per interval, call at a fixed period for a steady estimate.
+    pub fn velocity(&mut self) -> i32 {
+        let now = self.sample();
+        match now.counts_per_sec(&self.last, self.clock_hz) {
+            Some(rate) => {
+                self.last = now;
+                rate
+            }
+            None => 0,
+        }
+    }
+}
+
+impl Drop for Encoder {
+    fn drop(&mut self) {
+        ll_invoke_inner!(INVOKE_ID_TIM_ENCODER_DEINIT, self.tim.tim());
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn at(position: i32, time: u32) -> EncoderSample {
+        EncoderSample { position, time }
+    }
+
+    #[test]
+    fn counts_per_sec_across_wraps() {
+        let clk = 144_000_000;
+        //1200 counts in 10 ms
+        assert_eq!(
+            at(1200, 1_440_000).counts_per_sec(&at(0, 0), clk),
+            Some(120_000)
+        );
+        //backwards, over the position and time wraps
+        let since = at(i32::MIN + 5, u32::MAX - 720_000 + 1);
+        assert_eq!(
+            at(i32::MAX - 4, 720_000).counts_per_sec(&since, clk),
+            Some(-1000)
+        );
+        //one count rounds to the nearest rate
+        assert_eq!(at(1, 3).counts_per_sec(&at(0, 0), 10), Some(3));
+        assert_eq!(at(-1, 3).counts_per_sec(&at(0, 0), 10), Some(-3));
+        assert_eq!(at(7, 5).counts_per_sec(&at(0, 5), clk), None);
+    }
+}
@@ -0,0 +1,400 @@
+use super::{Tim, TimClaim};
+use crate::ll_api::{ll_cmd::*, HwTimerCtrl};
+use core::cell::RefCell;
+use embassy_sync::blocking_mutex::{raw::CriticalSectionRawMutex, Mutex};
+#[cfg(feature = "embassy")]
+use embassy_sync::waitqueue::AtomicWaker;
+use portable_atomic::{AtomicU32, AtomicU8, Ordering};
+
+/// Tick rate of `HwTimer`, times and deadlines are in microseconds.
+pub const HWTIMER_TICK_HZ: u32 = 1_000_000;
+
+/// Alarms an `HwTimer` serves at a time.
+pub const HWTIMER_ALARMS: usize = 8;
+
+const NO_TIMER: u8 = 0xFF;
+const TIMS: [Tim; 4] = [Tim::Tim1, Tim::Tim2, Tim::Tim3, Tim::Tim4];
+
+/// Called from the timer interrupt with the deadline that passed. `Some(at)` re-arms the alarm
+/// at `at`, for sequences of uneven intervals. `None` keeps the period of a periodic alarm and
+/// ends a one-shot alarm.
+pub type AlarmCallback = fn(u32) -> Option<u32>;
+
+#[derive(Clone, Copy, Debug)]
+struct AlarmSlot {
+    used: bool,
+    armed: bool,
+    at: u32,
+    period: u32,
+    callback: Option<AlarmCallback>,
+}
+
+const FREE_SLOT: AlarmSlot = AlarmSlot {
+    used: false,
+    armed: false,
+    at: 0,
+    period: 0,
+    callback: None,
+};
+
+/// Armed alarms sorted by deadline. Deadlines wrap, they are ordered by their distance to
+/// the current time and must be less than 2^31 ticks away.
+struct AlarmQueue {
+    slots: [AlarmSlot; HWTIMER_ALARMS],
+    order: [u8; HWTIMER_ALARMS],
+    len: usize,
+}
+
+impl AlarmQueue {
+    const fn new() -> Self {
+        AlarmQueue {
+            slots: [FREE_SLOT; HWTIMER_ALARMS],
+            order: [0; HWTIMER_ALARMS],
+            len: 0,
+        }
+    }
+
+    fn alloc(&mut self) -> Option<usize> {
+        let idx = self.slots.iter().position(|slot| !slot.used)?;
+        self.slots[idx] = AlarmSlot {
+            used: true,
+            ..FREE_SLOT
+        };
+        Some(idx)
+    }
+
+    fn free(&mut self, idx: usize) {
+        self.disarm(idx);
+        self.slots[idx] = FREE_SLOT;
+    }
+
+    fn disarm(&mut self, idx: usize) {
+        if !self.slots[idx].armed {
+            return;
+        }
+        self.slots[idx].armed = false;
+        if let Some(k) = self.order[..self.len]
+            .iter()
+            .position(|i| *i as usize == idx)
+        {
+            self.order.copy_within(k + 1..self.len, k);
+            self.len -= 1;
+        }
+    }
+
+    fn arm(&mut self, idx: usize, at: u32, now: u32) {
+        self.disarm(idx);
+        let dist = at.wrapping_sub(now) as i32;
+        let k = self.order[..self.len]
+            .iter()
+            .position(|i| self.slots[*i as usize].at.wrapping_sub(now) as i32 > dist)
+            .unwrap_or(self.len);
+        self.order.copy_within(k..self.len, k + 1);
+        self.order[k] = idx as u8;
+        self.len += 1;
+        self.slots[idx].at = at;
+        self.slots[idx].armed = true;
+    }
+
+    /// Removes the earliest alarm if its deadline passed.
+    fn pop_due(&mut self, now: u32) -> Option<usize> {
+        let idx = *self.order[..self.len].first()? as usize;
+        if self.slots[idx].at.wrapping_sub(now) as i32 > 0 {
+            return None;
+        }
+        self.disarm(idx);
+        Some(idx)
+    }
+
+    fn head(&self) -> Option<u32> {
+        let idx = *self.order[..self.len].first()? as usize;
+        Some(self.slots[idx].at)
+    }
+}
+
+/// The next deadline of a periodic alarm after `now`, skipping periods missed without drift.
+fn next_period(at: u32, period: u32, now: u32) -> u32 {
+    let next = at.wrapping_add(period);
+    let late = now.wrapping_sub(next) as i32;
+    if late < 0 {
+        return next;
+    }
+    let missed = late as u32 / period + 1;
+    next.wrapping_add(missed.wrapping_mul(period))
+}
+
+static HWTIMER_TIM: AtomicU8 = AtomicU8::new(NO_TIMER);
+static QUEUE: Mutex<CriticalSectionRawMutex, RefCell<AlarmQueue>> =
+    Mutex::new(RefCell::new(AlarmQueue::new()));
+static FIRED: AtomicU32 = AtomicU32::new(0); //bit per alarm
+#[cfg(feature = "embassy")]
+const NEW_WAKER: AtomicWaker = AtomicWaker::new();
+#[cfg(feature = "embassy")]
+static WAKERS: [AtomicWaker; HWTIMER_ALARMS] = [NEW_WAKER; HWTIMER_ALARMS];
+
+fn hwtimer_ctrl(tim: Tim, ctrl: HwTimerCtrl, value: u32) -> u32 {
+    let mut out = value;
+    ll_invoke_inner!(INVOKE_ID_TIM_HWTIMER_CTRL, tim, ctrl, &mut out as *mut u32);
+    out
+}
+
+fn hwtimer_now(tim: Tim) -> u32 {
+    hwtimer_ctrl(tim, HwTimerCtrl::Now, 0)
+}
+
+/// Points the timer alarm at the earliest deadline, the queue is locked.
+fn program(tim: Tim, queue: &AlarmQueue) {
+    match queue.head() {
+        Some(at) => hwtimer_ctrl(tim, HwTimerCtrl::SetAlarm, at),
+        None => hwtimer_ctrl(tim, HwTimerCtrl::Cancel, 0),
+    };
+}
+
+/// Microsecond time and alarms on a general purpose timer.
+///
+/// The counter runs free at 1 MHz and interrupts once per 65536 us to extend the time to
+/// 32 bits, which wraps after 71 minutes. The alarms are kept sorted by deadline, the compare
+/// register of CH1 is programmed for the earliest one, so the timer interrupts only at
+/// deadlines. Callbacks run in the timer interrupt, at some microseconds of latency.
+///
+/// One `HwTimer` runs at a time.
+#[derive(Debug)]
+pub struct HwTimer {
+    tim: TimClaim,
+}
+
+impl HwTimer {
+    /// Starts the time at 0 on `tim`.
+    ///
+    /// # Returns
+    /// * `Err(-300)` if `tim` is used by another driver or an `HwTimer` already runs, `Err(-3)` if
+    ///   PWM channels or the ADC sample rate run on `tim`.
+    pub fn new(tim: Tim) -> Result<Self, i32> {
+        let tim = TimClaim::take(tim)?;
+        if HWTIMER_TIM
+            .compare_exchange(
+                NO_TIMER,
+                tim.tim() as u8,
+                Ordering::AcqRel,
+                Ordering::Acquire,
+            )
+            .is_err()
+        {
+            return Err(-300);
+        }
+        QUEUE.lock(|q| *q.borrow_mut() = AlarmQueue::new());
+        FIRED.store(0, Ordering::Release);
+
+        let result = ll_invoke_inner!(INVOKE_ID_TIM_HWTIMER_INIT, tim.tim(), HWTIMER_TICK_HZ);
+        if result != 0 {
+            HWTIMER_TIM.store(NO_TIMER, Ordering::Release);
+            return Err(result);
+        }
+        Ok(HwTimer { tim })
+    }
+
+    /// Returns the time in microseconds since `new()`, wrapping.
+    pub fn now(&self) -> u32 {
+        hwtimer_now(self.tim.tim())
+    }
+
+    /// Waits `us` microseconds, busy.
+    pub fn delay_us(&self, us: u32) {
+        let start = self.now();
+        while self.now().wrapping_sub(start) < us {}
+    }
+
+    /// Returns a stopped alarm of this timer.
+    ///
+    /// # Returns
+    /// * `Err(-300)` if all `HWTIMER_ALARMS` alarms are in use.
+    pub fn alarm(&self, callback: Option<AlarmCallback>) -> Result<Alarm<'_>, i32> {
+        let idx = QUEUE.lock(|q| {
+            let mut q = q.borrow_mut();
+            let idx = q.alloc()?;
+            q.slots[idx].callback = callback;
+            Some(idx)
+        });
+        match idx {
+            Some(idx) => Ok(Alarm { timer: self, idx }),
+            None => Err(-300),
+        }
+    }
+}
+
+impl Drop for HwTimer {
+    fn drop(&mut self) {
+        ll_invoke_inner!(INVOKE_ID_TIM_HWTIMER_DEINIT, self.tim.tim());
+        HWTIMER_TIM.store(NO_TIMER, Ordering::Release);
+    }
+}
+
+/// One-shot or periodic alarm of an `HwTimer`, stopped when dropped.
+///
+/// Deadlines are absolute times of `HwTimer::now()` and must be less than 2^31 us ahead. A
+/// deadline already passed fires at once.
+#[derive(Debug)]
+pub struct Alarm<'a> {
+    timer: &'a HwTimer,
+    idx: usize,
+}
+
+impl<'a> Alarm<'a> {
+    fn start(&self, at: u32, period: u32) {
+        let tim = self.timer.tim.tim();
+        FIRED.fetch_and(!(1 << self.idx), Ordering::AcqRel);
+        QUEUE.lock(|q| {
+            let mut q = q.borrow_mut();
+            q.slots[self.idx].period = period;
+            q.arm(self.idx, at, hwtimer_now(tim));
+            program(tim, &q);
+        });
+    }
+
+    /// Fires once at `at`, replacing a pending deadline.
+    pub fn start_at(&self, at: u32) {
+        self.start(at, 0);
+    }
+
+    /// Fires once `us` microseconds from now.
+    pub fn start_after(&self, us: u32) {
+        self.start(self.timer.now().wrapping_add(us), 0);
+    }
+
+    /// Fires every `period_us` microseconds, the first time one period from now. Periods
+    /// missed while interrupts were blocked are skipped, the phase is kept.
+    pub fn start_periodic(&self, period_us: u32) {
+        let period = period_us.max(1);
+        self.start(self.timer.now().wrapping_add(period), period);
+    }
+
+    /// Stops the alarm, it does not fire any more.
+    pub fn cancel(&self) {
+        let tim = self.timer.tim.tim();
+        QUEUE.lock(|q| {
+            let mut q = q.borrow_mut();
+            q.disarm(self.idx);
+            program(tim, &q);
+        });
+    }
+
+    /// Changes the callback, `None` only sets the fired flag and wakes `wait()`.
+    pub fn set_callback(&self, callback: Option<AlarmCallback>) {
+        QUEUE.lock(|q| q.borrow_mut().slots[self.idx].callback = callback);
+    }
+
+    /// Returns true while a deadline is pending.
+    pub fn is_armed(&self) -> bool {
+        QUEUE.lock(|q| q.borrow().slots[self.idx].armed)
+    }
+
+    /// Returns true if the alarm fired since the last call or start, and clears the flag.
+    pub fn take_fired(&self) -> bool {
+        let bit = 1 << self.idx;
+        FIRED.fetch_and(!bit, Ordering::AcqRel) & bit != 0
+    }
+
+    /// Waits until the alarm fires, see `take_fired()`.
+    #[cfg(feature = "embassy")]
+    pub async fn wait(&self) {
+        core::future::poll_fn(|cx| {
+            WAKERS[self.idx].register(cx.waker());
+            if self.take_fired() {
+                core::task::Poll::Ready(())
+            } else {
+                core::task::Poll::Pending
+            }
+        })
+        .await
+    }
+}
+
+impl<'a> Drop for Alarm<'a> {
+    fn drop(&mut self) {
+        let tim = self.timer.tim.tim();
+        QUEUE.lock(|q| {
+            let mut q = q.borrow_mut();
+            q.free(self.idx);
+            program(tim, &q);
+        });
+    }
+}
+
+#[allow(non_snake_case)]
+#[no_mangle]
+unsafe extern "C" fn TIM_HWTIMER_hook_rs(id: u32) {
+    if HWTIMER_TIM.load(Ordering::Acquire) as u32 != id {
+        return;
+    }
+    let tim = TIMS[id as usize];
+
+    //callbacks run outside the lock, alarms cannot be started from thread mode meanwhile
+    loop {
+        let now = hwtimer_now(tim);
+        let due = QUEUE.lock(|q| {
+            let mut q = q.borrow_mut();
+            let idx = q.pop_due(now)?;
+            let slot = q.slots[idx];
+            Some((idx, slot.at, slot.period, slot.callback))
+        });
+        let (idx, at, period, callback) = match due {
+            Some(due) => due,
+            None => break,
+        };
+
+        FIRED.fetch_or(1 << idx, Ordering::AcqRel);
+        #[cfg(feature = "embassy")]
+        WAKERS[idx].wake();
+        let next = match callback.and_then(|callback| callback(at)) {
+            Some(next) => Some(next),
+            None if period != 0 => Some(next_period(at, period, now)),
+            None => None,
+        };
+        if let Some(next) = next {
+            QUEUE.lock(|q| q.borrow_mut().arm(idx, next, now));
+        }
+    }
+    QUEUE.lock(|q| program(tim, &q.borrow()));
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn queue_orders_deadlines_across_the_wrap() {
+        let mut q = AlarmQueue::new();
+        let now = u32::MAX - 100;
+        let a = q.alloc().unwrap();
+        let b = q.alloc().unwrap();
+        let c = q.alloc().unwrap();
+        q.arm(a, 50, now); //after the wrap
+        q.arm(b, u32::MAX - 10, now);
+        q.arm(c, now.wrapping_sub(5), now); //already due
+        assert_eq!(q.head(), Some(now.wrapping_sub(5)));
+
+        assert_eq!(q.pop_due(now), Some(c));
+        assert_eq!(q.pop_due(now), None);
+        assert_eq!(q.pop_due(u32::MAX - 10), Some(b));
+        assert_eq!(q.pop_due(49), None);
+
+        //re-arming moves the alarm
+        q.arm(b, 10, u32::MAX);
+        assert_eq!(q.head(), Some(10));
+        q.free(b);
+        assert_eq!(q.head(), Some(50));
+        assert_eq!(q.alloc(), Some(b));
+        assert_eq!(q.pop_due(50), Some(a));
+        assert_eq!(q.head(), None);
+    }
+
+    #[test]
+    fn periods_skip_missed_deadlines() {
+        assert_eq!(next_period(1000, 100, 1050), 1100);
+        //late by 3 periods, the phase is kept
+        assert_eq!(next_period(1000, 100, 1350), 1400);
+        assert_eq!(next_period(1000, 100, 1100), 1200);
+        assert_eq!(next_period(u32::MAX - 50, 100, 20), 49);
+        assert_eq!(next_period(u32::MAX - 50, 100, 60), 149);
+    }
+}
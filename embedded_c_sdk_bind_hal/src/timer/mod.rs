@@ -0,0 +1,40 @@
+mod capture;
+mod encoder;
+mod hwtimer;
+
+pub use crate::ll_api::Tim;
+pub use capture::*;
+pub use encoder::*;
+pub use hwtimer::*;
+use portable_atomic::{AtomicU8, Ordering};
+
+static TIM_TAKEN: AtomicU8 = AtomicU8::new(0); //bit per timer
+
+/// Exclusive use of a timer by one driver, released when dropped.
+///
+/// Only the drivers of this module and `Motor` take it. The C layer claims the timer again in
+/// its init, so `Pwm`/`PwmOut` channels and the ADC sample rate timer fail with `Err(-3)` on a
+/// timer run by another driver and the other way round.
+#[derive(Debug)]
+pub(crate) struct TimClaim(Tim);
+
+impl TimClaim {
+    /// Returns `Err(-300)` if the timer is in use.
+    pub(crate) fn take(tim: Tim) -> Result<Self, i32> {
+        let bit = 1 << tim as u8;
+        if TIM_TAKEN.fetch_or(bit, Ordering::Acquire) & bit != 0 {
+            return Err(-300);
+        }
+        Ok(TimClaim(tim))
+    }
+
+    pub(crate) fn tim(&self) -> Tim {
+        self.0
+    }
+}
+
+impl Drop for TimClaim {
+    fn drop(&mut self) {
+        TIM_TAKEN.fetch_and(!(1 << self.0 as u8), Ordering::Release);
+    }
+}
@@ -4,7 +4,7 @@ use crate::ll_api::ll_cmd::*;
 use embassy_sync::waitqueue::AtomicWaker;
 
 pub use crate::ll_api::{
-    UsartDataBits, UsartHwFlowCtrl, UsartId, UsartMode, UsartParity, UsartStopBits,
+    UsartAutobaud, UsartDataBits, UsartHwFlowCtrl, UsartId, UsartMode, UsartParity, UsartStopBits,
 };
 
 #[derive(Clone, Copy, PartialEq, Eq, Debug)]
@@ -96,6 +96,46 @@ impl<'a> Usart<'a> {
         )
     }
 
+    /// Reprograms the baud rate in place, without a full re-initialization.
+    ///
+    /// The frame in flight is sent out before the divider changes, so this can be
+    /// called right after the last byte of a speed negotiation.
+    ///
+    /// # Arguments
+    /// * `baudrate` - The new baud rate.
+    ///
+    /// # Returns
+    /// * `Ok(())` on success, or `Error::Code` if the rate is out of range for the bus clock.
+    pub fn set_baudrate(&self, baudrate: u32) -> Result<(), Error> {
+        let result = ll_invoke_inner!(INVOKE_ID_USART_SET_BAUDRATE, self.inner.id, baudrate);
+        if result == 0 {
+            return Ok(());
+        }
+        Err(Error::Code(result))
+    }
+
+    /// Measures the baud rate of the incoming line and switches the USART to it.
+    ///
+    /// The remote side has to send the pattern selected by `mode` after the line has
+    /// been idle for a few milliseconds. The measured char is not delivered to the
+    /// receive buffer.
+    ///
+    /// # Arguments
+    /// * `mode` - The pattern to measure.
+    /// * `timeout_ms` - How long to wait for the pattern, in milliseconds.
+    ///
+    /// # Returns
+    /// * The measured baud rate, or `Error::Code` on timeout (-3), an unusable rate (-2) or an RX
+    ///   pin remapped by AFIO to pins autobaud does not handle (-4, USART1 high remap bit, USART3
+    ///   remap 0b10, UART4 remaps).
+    pub fn autobaud(&self, mode: UsartAutobaud, timeout_ms: u32) -> Result<u32, Error> {
+        let result = ll_invoke_inner!(INVOKE_ID_USART_AUTOBAUD, self.inner.id, mode, timeout_ms);
+        if result > 0 {
+            return Ok(result as u32);
+        }
+        Err(Error::Code(result))
+    }
+
     /// Sets the receive buffer for the USART.
     ///
     /// # Arguments
@@ -3,7 +3,7 @@
 
 use embedded_c_sdk_bind_hal::{
     self as CSDK_HAL,
-    adc::{self, AdcBuffered, AdcChannel},
+    adc::{self, Adc, AdcBuffered, AdcChannel, AdcFilter, AdcInput, AdcSampleTime},
     println,
 };
 
@@ -21,11 +21,25 @@ async fn main(_spawner: Spawner) -> ! {
     let mut adc_ch0_buf: [u16; 16] = [0; 16];
     adc_ch0.set_buf(&mut adc_ch0_buf);
 
+    //16 kHz in, 16 samples summed per output: 1 kHz of 14-bit samples in the ring
+    let _ = adc_ch0.set_sample_rate(16_000);
+    let _ = adc_ch0.set_filter(AdcFilter::Oversample(2));
+
     adc_ch0.start();
     println!("hello embassy!");
     let mut adc_count = 0;
     loop {
         println!("adc buf: {:?}", &adc_ch0_buf);
+        //spot read between two buffered samples, the stream keeps running
+        match Adc::async_inject(&[AdcInput::Vref, AdcInput::In0], AdcSampleTime::Cycles239_5).await
+        {
+            Ok([vref, in0]) => {
+                println!("vref {} in0 {}", vref, in0);
+            }
+            Err(code) => {
+                println!("inject err: {}", code);
+            }
+        }
         Timer::after_ticks(1000 as u64).await;
 
         if adc_count < 10 {
@@ -0,0 +1,79 @@
+#![no_main]
+#![no_std]
+
+use embedded_c_sdk_bind_hal::{
+    self as CSDK_HAL,
+    adc::{AdcInput, AdcSampleTime, AdcScan},
+    println,
+};
+
+use ll_bind_ch32v20x as _;
+use panic_halt as _;
+
+use embassy_executor::Spawner;
+use embassy_time::Timer;
+
+static mut SCAN_BUF: [[u16; 64]; 2] = [[0; 64]; 2];
+
+#[embassy_executor::main(entry = "riscv_rt_macros::entry")]
+async fn main(_spawner: Spawner) -> ! {
+    CSDK_HAL::init();
+
+    let inputs = [AdcInput::Vref, AdcInput::Temp, AdcInput::In0, AdcInput::In1];
+    let mut scan = match AdcScan::new(&inputs, AdcSampleTime::Cycles55_5) {
+        Ok(scan) => scan,
+        Err(code) => {
+            println!("AdcScan err: {}", code);
+            loop {
+                Timer::after_ticks(1000 as u64).await;
+            }
+        }
+    };
+
+    let mut frame = [0_u16; 4];
+    for _ in 0..5 {
+        match scan.async_read(&mut frame).await {
+            Ok(_) => {
+                println!("frame: {:?}", &frame);
+            }
+            Err(code) => {
+                println!("scan err: {}", code);
+            }
+        }
+        Timer::after_ticks(500 as u64).await;
+    }
+
+    //one frame every 100us, a 64 sample half holds 16 frames
+    if let Err(code) = scan.set_sample_rate(10_000) {
+        println!("set_sample_rate err: {}", code);
+    }
+
+    let buf = unsafe { &mut *core::ptr::addr_of_mut!(SCAN_BUF) };
+    let mut stream = match scan.into_stream(buf) {
+        Ok(stream) => stream,
+        Err(code) => {
+            println!("into_stream err: {}", code);
+            loop {
+                Timer::after_ticks(1000 as u64).await;
+            }
+        }
+    };
+
+    let mut blocks = 0_u32;
+    loop {
+        let inputs = stream.inputs();
+        match stream.async_read().await {
+            Ok(block) => {
+                blocks += 1;
+                if blocks % 625 == 0 {
+                    if let Some(frame) = block.chunks_exact(inputs).next() {
+                        println!("block {}: {:?}", blocks, frame);
+                    }
+                }
+            }
+            Err(err) => {
+                println!("stream err: {:?}", err);
+            }
+        }
+    }
+}
@@ -105,6 +105,7 @@ use core::sync::atomic;
 fn panic(_info: &PanicInfo) -> ! {
     //println!("panic: {:?}", _info);
     println!("panic");
+    embedded_c_sdk_bind_hal::print::log_flush();
 
     loop {
         atomic::compiler_fence(atomic::Ordering::SeqCst);
@@ -3,7 +3,7 @@
 
 use embedded_c_sdk_bind_hal::{
     self as CSDK_HAL,
-    dma::{self, Dma, DmaChannel},
+    dma::{self, Dma, DmaChannel, DmaSegment},
     println,
 };
 
@@ -33,6 +33,16 @@ fn main() -> ! {
         }
     }
 
+    if let Err(code) = dma3.on_complete(|event| {
+        println!(
+            "DMA irq: complete {} error {}",
+            event.is_complete(),
+            event.is_error()
+        );
+    }) {
+        println!("DMA on_complete err: {}", code);
+    }
+
     println!("dst before tranfer: {}", &dst);
     match dma3.start() {
         Ok(_) => {
@@ -61,5 +71,37 @@ fn main() -> ! {
 
     println!("dst after tranfer: {}", &dst);
 
+    let src2 = [0x9ABCDEF0_u32; 4];
+    match dma3.reload(
+        src2.as_ptr() as usize,
+        dst.as_mut_ptr() as usize,
+        src2.len(),
+    ) {
+        Ok(_) => {
+            let _ = dma3.wait();
+            let _ = dma3.stop();
+            println!("dst after reload: {}", &dst);
+        }
+        Err(code) => {
+            println!("DMA reload err: {}", code);
+        }
+    }
+
+    let head = [0x11111111_u32; 2];
+    let tail = [0x22222222_u32; 3];
+    let (dst_head, dst_tail) = dst.split_at_mut(2);
+    let segments = [
+        DmaSegment::copy(&head, dst_head).unwrap(),
+        DmaSegment::copy(&tail, dst_tail).unwrap(),
+    ];
+    match dma3.chain(dma::DmaDir::M2M, &segments) {
+        Ok(_) => {
+            println!("dst after chain: {}", &dst);
+        }
+        Err(code) => {
+            println!("DMA chain err: {}", code);
+        }
+    }
+
     loop {}
 }
@@ -0,0 +1,84 @@
+#![no_main]
+#![no_std]
+
+//! CPU vs DMA copy/fill benchmark, to tune `DmaMem::set_cpu_threshold()`.
+//! Select another SYSCLK_FREQ_* in ll_bind_ch32v20x/csrc/c_sdk_lib/system_ch32v20x.c
+//! to compare clock rates.
+
+use embedded_c_sdk_bind_hal::{
+    self as CSDK_HAL,
+    dma::mem::DmaMem,
+    println,
+    tick::{Tick, TICK_FREQ_HZ},
+};
+
+use ll_bind_ch32v20x as _;
+use panic_halt as _;
+
+extern "C" {
+    static SystemCoreClock: u32;
+}
+
+const ROUNDS: u32 = 1000;
+
+#[repr(align(4))]
+struct Buffer([u8; 4096]);
+
+static mut SRC: Buffer = Buffer([0x5A; 4096]);
+static mut DST: Buffer = Buffer([0; 4096]);
+
+fn ns_per_round(start: Tick) -> u32 {
+    (start.elapsed() as u64 * 1_000_000_000 / TICK_FREQ_HZ as u64 / ROUNDS as u64) as u32
+}
+
+#[riscv_rt_macros::entry]
+fn main() -> ! {
+    CSDK_HAL::init();
+    let src = unsafe { &(*core::ptr::addr_of!(SRC)).0 };
+    let dst = unsafe { &mut (*core::ptr::addr_of_mut!(DST)).0 };
+
+    let mut mem = match DmaMem::new() {
+        Ok(mem) => mem,
+        Err(code) => {
+            println!("DmaMem err: {}", code);
+            loop {}
+        }
+    };
+    mem.set_cpu_threshold(0);
+
+    let core_clock = unsafe { SystemCoreClock };
+    println!("\r\nDMA mem benchmark, SystemCoreClock {} Hz", core_clock);
+    println!("bytes   cpu copy   dma copy   cpu fill   dma fill (ns)");
+    for size in [16, 32, 64, 128, 256, 512, 1024, 4096] {
+        let start = Tick::now();
+        for _ in 0..ROUNDS {
+            dst[..size].copy_from_slice(&src[..size]);
+        }
+        let cpu_copy = ns_per_round(start);
+
+        let start = Tick::now();
+        for _ in 0..ROUNDS {
+            let _ = mem.copy(&mut dst[..size], &src[..size]);
+        }
+        let dma_copy = ns_per_round(start);
+
+        let start = Tick::now();
+        for _ in 0..ROUNDS {
+            dst[..size].fill(0xA5);
+        }
+        let cpu_fill = ns_per_round(start);
+
+        let start = Tick::now();
+        for _ in 0..ROUNDS {
+            let _ = mem.fill(&mut dst[..size], 0xA5);
+        }
+        let dma_fill = ns_per_round(start);
+
+        println!(
+            "{:5} {:10} {:10} {:10} {:10}",
+            size, cpu_copy, dma_copy, cpu_fill, dma_fill
+        );
+    }
+
+    loop {}
+}
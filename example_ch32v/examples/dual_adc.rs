@@ -0,0 +1,77 @@
+#![no_main]
+#![no_std]
+
+//! Voltage on PA0 (ADC1) and current on PA1 (ADC2) sampled at the same instant, the mean of
+//! the raw product is printed once per second.
+
+use embedded_c_sdk_bind_hal::{
+    self as CSDK_HAL,
+    adc::{AdcInput, AdcSampleTime, DualAdc, DualSample},
+    println,
+};
+
+use ll_bind_ch32v20x as _;
+use panic_halt as _;
+
+use embassy_executor::Spawner;
+use embassy_time::Timer;
+
+const RATE_HZ: u32 = 8_000;
+const BLOCK: usize = 256;
+
+static mut DUAL_BUF: [[DualSample; BLOCK]; 2] = [[DualSample::ZERO; BLOCK]; 2];
+
+#[embassy_executor::main(entry = "riscv_rt_macros::entry")]
+async fn main(_spawner: Spawner) -> ! {
+    CSDK_HAL::init();
+
+    let mut dual = match DualAdc::new(&[(AdcInput::In0, AdcInput::In1)], AdcSampleTime::Cycles28_5)
+    {
+        Ok(dual) => dual,
+        Err(code) => {
+            println!("DualAdc err: {}", code);
+            loop {
+                Timer::after_ticks(1000 as u64).await;
+            }
+        }
+    };
+
+    let mut frame = [DualSample::ZERO; 1];
+    if dual.read(&mut frame).is_ok() {
+        println!("u {} i {}", frame[0].adc1(), frame[0].adc2());
+    }
+
+    let _ = dual.set_sample_rate(RATE_HZ);
+    let buf = unsafe { &mut *core::ptr::addr_of_mut!(DUAL_BUF) };
+    let mut stream = match dual.into_stream(buf) {
+        Ok(stream) => stream,
+        Err(code) => {
+            println!("into_stream err: {}", code);
+            loop {
+                Timer::after_ticks(1000 as u64).await;
+            }
+        }
+    };
+
+    let mut sum: u64 = 0;
+    let mut count: u32 = 0;
+    loop {
+        match stream.async_read().await {
+            Ok(block) => {
+                for sample in block.iter() {
+                    sum += sample.adc1() as u64 * sample.adc2() as u64;
+                }
+                count += BLOCK as u32;
+                if count >= RATE_HZ {
+                    let mean = (sum / count as u64) as u32;
+                    println!("mean u*i: {}", mean);
+                    sum = 0;
+                    count = 0;
+                }
+            }
+            Err(err) => {
+                println!("stream err: {:?}", err);
+            }
+        }
+    }
+}
@@ -0,0 +1,43 @@
+#![no_main]
+#![no_std]
+
+//! Quadrature encoder on PB6/PB7 (TIM4 CH1/CH2): prints the position and the speed every
+//! 100 ms. The timer counts every edge, the CPU only reads the counter.
+
+use embedded_c_sdk_bind_hal::{
+    self as CSDK_HAL,
+    gpio::{AnyPin, Input, Pull},
+    println,
+    timer::{Encoder, EncoderMode, Tim},
+};
+
+use ll_bind_ch32v20x as _;
+use panic_halt as _;
+
+use embassy_executor::Spawner;
+use embassy_time::Timer;
+
+#[embassy_executor::main(entry = "riscv_rt_macros::entry")]
+async fn main(_spawner: Spawner) -> ! {
+    let p = CSDK_HAL::init();
+
+    let _a = Input::new(p.PB6.into::<AnyPin>(), Pull::Up);
+    let _b = Input::new(p.PB7.into::<AnyPin>(), Pull::Up);
+
+    //filter 6: 8 samples at 1/4 of the timer clock reject contact bounce
+    let mut encoder = match Encoder::new(Tim::Tim4, EncoderMode::X4, 6) {
+        Ok(encoder) => encoder,
+        Err(code) => {
+            println!("Encoder err: {}", code);
+            loop {
+                Timer::after_ticks(1000 as u64).await;
+            }
+        }
+    };
+
+    loop {
+        Timer::after_ticks(100 as u64).await;
+        let speed = encoder.velocity();
+        println!("position {}, {} counts/s", encoder.position(), speed);
+    }
+}
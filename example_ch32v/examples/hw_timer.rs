@@ -0,0 +1,81 @@
+#![no_main]
+#![no_std]
+
+//! Microsecond alarms on TIM4: a 1 kHz software PWM on PB8 whose duty ramps up, driven from
+//! the alarm callback, and a 300 us reply timeout awaited by the main task.
+
+use embedded_c_sdk_bind_hal::{
+    self as CSDK_HAL,
+    gpio::{fast_pin_num::*, FastPin, FastPinModeOutput, FastPinReg, OutputFastPin, PortNum},
+    println,
+    timer::{HwTimer, Tim},
+};
+use portable_atomic::{AtomicU32, Ordering};
+
+use ll_bind_ch32v20x as _;
+use panic_halt as _;
+
+use embassy_executor::Spawner;
+use embassy_time::Timer;
+
+struct PB;
+impl FastPinReg for PB {
+    const PORT: PortNum = PortNum::PB;
+    const IDR: usize = 0x40010C08;
+    const ODR: usize = 0x40010C0C;
+    const BSR: usize = 0x40010C10;
+    const BCR: usize = 0x40010C14;
+}
+
+const PWM_PIN: FastPin<PB, FastPin8, OutputFastPin> = FastPin::new();
+const PWM_PERIOD_US: u32 = 1000;
+
+static HIGH_US: AtomicU32 = AtomicU32::new(100);
+
+//one alarm per edge: high for HIGH_US, low for the rest of the period
+fn pwm_edge(at: u32) -> Option<u32> {
+    let high = HIGH_US.load(Ordering::Relaxed).clamp(1, PWM_PERIOD_US - 1);
+    if PWM_PIN.is_output_high() {
+        PWM_PIN.output_low();
+        Some(at.wrapping_add(PWM_PERIOD_US - high))
+    } else {
+        PWM_PIN.output_high();
+        Some(at.wrapping_add(high))
+    }
+}
+
+#[embassy_executor::main(entry = "riscv_rt_macros::entry")]
+async fn main(_spawner: Spawner) -> ! {
+    let _p = CSDK_HAL::init();
+    FastPin::<PB, FastPin8, ()>::new().into_output(FastPinModeOutput::OutPP);
+
+    let timer = match HwTimer::new(Tim::Tim4) {
+        Ok(timer) => timer,
+        Err(code) => {
+            println!("HwTimer err: {}", code);
+            loop {
+                Timer::after_ticks(1000 as u64).await;
+            }
+        }
+    };
+
+    let pwm = timer.alarm(Some(pwm_edge)).unwrap();
+    pwm.start_after(10);
+
+    let timeout = timer.alarm(None).unwrap();
+    loop {
+        Timer::after_ticks(100 as u64).await;
+        let high = (HIGH_US.load(Ordering::Relaxed) + 50) % PWM_PERIOD_US;
+        HIGH_US.store(high, Ordering::Relaxed);
+
+        //no reply is expected, the wait ends after 300 us
+        let start = timer.now();
+        timeout.start_after(300);
+        timeout.wait().await;
+        let waited = timer.now().wrapping_sub(start);
+        println!(
+            "duty {}/{} us, timeout after {} us",
+            high, PWM_PERIOD_US, waited
+        );
+    }
+}
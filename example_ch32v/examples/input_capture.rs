@@ -0,0 +1,84 @@
+#![no_main]
+#![no_std]
+
+//! Measures a 1 kHz PWM generated on PB6: PwmInput on PA6 (TIM3) reads period and duty,
+//! InputCapture on PA0 (TIM2) timestamps every rising edge by DMA. Wire PB6 to PA6 and PA0.
+
+use embedded_c_sdk_bind_hal::{
+    self as CSDK_HAL,
+    gpio::{AltMode, Alternate, AnyPin, Input, Pull},
+    println,
+    pwm::{PwmChannel, PwmOut},
+    timer::{CaptureEdge, InputCapture, PwmInput, Tim},
+};
+
+use ll_bind_ch32v20x as _;
+use panic_halt as _;
+
+use embassy_executor::Spawner;
+use embassy_time::Timer;
+
+const TICK_HZ: u32 = 1_000_000;
+
+static mut EDGE_BUF: [u16; 64] = [0; 64];
+
+#[embassy_executor::main(entry = "riscv_rt_macros::entry")]
+async fn main(_spawner: Spawner) -> ! {
+    let p = CSDK_HAL::init();
+
+    let _out_pin = Alternate::new(p.PB6.into::<AnyPin>(), AltMode::AFPP);
+    let _pwm_in_pin = Input::new(p.PA6.into::<AnyPin>(), Pull::None);
+    let _edge_pin = Input::new(p.PA0.into::<AnyPin>(), Pull::None);
+
+    let _out = match PwmOut::new(PwmChannel::CH6, 1_000) {
+        Ok(out) => {
+            out.set_duty(out.max_duty() / 4);
+            out.enable();
+            Some(out)
+        }
+        Err(code) => {
+            println!("PwmOut err: {}", code);
+            None
+        }
+    };
+
+    let mut pwm_in = PwmInput::new(Tim::Tim3, TICK_HZ, 2).ok();
+    let buf = unsafe { &mut *core::ptr::addr_of_mut!(EDGE_BUF) };
+    let mut edges = match InputCapture::new(Tim::Tim2, TICK_HZ, CaptureEdge::Rising, 2, buf) {
+        Ok(edges) => edges,
+        Err(code) => {
+            println!("InputCapture err: {}", code);
+            loop {
+                Timer::after_ticks(1000 as u64).await;
+            }
+        }
+    };
+
+    let mut last = None;
+    let mut count = 0_u32;
+    loop {
+        let time = match edges.async_next_edge().await {
+            Ok(time) => time,
+            Err(err) => {
+                println!("capture err: {:?}", err);
+                last = None;
+                continue;
+            }
+        };
+        if let Some(last) = last {
+            count += 1;
+            if count % 1000 == 0 {
+                let period: u32 = time.wrapping_sub(last);
+                println!("edge at {}us, period {}us", time, period);
+                if let Some(Ok(m)) = pwm_in.as_mut().map(|p| p.read()) {
+                    println!(
+                        "pwm input: {} Hz, duty {} permille",
+                        m.hz(TICK_HZ),
+                        m.duty_permille()
+                    );
+                }
+            }
+        }
+        last = Some(time);
+    }
+}
@@ -0,0 +1,101 @@
+#![no_main]
+#![no_std]
+
+//! Open loop three-phase sine on a half bridge inverter: 20 kHz center-aligned PWM on TIM1 with
+//! 500 ns dead-time and the break input on PB12 (active low). The duties are updated from the
+//! period interrupt, two low side shunt currents on PA0/PA1 are sampled at the center.
+//!
+//! The high sides are PA8/PA9/PA10 and the low sides PB13/PB14/PB15. PA9/PA10 carry the log
+//! UART, so the log stops once the phases are connected.
+
+use embedded_c_sdk_bind_hal::{
+    self as CSDK_HAL,
+    adc::{AdcInput, AdcSampleTime},
+    gpio::{AltMode, Alternate, AnyPin, Input, Pull},
+    println,
+    pwm::{MotorBreak, MotorControl, MotorPhase, MotorPwm},
+};
+use portable_atomic::{AtomicU32, Ordering};
+
+use ll_bind_ch32v20x as _;
+use panic_halt as _;
+
+use embassy_executor::Spawner;
+use embassy_time::Timer;
+
+//sin(k * pi / 32) * 1000, a quarter wave
+const QUARTER_SINE: [i32; 17] = [
+    0, 98, 195, 290, 383, 471, 556, 634, 707, 773, 831, 882, 924, 957, 981, 995, 1000,
+];
+
+//raw shunt sample above which the phases are driven to zero voltage
+const CURRENT_LIMIT: u16 = 3500;
+
+static ANGLE: AtomicU32 = AtomicU32::new(0); //full turn is 1 << 16
+
+/// Sine of a 6-bit angle, -1000..=1000.
+fn sine(angle: u8) -> i32 {
+    let idx = (angle & 0x3F) as usize;
+    match idx {
+        0..=16 => QUARTER_SINE[idx],
+        17..=32 => QUARTER_SINE[32 - idx],
+        33..=48 => -QUARTER_SINE[idx - 32],
+        _ => -QUARTER_SINE[64 - idx],
+    }
+}
+
+//20 kHz, 5 Hz electrical: 1 << 16 per 4000 periods
+fn on_period(ctl: MotorControl) {
+    let mut samples = [0_u16; 2];
+    let over = match ctl.read_samples(&mut samples) {
+        Ok(()) => samples.iter().any(|s| *s > CURRENT_LIMIT),
+        Err(_) => false,
+    };
+
+    let angle = ANGLE.fetch_add(16, Ordering::Relaxed).wrapping_add(16);
+    let half = ctl.max_duty() as i32 / 2;
+    let amplitude = if over { 0 } else { half / 4 };
+    let phase = (angle >> 10) as u8;
+    let duty = |offset: u8| (half + sine(phase.wrapping_add(offset)) * amplitude / 1000) as u16;
+    ctl.set_duty(MotorPhase::U, duty(0));
+    ctl.set_duty(MotorPhase::V, duty(21)); //120 degrees
+    ctl.set_duty(MotorPhase::W, duty(43)); //240 degrees
+}
+
+#[embassy_executor::main(entry = "riscv_rt_macros::entry")]
+async fn main(_spawner: Spawner) -> ! {
+    let p = CSDK_HAL::init();
+
+    let mut motor = match MotorPwm::new(20_000, 500, MotorBreak::ActiveLow) {
+        Ok(motor) => motor,
+        Err(code) => {
+            println!("MotorPwm err: {}", code);
+            loop {
+                Timer::after_ticks(1000 as u64).await;
+            }
+        }
+    };
+    println!("max_duty: {}", motor.max_duty());
+    if let Err(code) =
+        motor.sample_at_center(&[AdcInput::In0, AdcInput::In1], AdcSampleTime::Cycles7_5)
+    {
+        println!("sample_at_center err: {}", code);
+    }
+
+    let _bkin = Input::new(p.PB12.into::<AnyPin>(), Pull::Up);
+    let _u_low = Alternate::new(p.PB13.into::<AnyPin>(), AltMode::AFPP);
+    let _v_low = Alternate::new(p.PB14.into::<AnyPin>(), AltMode::AFPP);
+    let _w_low = Alternate::new(p.PB15.into::<AnyPin>(), AltMode::AFPP);
+    let _u_high = Alternate::new(p.PA8.into::<AnyPin>(), AltMode::AFPP);
+    let _v_high = Alternate::new(p.PA9.into::<AnyPin>(), AltMode::AFPP);
+    let _w_high = Alternate::new(p.PA10.into::<AnyPin>(), AltMode::AFPP);
+
+    motor.on_update(Some(on_period));
+    loop {
+        if motor.enable().is_ok() {
+            //runs until the break input trips
+            motor.wait_break().await;
+        }
+        Timer::after_ticks(500 as u64).await;
+    }
+}
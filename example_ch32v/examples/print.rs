@@ -38,6 +38,10 @@ fn main() -> ! {
         print!("R {} {} ", 11, 0x10);
         print!("R {} {} ", 22, test_int);
         print!("R {} {} \n\n", 33, test_zero);
+        println!(
+            "R [{:5}] [{:<5}] [{:05}] [{:#06x}] [{:08X}]\n",
+            test_int, test_int, test_int, test_hex_1, test_hex_2
+        );
 
         println!("C count = %d %d", count, count);
         println!("C %d %d %d %d", 111, 112, true, false);
@@ -49,7 +53,15 @@ fn main() -> ! {
         println!("C %d %d %d %d\n", 555, test_int, test_int, test_zero);
         print!("R %d %d ", 11, 0x10);
         print!("R %d 0x%X ", 22, test_int);
-        print!("R %d %d \n\n\n", 33, test_zero);
+        print!("R %d %d \n\n", 33, test_zero);
+        println!(
+            "C [%5d] [%-5d] [%05u] [%.1q] [%llu]\n\n",
+            test_int,
+            test_int,
+            test_int,
+            215,
+            u64::MAX
+        );
 
         tick.delay_ms(5000);
     }
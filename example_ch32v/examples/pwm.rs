@@ -5,7 +5,7 @@ use embedded_c_sdk_bind_hal::{
     self as CSDK_HAL,
     gpio::{AltMode, Alternate, AnyPin, Input, Pull},
     print, println,
-    pwm::{Pwm, PwmChannel, PwmPolarity},
+    pwm::{Pwm, PwmChannel, PwmOut, PwmPolarity},
 };
 use fugit::ExtU32;
 use ll_bind_ch32v20x as _;
@@ -26,6 +26,22 @@ async fn main(_spawner: Spawner) -> ! {
     pwm0.set_duty(100);
     pwm0.set_period(1_u32.millis());
     pwm0.enable();
+
+    //20kHz on PB6, duty in steps of the full timer clock
+    let _fan_pin = Alternate::new(p.PB6.into::<AnyPin>(), AltMode::AFPP);
+    let _fan = match PwmOut::new(PwmChannel::CH6, 20_000) {
+        Ok(fan) => {
+            fan.set_duty(fan.max_duty() / 4);
+            fan.enable();
+            println!("fan max_duty: {}", fan.max_duty());
+            Some(fan)
+        }
+        Err(code) => {
+            println!("PwmOut err: {}", code);
+            None
+        }
+    };
+
     let max_duty = pwm0.get_max_duty();
     println!(
         "max_duty: {}, time:{}us",
@@ -0,0 +1,65 @@
+#![no_main]
+#![no_std]
+
+//! A rainbow running along a 60 LED WS2812 strip on PA8, the bit timings are sent by DMA.
+
+use embedded_c_sdk_bind_hal::{
+    self as CSDK_HAL,
+    gpio::{AltMode, Alternate, AnyPin},
+    println,
+    pwm::{
+        ws2812::{Rgb, Ws2812},
+        PwmChannel,
+    },
+};
+
+use ll_bind_ch32v20x as _;
+use panic_halt as _;
+
+use embassy_executor::Spawner;
+use embassy_time::Timer;
+
+const LEDS: usize = 60;
+const HALF_BITS: usize = 96; //4 LEDs per half
+
+static mut LED_BUF: [[u16; HALF_BITS]; 2] = [[0; HALF_BITS]; 2];
+
+fn wheel(pos: u8) -> Rgb {
+    match pos {
+        0..=84 => Rgb::new(255 - pos * 3, pos * 3, 0),
+        85..=169 => Rgb::new(0, 255 - (pos - 85) * 3, (pos - 85) * 3),
+        _ => Rgb::new((pos - 170) * 3, 0, 255 - (pos - 170) * 3),
+    }
+}
+
+#[embassy_executor::main(entry = "riscv_rt_macros::entry")]
+async fn main(_spawner: Spawner) -> ! {
+    let p = CSDK_HAL::init();
+
+    let _din = Alternate::new(p.PA8.into::<AnyPin>(), AltMode::AFPP);
+    let buf = unsafe { &mut *core::ptr::addr_of_mut!(LED_BUF) };
+    let mut strip = match Ws2812::new(PwmChannel::CH0, buf) {
+        Ok(strip) => strip,
+        Err(code) => {
+            println!("Ws2812 err: {}", code);
+            loop {
+                Timer::after_ticks(1000 as u64).await;
+            }
+        }
+    };
+
+    let mut colors = [Rgb::default(); LEDS];
+    let mut step: u8 = 0;
+    loop {
+        for (idx, color) in colors.iter_mut().enumerate() {
+            let c = wheel(step.wrapping_add((idx * 256 / LEDS) as u8));
+            //quarter brightness
+            *color = Rgb::new(c.r / 4, c.g / 4, c.b / 4);
+        }
+        if let Err(err) = strip.async_write(&colors).await {
+            println!("write err: {:?}", err);
+        }
+        step = step.wrapping_add(2);
+        Timer::after_ticks(20 as u64).await;
+    }
+}
@@ -7,9 +7,152 @@
 #include "ch32v20x.h"
 #include "wrapper.h"
 #include "adc.h"
+#include "timer.h"
 
-//static int16_t Calibrattion_Val = 0;
+#define ADC_VREFINT_MV     1200       //typical internal reference
+#define ADC_TS_INFO_ADDR   0x1FFFF720 //factory temperature sensor point: mV in bits 0..15, degC in bits 16..31
+#define ADC_TS_SLOPE_UV    (-4300)    //temperature sensor slope, uV per degC
+
+static int16_t Calibrattion_Val = 0;
 extern void ADC_CH0_EOC_hook_rs(uint16_t val);
+extern void ADC_JEOC_hook_rs(void);
+extern void ADC_AWD_hook_rs(void);
+
+//sample time ADC_SampleTime_1Cycles5..239Cycles5 plus the 12.5 cycles of a conversion, in half
+//ADC clocks
+static const uint16_t ADC_CONV_HALF_CYCLES[8] = {28, 40, 52, 82, 108, 136, 168, 504};
+
+static uint32_t adc_rate_hz = 0;//0: free running/software start, else TIM3 TRGO paces the conversions
+static bool adc_tim_owned = false;//TIM3 is claimed and run by adc_trigger_timer()
+static bool adc_dual = false;//ADC2 follows the ADC1 regular trigger
+
+struct AdcPin {
+	GPIO_TypeDef * port;
+	uint16_t pin;
+};
+
+//ADC_IN0..ADC_IN15
+static const struct AdcPin ADC_PIN_list[] = {
+	{GPIOA, GPIO_Pin_0}, {GPIOA, GPIO_Pin_1}, {GPIOA, GPIO_Pin_2}, {GPIOA, GPIO_Pin_3},
+	{GPIOA, GPIO_Pin_4}, {GPIOA, GPIO_Pin_5}, {GPIOA, GPIO_Pin_6}, {GPIOA, GPIO_Pin_7},
+	{GPIOB, GPIO_Pin_0}, {GPIOB, GPIO_Pin_1}, {GPIOC, GPIO_Pin_0}, {GPIOC, GPIO_Pin_1},
+	{GPIOC, GPIO_Pin_2}, {GPIOC, GPIO_Pin_3}, {GPIOC, GPIO_Pin_4}, {GPIOC, GPIO_Pin_5},
+};
+
+static void adc_calibrate(ADC_TypeDef *adc)
+{
+	ADC_BufferCmd(adc, DISABLE); //disable buffer
+	ADC_ResetCalibration(adc);
+	while(ADC_GetResetCalibrationStatus(adc));
+	ADC_StartCalibration(adc);
+	while(ADC_GetCalibrationStatus(adc));
+	if(adc == ADC1) {
+		Calibrattion_Val = Get_CalibrationValue(adc);
+	}
+
+	ADC_BufferCmd(adc, ENABLE); //enable buffer
+}
+
+//TIM3 update event drives the ADC1 regular trigger (TRGO) at rate_hz, 0 stops the timer
+//-3 if PWM channels or another driver run TIM3, see tim_claim()
+static int adc_trigger_timer(uint32_t rate_hz)
+{
+	TIM_TimeBaseInitTypeDef TIM_TimeBaseInitStructure = {0};
+	uint16_t psc, arr;
+	int result;
+
+	if(rate_hz == 0) {//stops TIM3 only if the ADC started it
+		if(adc_tim_owned) {
+			TIM_Cmd(TIM3, DISABLE);
+			tim_release(TIM_ID_3, TIM_OWNER_ADC);
+			adc_tim_owned = false;
+		}
+		return 0;
+	}
+
+	result = tim_calc_base(tim_clock_hz(TIM3), rate_hz, &psc, &arr);
+	if(result != 0) {
+		return result;
+	}
+	if(tim_claim(TIM_ID_3, TIM_OWNER_ADC) != 0) {
+		return -3;
+	}
+
+	tim_clock_enable(TIM3);
+	TIM_Cmd(TIM3, DISABLE);
+	TIM_TimeBaseInitStructure.TIM_Prescaler = psc;
+	TIM_TimeBaseInitStructure.TIM_Period = arr;
+	TIM_TimeBaseInitStructure.TIM_ClockDivision = TIM_CKD_DIV1;
+	TIM_TimeBaseInitStructure.TIM_CounterMode = TIM_CounterMode_Up;
+	TIM_TimeBaseInit(TIM3, &TIM_TimeBaseInitStructure);
+	TIM_SelectOutputTrigger(TIM3, TIM_TRGOSource_Update);
+	TIM_Cmd(TIM3, ENABLE);
+	adc_tim_owned = true;
+
+	return 0;
+}
+
+//highest trigger rate at which a sequence of half_cycles ADC clocks ends before the next trigger,
+//faster triggers would be dropped by the ADC
+static uint32_t adc_rate_max(uint32_t half_cycles)
+{
+	RCC_ClocksTypeDef clocks;
+
+	RCC_GetClocksFreq(&clocks);
+
+	return clocks.ADCCLK_Frequency * 2 / half_cycles;
+}
+
+//conversion time of the regular sequence programmed in ADC1, in half ADC clocks
+static uint32_t adc_seq_half_cycles(void)
+{
+	uint32_t count = ((ADC1->RSQR1 >> 20) & 0x0F) + 1;
+	uint32_t half_cycles = 0;
+
+	for(uint32_t idx = 0; idx < count; idx++) {
+		uint32_t ch, smp;
+
+		if(idx < 6) {
+			ch = (ADC1->RSQR3 >> (5 * idx)) & 0x1F;
+		} else if(idx < 12) {
+			ch = (ADC1->RSQR2 >> (5 * (idx - 6))) & 0x1F;
+		} else {
+			ch = (ADC1->RSQR1 >> (5 * (idx - 12))) & 0x1F;
+		}
+		if(ch < 10) {
+			smp = (ADC1->SAMPTR2 >> (3 * ch)) & 0x07;
+		} else {
+			smp = (ADC1->SAMPTR1 >> (3 * (ch - 10))) & 0x07;
+		}
+		half_cycles += ADC_CONV_HALF_CYCLES[smp];
+	}
+
+	return half_cycles;
+}
+
+//sample rate of the next buffered start, 0 converts back to back
+//-2 above the rate of the 13.5 cycles sample time of the buffered input
+int adc_set_rate(uint32_t rate_hz)
+{
+	if(rate_hz > adc_rate_max(ADC_CONV_HALF_CYCLES[ADC_SampleTime_13Cycles5])) {
+		return -2;
+	}
+	adc_rate_hz = rate_hz;
+
+	return 0;
+}
+
+//frame rate of the next continuous scan, 0 converts back to back
+//-2 if the sequence set by adc_scan_init()/adc_dual_init() does not fit into one period
+int adc_scan_set_rate(uint32_t rate_hz)
+{
+	if(rate_hz > adc_rate_max(adc_seq_half_cycles())) {
+		return -2;
+	}
+	adc_rate_hz = rate_hz;
+
+	return 0;
+}
 
 int adc_init(uint32_t adc_ch, uint32_t flags)
 {
@@ -17,6 +160,8 @@ int adc_init(uint32_t adc_ch, uint32_t flags)
 	(void)flags;
     ADC_InitTypeDef  ADC_InitStructure = {0};
 
+	adc_rate_hz = 0;
+
 	ADC_InitStructure.ADC_Mode = ADC_Mode_Independent;
 	ADC_InitStructure.ADC_ScanConvMode = DISABLE;
 	ADC_InitStructure.ADC_ContinuousConvMode = DISABLE;
@@ -26,31 +171,187 @@ int adc_init(uint32_t adc_ch, uint32_t flags)
 	ADC_Init(ADC1, &ADC_InitStructure);
 
 	ADC_Cmd(ADC1, ENABLE);
+	adc_calibrate(ADC1);
+
+	ADC_TempSensorVrefintCmd(ENABLE);
+
+	return 0;
+}
+
+//regular sequence of count inputs (ADC_IN0..ADC_IN15, ADC_IN_TEMP, ADC_IN_VREF), each conversion
+//result is moved by DMA from the register returned in p_data_reg
+//checks the inputs (below in_max), sets their pins to analog and programs the regular sequence
+static int adc_seq_init(ADC_TypeDef *adc, uint32_t mode, const uint8_t *inputs, uint32_t count, uint32_t sample_time, uint32_t in_max)
+{
+	ADC_InitTypeDef  ADC_InitStructure = {0};
+	GPIO_InitTypeDef GPIO_InitStructure = {0};
+
+	if((inputs == NULL) || (count == 0) || (count > 16)) {
+		return -1;
+	}
+	if(sample_time > ADC_SAMPLE_239_5) {
+		return -2;
+	}
+	for(uint32_t idx = 0; idx < count; idx++) {
+		if(inputs[idx] >= in_max) {
+			return -3;
+		}
+	}
+
+	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_AIN;
+	for(uint32_t idx = 0; idx < count; idx++) {
+		if(inputs[idx] < sizeof(ADC_PIN_list)/sizeof(ADC_PIN_list[0])) {
+			GPIO_InitStructure.GPIO_Pin = ADC_PIN_list[inputs[idx]].pin;
+			GPIO_Init(ADC_PIN_list[inputs[idx]].port, &GPIO_InitStructure);
+		}
+	}
+
+	ADC_Cmd(adc, DISABLE);
+	ADC_InitStructure.ADC_Mode = mode;
+	ADC_InitStructure.ADC_ScanConvMode = ENABLE;
+	ADC_InitStructure.ADC_ContinuousConvMode = DISABLE;
+	ADC_InitStructure.ADC_ExternalTrigConv = ADC_ExternalTrigConv_None;
+	ADC_InitStructure.ADC_DataAlign = ADC_DataAlign_Right;
+	ADC_InitStructure.ADC_NbrOfChannel = count;
+	ADC_Init(adc, &ADC_InitStructure);
+	for(uint32_t idx = 0; idx < count; idx++) {
+		ADC_RegularChannelConfig(adc, inputs[idx], idx + 1, sample_time);
+	}
+	ADC_ITConfig(adc, ADC_IT_EOC, DISABLE);
+
+	return 0;
+}
+
+int adc_scan_init(const uint8_t *inputs, uint32_t count, uint32_t sample_time, uint32_t flags, uint32_t *p_data_reg)
+{
+	(void)flags;
+	int result;
+
+	if(p_data_reg == NULL) {
+		return -1;
+	}
+	result = adc_seq_init(ADC1, ADC_Mode_Independent, inputs, count, sample_time, ADC_IN_MAX);
+	if(result != 0) {
+		return result;
+	}
+
+	adc_rate_hz = 0;
+	ADC_DMACmd(ADC1, ENABLE);
+	ADC_Cmd(ADC1, ENABLE);
+	adc_calibrate(ADC1);
+
+	ADC_TempSensorVrefintCmd(ENABLE);
+
+	*p_data_reg = (uint32_t)&ADC1->RDATAR;
+
+	return 0;
+}
 
-	ADC_BufferCmd(ADC1, DISABLE); //disable buffer
-	ADC_ResetCalibration(ADC1);
-	while(ADC_GetResetCalibrationStatus(ADC1));
-	ADC_StartCalibration(ADC1);
-	while(ADC_GetCalibrationStatus(ADC1));
-	//Calibrattion_Val = Get_CalibrationValue(ADC1);
+//regular simultaneous mode: pairs[2 * n] on ADC1 and pairs[2 * n + 1] on ADC2 are sampled at the
+//same instant, ADC1 RDATAR holds ADC1 data in bits 0..15 and ADC2 data in bits 16..31.
+//ADC2 has no temperature sensor and vref inputs. Started and stopped by adc_scan_ctrl()
+int adc_dual_init(const uint8_t *pairs, uint32_t count, uint32_t sample_time, uint32_t *p_data_reg)
+{
+	uint8_t inputs1[16], inputs2[16];
+	int result;
 
-	ADC_BufferCmd(ADC1, ENABLE); //enable buffer
+	if((pairs == NULL) || (count == 0) || (count > 16) || (p_data_reg == NULL)) {
+		return -1;
+	}
+	for(uint32_t idx = 0; idx < count; idx++) {
+		inputs1[idx] = pairs[2 * idx];
+		inputs2[idx] = pairs[2 * idx + 1];
+	}
+
+	RCC_APB2PeriphClockCmd(RCC_APB2Periph_ADC2, ENABLE);
+	result = adc_seq_init(ADC2, ADC_Mode_RegSimult, inputs2, count, sample_time, ADC_IN_TEMP);
+	if(result != 0) {
+		return result;
+	}
+	result = adc_seq_init(ADC1, ADC_Mode_RegSimult, inputs1, count, sample_time, ADC_IN_MAX);
+	if(result != 0) {
+		return result;
+	}
+	ADC_ExternalTrigConvCmd(ADC2, ENABLE); //slave, converts on the ADC1 trigger
+
+	adc_rate_hz = 0;
+	adc_dual = true;
+	ADC_DMACmd(ADC1, ENABLE);
+	ADC_Cmd(ADC1, ENABLE);
+	adc_calibrate(ADC1);
+	ADC_Cmd(ADC2, ENABLE);
+	adc_calibrate(ADC2);
 
 	ADC_TempSensorVrefintCmd(ENABLE);
 
+	*p_data_reg = (uint32_t)&ADC1->RDATAR;
+
 	return 0;
 }
 
-// static uint16_t Cali_ConversionVal(int16_t val)
-// {
-// 	val = val + Calibrattion_Val;
+int adc_scan_ctrl(uint32_t ctrl)
+{
+	switch(ctrl) {
+	case ADC_SCAN_CTRL_ONE_SHOT:
+		if(adc_dual) {
+			ADC2->CTLR2 &= ~ADC_CONT;
+		}
+		ADC1->CTLR2 = (ADC1->CTLR2 & ~(ADC_CONT | ADC_EXTSEL)) | ADC_ExternalTrigConv_None;
+		ADC_SoftwareStartConvCmd(ADC1, ENABLE);
+	break;
+	case ADC_SCAN_CTRL_CONTINUOUS:
+		if(adc_rate_hz) {//one sequence per TIM3 update
+			if(adc_dual) {
+				ADC2->CTLR2 &= ~ADC_CONT;
+			}
+			ADC1->CTLR2 = (ADC1->CTLR2 & ~(ADC_CONT | ADC_EXTSEL)) | ADC_ExternalTrigConv_T3_TRGO;
+			ADC_ExternalTrigConvCmd(ADC1, ENABLE);
+			return adc_trigger_timer(adc_rate_hz);
+		}
+		if(adc_dual) {
+			ADC2->CTLR2 |= ADC_CONT;
+		}
+		ADC1->CTLR2 = (ADC1->CTLR2 & ~ADC_EXTSEL) | ADC_ExternalTrigConv_None | ADC_CONT;
+		ADC_SoftwareStartConvCmd(ADC1, ENABLE);
+	break;
+	case ADC_SCAN_CTRL_STOP:
+		adc_trigger_timer(0);
+		ADC1->CTLR2 &= ~ADC_CONT;
+		ADC_SoftwareStartConvCmd(ADC1, DISABLE);
+		ADC_DMACmd(ADC1, DISABLE);
+		ADC_Cmd(ADC1, DISABLE);
+		if(adc_dual) {
+			ADC2->CTLR2 &= ~ADC_CONT;
+			ADC_ExternalTrigConvCmd(ADC2, DISABLE);
+			ADC_Cmd(ADC2, DISABLE);
+			ADC1->CTLR1 &= ~ADC_DUALMOD; //back to independent mode
+			adc_dual = false;
+		}
+	break;
+	default:
+		return -1;
+	}
 
-//     if(val < 0)
-//         return 0;
-//     if(val > 4095)
-//         return 4095;
-//     return val;
-// }
+	return 0;
+}
+
+//offset measured by the last ADC1 calibration (add to raw samples) and the reference values
+//to convert samples to mV and degC, see AdcCalibration
+int adc_get_calibration(struct AdcCalibration *p_cal)
+{
+	uint32_t ts_info = *(const uint32_t *)ADC_TS_INFO_ADDR;
+
+	if(p_cal == NULL) {
+		return -1;
+	}
+	p_cal->offset = Calibrattion_Val;
+	p_cal->vrefint_mv = ADC_VREFINT_MV;
+	p_cal->ts_ref_mv = (int32_t)(ts_info & 0xFFFF);
+	p_cal->ts_ref_c = (int32_t)((ts_info >> 16) & 0xFFFF);
+	p_cal->ts_slope_uv = ADC_TS_SLOPE_UV;
+
+	return 0;
+}
 
 uint16_t Get_ConversionVal(uint8_t ch)
 {
@@ -69,6 +370,7 @@ uint16_t Get_ConversionVal(uint8_t ch)
 int adc_buffered_deinit(uint32_t adc_ch)
 {
 	(void)adc_ch;
+	adc_trigger_timer(0);
 	ADC_Cmd(ADC1, DISABLE);
 
     NVIC_InitTypeDef NVIC_InitStructure = {0};
@@ -81,15 +383,23 @@ int adc_buffered_deinit(uint32_t adc_ch)
 	return 0;
 }
 
-void adc_buffered_init(uint32_t adc_ch)
+//-3 if a sample rate is set and TIM3 is run by another driver, the ADC is then set up but not
+//triggered
+int adc_buffered_init(uint32_t adc_ch)
 {
 	(void)adc_ch;
     ADC_InitTypeDef  ADC_InitStructure = {0};
+	int result = 0;
 
 	ADC_InitStructure.ADC_Mode = ADC_Mode_Independent;
 	ADC_InitStructure.ADC_ScanConvMode = DISABLE;
-	ADC_InitStructure.ADC_ContinuousConvMode = ENABLE;
-	ADC_InitStructure.ADC_ExternalTrigConv = ADC_ExternalTrigConv_None;
+	if(adc_rate_hz) {
+		ADC_InitStructure.ADC_ContinuousConvMode = DISABLE;
+		ADC_InitStructure.ADC_ExternalTrigConv = ADC_ExternalTrigConv_T3_TRGO;
+	} else {
+		ADC_InitStructure.ADC_ContinuousConvMode = ENABLE;
+		ADC_InitStructure.ADC_ExternalTrigConv = ADC_ExternalTrigConv_None;
+	}
 	ADC_InitStructure.ADC_DataAlign = ADC_DataAlign_Right;
 	ADC_InitStructure.ADC_NbrOfChannel = 1;
 	ADC_Init(ADC1, &ADC_InitStructure);
@@ -97,15 +407,11 @@ void adc_buffered_init(uint32_t adc_ch)
 
     ADC_ITConfig(ADC1, ADC_IT_EOC, ENABLE);
 	ADC_Cmd(ADC1, ENABLE);
-
-	ADC_BufferCmd(ADC1, DISABLE); //disable buffer
-	ADC_ResetCalibration(ADC1);
-	while(ADC_GetResetCalibrationStatus(ADC1));
-	ADC_StartCalibration(ADC1);
-	while(ADC_GetCalibrationStatus(ADC1));
-	//Calibrattion_Val = Get_CalibrationValue(ADC1);
-
-	ADC_BufferCmd(ADC1, ENABLE); //enable buffer
+	adc_calibrate(ADC1);
+	if(adc_rate_hz) {
+		ADC_ExternalTrigConvCmd(ADC1, ENABLE);
+		result = adc_trigger_timer(adc_rate_hz);
+	}
 
 	ADC_TempSensorVrefintCmd(ENABLE);
 
@@ -115,6 +421,139 @@ void adc_buffered_init(uint32_t adc_ch)
     NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
     NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
     NVIC_Init(&NVIC_InitStructure);
+
+	return result;
+}
+
+//injected group of count (1..4) inputs on ADC1, converted once between two regular conversions
+//without stopping a running regular sequence. The ADC is powered up if it is off.
+//flags ADC_INJECT_IRQ: the JEOC irq calls ADC_JEOC_hook_rs(), results are read by adc_inject_read()
+//ADC_INJECT_TRIG_PWM: no software start, the group converts at each sample point of the motor PWM
+int adc_inject_start(const uint8_t *inputs, uint32_t count, uint32_t sample_time, uint32_t flags)
+{
+	GPIO_InitTypeDef GPIO_InitStructure = {0};
+
+	if((inputs == NULL) || (count == 0) || (count > 4)) {
+		return -1;
+	}
+	if(sample_time > ADC_SAMPLE_239_5) {
+		return -2;
+	}
+	for(uint32_t idx = 0; idx < count; idx++) {
+		if(inputs[idx] >= ADC_IN_MAX) {
+			return -3;
+		}
+	}
+
+	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_AIN;
+	for(uint32_t idx = 0; idx < count; idx++) {
+		if(inputs[idx] < sizeof(ADC_PIN_list)/sizeof(ADC_PIN_list[0])) {
+			GPIO_InitStructure.GPIO_Pin = ADC_PIN_list[inputs[idx]].pin;
+			GPIO_Init(ADC_PIN_list[inputs[idx]].port, &GPIO_InitStructure);
+		}
+	}
+
+	if((ADC1->CTLR2 & ADC_ADON) == 0) {
+		ADC_Cmd(ADC1, ENABLE);
+		adc_calibrate(ADC1);
+	}
+	ADC_TempSensorVrefintCmd(ENABLE);
+
+	ADC_InjectedSequencerLengthConfig(ADC1, count);
+	for(uint32_t idx = 0; idx < count; idx++) {
+		ADC_InjectedChannelConfig(ADC1, inputs[idx], idx + 1, sample_time);
+	}
+	ADC_ClearFlag(ADC1, ADC_FLAG_JEOC);
+
+	if(flags & ADC_INJECT_IRQ) {
+		NVIC_InitTypeDef NVIC_InitStructure = {0};
+		NVIC_InitStructure.NVIC_IRQChannel = ADC1_2_IRQn;
+		NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 2;
+		NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+		NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+		NVIC_Init(&NVIC_InitStructure);
+		ADC_ITConfig(ADC1, ADC_IT_JEOC, ENABLE);
+	} else {
+		ADC_ITConfig(ADC1, ADC_IT_JEOC, DISABLE);
+	}
+	if(flags & ADC_INJECT_TRIG_PWM) {
+		//converted on every TIM1 TRGO, i.e. the sample point of the motor PWM
+		ADC_ExternalTrigInjectedConvConfig(ADC1, ADC_ExternalTrigInjecConv_T1_TRGO);
+		ADC_ExternalTrigInjectedConvCmd(ADC1, ENABLE);
+	} else {
+		ADC_ExternalTrigInjectedConvConfig(ADC1, ADC_ExternalTrigInjecConv_None);
+		ADC_SoftwareStartInjectedConvCmd(ADC1, ENABLE);
+	}
+
+	return 0;
+}
+
+//copies the injected results in sequence order, -5: not finished yet (wait == 0)
+int adc_inject_read(uint16_t *p_buf, uint32_t count, uint32_t wait)
+{
+	if((p_buf == NULL) || (count > 4)) {
+		return -1;
+	}
+	if(wait) {
+		while(!ADC_GetFlagStatus(ADC1, ADC_FLAG_JEOC));
+	} else if(!ADC_GetFlagStatus(ADC1, ADC_FLAG_JEOC)) {
+		return -5;
+	}
+
+	for(uint32_t idx = 0; idx < count; idx++) {
+		p_buf[idx] = ADC_GetInjectedConversionValue(ADC1, ADC_InjectedChannel_1 + idx * 4);
+	}
+	ADC_ClearFlag(ADC1, ADC_FLAG_JEOC);
+
+	return 0;
+}
+
+//analog watchdog on the regular conversions of input (ADC_IN_MAX: every regular input).
+//The AWD irq fires once when a sample leaves low..=high, disables itself and calls ADC_AWD_hook_rs(),
+//ADC_WATCHDOG_CTRL_ARM enables it again
+int adc_watchdog_ctrl(uint32_t ctrl, uint32_t input, uint32_t low, uint32_t high)
+{
+	switch(ctrl) {
+	case ADC_WATCHDOG_CTRL_SET:
+	{
+		if(input > ADC_IN_MAX) {
+			return -1;
+		}
+		if((low > high) || (high > 0xFFF)) {
+			return -2;
+		}
+
+		ADC_ITConfig(ADC1, ADC_IT_AWD, DISABLE);
+		ADC_AnalogWatchdogThresholdsConfig(ADC1, high, low);
+		if(input == ADC_IN_MAX) {
+			ADC_AnalogWatchdogCmd(ADC1, ADC_AnalogWatchdog_AllRegEnable);
+		} else {
+			ADC_AnalogWatchdogSingleChannelConfig(ADC1, input);
+			ADC_AnalogWatchdogCmd(ADC1, ADC_AnalogWatchdog_SingleRegEnable);
+		}
+
+		NVIC_InitTypeDef NVIC_InitStructure = {0};
+		NVIC_InitStructure.NVIC_IRQChannel = ADC1_2_IRQn;
+		NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 2;
+		NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+		NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+		NVIC_Init(&NVIC_InitStructure);
+	}
+	break;
+	case ADC_WATCHDOG_CTRL_ARM:
+		ADC_ClearFlag(ADC1, ADC_FLAG_AWD);
+		ADC_ITConfig(ADC1, ADC_IT_AWD, ENABLE);
+	break;
+	case ADC_WATCHDOG_CTRL_DISABLE:
+		ADC_ITConfig(ADC1, ADC_IT_AWD, DISABLE);
+		ADC_AnalogWatchdogCmd(ADC1, ADC_AnalogWatchdog_None);
+		ADC_ClearFlag(ADC1, ADC_FLAG_AWD);
+	break;
+	default:
+		return -1;
+	}
+
+	return 0;
 }
 
 void ADC1_2_IRQHandler(void) __attribute__((interrupt("WCH-Interrupt-fast")));
@@ -126,4 +565,15 @@ void ADC1_2_IRQHandler()
 		ADC_ClearITPendingBit(ADC1, ADC_IT_EOC);
 		ADC_CH0_EOC_hook_rs(val);
 	}
+    if(ADC_GetITStatus(ADC1, ADC_IT_JEOC))
+    {
+		ADC_ITConfig(ADC1, ADC_IT_JEOC, DISABLE); //JEOC stays set for adc_inject_read()
+		ADC_JEOC_hook_rs();
+	}
+    if(ADC_GetITStatus(ADC1, ADC_IT_AWD))
+    {
+		ADC_ITConfig(ADC1, ADC_IT_AWD, DISABLE); //once per arm, the flag is set on every sample outside
+		ADC_ClearFlag(ADC1, ADC_FLAG_AWD);
+		ADC_AWD_hook_rs();
+	}
 }
\ No newline at end of file
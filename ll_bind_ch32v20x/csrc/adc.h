@@ -1,9 +1,26 @@
 #ifndef __ADC_H__
 #define __ADC_H__
 
-void adc_buffered_init(uint32_t adc_ch);
+struct AdcCalibration {
+	int32_t  offset;      //added to raw samples
+	uint32_t vrefint_mv;  //nominal internal reference voltage
+	int32_t  ts_ref_mv;   //temperature sensor voltage at ts_ref_c
+	int32_t  ts_ref_c;
+	int32_t  ts_slope_uv; //temperature sensor change per degC
+};
+
+int adc_buffered_init(uint32_t adc_ch);
 int adc_buffered_deinit(uint32_t adc_ch);
 int adc_init(uint32_t adc_ch, uint32_t flags);
 uint16_t Get_ConversionVal(uint8_t ch);
+int adc_scan_init(const uint8_t *inputs, uint32_t count, uint32_t sample_time, uint32_t flags, uint32_t *p_data_reg);
+int adc_scan_ctrl(uint32_t ctrl);
+int adc_set_rate(uint32_t rate_hz);
+int adc_scan_set_rate(uint32_t rate_hz);
+int adc_dual_init(const uint8_t *pairs, uint32_t count, uint32_t sample_time, uint32_t *p_data_reg);
+int adc_inject_start(const uint8_t *inputs, uint32_t count, uint32_t sample_time, uint32_t flags);
+int adc_inject_read(uint16_t *p_buf, uint32_t count, uint32_t wait);
+int adc_watchdog_ctrl(uint32_t ctrl, uint32_t input, uint32_t low, uint32_t high);
+int adc_get_calibration(struct AdcCalibration *p_cal);
 
 #endif //__ADC_H__
@@ -0,0 +1,176 @@
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include "ch32v20x.h"
+#include "wrapper.h"
+#include "capture.h"
+#include "dma.h"
+#include "timer.h"
+
+extern void TIM_CAPTURE_hook_rs(uint32_t id, uint32_t events, uint32_t dma_left, uint32_t cnt);
+
+//channel moving the CH1 captures of the edge mode
+static uint8_t capture_dma[TIM_ID_MAX];
+
+//overflow of the free running counter, reported with the DMA position so the HAL can extend
+//the 16-bit timestamps. The edge irq is one-shot, enabled while a task waits for an edge
+static void capture_irq(uint32_t id, TIM_TypeDef *tim)
+{
+	uint32_t events = 0, left = 0, cnt = 0;
+
+	if(tim->DMAINTENR & TIM_IT_CC1) {
+		//the DMA may have cleared the flag already
+		tim->DMAINTENR &= ~TIM_IT_CC1;
+		events |= CAPTURE_EVENT_EDGE;
+	}
+	if(tim->INTFR & TIM_FLAG_Update) {
+		tim->INTFR = (uint16_t)~TIM_FLAG_Update;
+		//DMA position first: a timestamp moved after it was captured after the overflow
+		left = dma_ctrl(capture_dma[id], DMA_CTRL_GET_COUNT, 0);
+		cnt = tim->CNT;
+		events |= CAPTURE_EVENT_OVERFLOW;
+	}
+	if(events) {
+		TIM_CAPTURE_hook_rs(id, events, left, cnt);
+	}
+}
+
+/**
+ * Input capture on CH1 of timer id, the counter runs at tick_hz.
+ * CAPTURE_MODE_PWM_INPUT: IC1 captures the period on rising edges and resets the counter, IC2
+ * the high time on falling edges.
+ * CAPTURE_MODE_EDGES: the counter runs free, each edge requests a DMA transfer of CCR1 on
+ * dma_ch, whose address is returned in p_ccr.
+ * -3 if the timer is run by another driver, see tim_claim()
+ */
+int capture_init(uint32_t id, uint32_t mode, uint32_t tick_hz, uint32_t flags, uint32_t dma_ch, uint32_t *p_ccr)
+{
+	TIM_TypeDef *tim = tim_get(id);
+	TIM_TimeBaseInitTypeDef TIM_TimeBaseInitStructure = {0};
+	TIM_ICInitTypeDef TIM_ICInitStructure = {0};
+	uint32_t psc;
+
+	if(tim == NULL || tick_hz == 0) {
+		return -1;
+	}
+	psc = (tim_clock_hz(tim) + tick_hz / 2) / tick_hz;
+	if(psc == 0 || psc > 0x10000) {
+		return -2;
+	}
+	if(mode == CAPTURE_MODE_EDGES && dma_ch >= DMA_CH_MAX) {
+		return -1;
+	}
+	//PWM channels, the ADC trigger or another driver on the timer
+	if(tim_claim(id, TIM_OWNER_CAPTURE) != 0) {
+		return -3;
+	}
+
+	tim_clock_enable(tim);
+	TIM_DeInit(tim);
+	TIM_TimeBaseInitStructure.TIM_Period = 0xFFFF;
+	TIM_TimeBaseInitStructure.TIM_Prescaler = psc - 1;
+	TIM_TimeBaseInitStructure.TIM_ClockDivision = TIM_CKD_DIV1;
+	TIM_TimeBaseInitStructure.TIM_CounterMode = TIM_CounterMode_Up;
+	TIM_TimeBaseInit(tim, &TIM_TimeBaseInitStructure);
+
+	TIM_ICInitStructure.TIM_Channel = TIM_Channel_1;
+	TIM_ICInitStructure.TIM_ICSelection = TIM_ICSelection_DirectTI;
+	TIM_ICInitStructure.TIM_ICPrescaler = TIM_ICPSC_DIV1;
+	TIM_ICInitStructure.TIM_ICFilter = (flags >> CAPTURE_FILTER_SHIFT) & 0x0F;
+
+	if(mode == CAPTURE_MODE_PWM_INPUT) {
+		TIM_ICInitStructure.TIM_ICPolarity = TIM_ICPolarity_Rising;
+		TIM_PWMIConfig(tim, &TIM_ICInitStructure);
+		TIM_SelectInputTrigger(tim, TIM_TS_TI1FP1);
+		TIM_SelectSlaveMode(tim, TIM_SlaveMode_Reset);
+		TIM_SelectMasterSlaveMode(tim, TIM_MasterSlaveMode_Enable);
+		//the update flag marks an overflow, i.e. no rising edge for 65536 ticks
+		TIM_UpdateRequestConfig(tim, TIM_UpdateSource_Regular);
+	} else {
+		switch (flags & CAPTURE_EDGE_MASK)
+		{
+		case CAPTURE_EDGE_FALLING:
+			TIM_ICInitStructure.TIM_ICPolarity = TIM_ICPolarity_Falling;
+		break;
+		case CAPTURE_EDGE_BOTH:
+			TIM_ICInitStructure.TIM_ICPolarity = TIM_ICPolarity_BothEdge;
+		break;
+		default:
+			TIM_ICInitStructure.TIM_ICPolarity = TIM_ICPolarity_Rising;
+		break;
+		}
+		TIM_ICInit(tim, &TIM_ICInitStructure);
+		TIM_DMACmd(tim, TIM_DMA_CC1, ENABLE);
+		capture_dma[id] = dma_ch;
+		TIM_ITConfig(tim, TIM_IT_Update, ENABLE);
+		tim_irq_attach(id, capture_irq);
+	}
+	tim->INTFR = 0;
+
+	if(p_ccr) {
+		*p_ccr = (uint32_t)&tim->CH1CVR;
+	}
+
+	return 0;
+}
+
+int capture_deinit(uint32_t id)
+{
+	TIM_TypeDef *tim = tim_get(id);
+
+	if(tim == NULL) {
+		return -1;
+	}
+	if(tim_release(id, TIM_OWNER_CAPTURE) != 0) {
+		return -3;
+	}
+	tim_irq_attach(id, NULL);
+	TIM_Cmd(tim, DISABLE);
+	TIM_DeInit(tim);
+
+	return 0;
+}
+
+int capture_ctrl(uint32_t id, uint32_t ctrl, uint16_t *p_out)
+{
+	TIM_TypeDef *tim = tim_get(id);
+
+	if(tim == NULL) {
+		return -1;
+	}
+
+	switch (ctrl)
+	{
+	case CAPTURE_CTRL_START:
+		tim->CNT = 0;
+		tim->INTFR = 0;
+		TIM_Cmd(tim, ENABLE);
+	break;
+	case CAPTURE_CTRL_STOP:
+		TIM_Cmd(tim, DISABLE);
+	break;
+	case CAPTURE_CTRL_READ_PWM://p_out[0]: period, p_out[1]: high time, in ticks
+	{
+		uint16_t flags = tim->INTFR;
+
+		if(flags & TIM_FLAG_CC1) {
+			//the period first, the high time is latched before the period ends
+			p_out[1] = tim->CH2CVR;
+			p_out[0] = tim->CH1CVR;
+			tim->INTFR = (uint16_t)~(TIM_FLAG_Update | TIM_FLAG_CC1 | TIM_FLAG_CC2);
+			return 0;
+		}
+		if(flags & TIM_FLAG_Update) {
+			return -6;//no rising edge for a full counter period
+		}
+		return -5;
+	}
+	case CAPTURE_CTRL_EDGE_IRQ:
+		tim->DMAINTENR |= TIM_IT_CC1;
+	break;
+	default:
+		return -2;
+	}
+
+	return 0;
+}
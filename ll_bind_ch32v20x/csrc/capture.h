@@ -0,0 +1,8 @@
+#ifndef __CAPTURE_H__
+#define __CAPTURE_H__
+
+int capture_init(uint32_t id, uint32_t mode, uint32_t tick_hz, uint32_t flags, uint32_t dma_ch, uint32_t *p_ccr);
+int capture_deinit(uint32_t id);
+int capture_ctrl(uint32_t id, uint32_t ctrl, uint16_t *p_out);
+
+#endif //__CAPTURE_H__
@@ -9,26 +9,82 @@
 #include "dma.h"
 #include "print.h"
 
+//#define DMA_DEBUG //print the dma_init() parameters on the log UART
+
+#ifdef DMA_DEBUG
+#define dma_debug(...)				println(__VA_ARGS__)
+#else
+#define dma_debug(...)
+#endif
+
 #define DMA_CHX_TO_FLAG_TCX(ch)		DMA1_FLAG_TC1 << 4 * ((ch) - DMA1_Channel1)/(DMA1_Channel2 - DMA1_Channel1)
+#define DMA_CH_FLAGS(ch, flags)		((flags) << (4 * (ch)))//GL/TC/HT/TE of channel ch in DMA1->INTFR
+
+extern void DMA_CH0_hook_rs(uint32_t flags);
+extern void DMA_CH1_hook_rs(uint32_t flags);
+extern void DMA_CH2_hook_rs(uint32_t flags);
+extern void DMA_CH3_hook_rs(uint32_t flags);
+extern void DMA_CH4_hook_rs(uint32_t flags);
+extern void DMA_CH5_hook_rs(uint32_t flags);
+extern void DMA_CH6_hook_rs(uint32_t flags);
+extern void DMA_CH7_hook_rs(uint32_t flags);
 
 struct DmaInfo {
 	DMA_Channel_TypeDef * p_ch;
 	uint32_t TC_mask;
+	IRQn_Type irqn;
+	void (*hook)(uint32_t flags);
 };
 
 const struct DmaInfo DMA_list[] = { 
-	{DMA1_Channel1, DMA1_FLAG_TC1},
-	{DMA1_Channel2, DMA1_FLAG_TC2},
-	{DMA1_Channel3, DMA1_FLAG_TC3},
-	{DMA1_Channel4, DMA1_FLAG_TC4},
-	{DMA1_Channel5, DMA1_FLAG_TC5},
-	{DMA1_Channel6, DMA1_FLAG_TC6},
-	{DMA1_Channel7, DMA1_FLAG_TC7},
-	{DMA1_Channel8, DMA1_FLAG_TC8},
-	{DMA1_Channel8, DMA1_FLAG_TC8},
+	{DMA1_Channel1, DMA1_FLAG_TC1, DMA1_Channel1_IRQn, DMA_CH0_hook_rs},
+	{DMA1_Channel2, DMA1_FLAG_TC2, DMA1_Channel2_IRQn, DMA_CH1_hook_rs},
+	{DMA1_Channel3, DMA1_FLAG_TC3, DMA1_Channel3_IRQn, DMA_CH2_hook_rs},
+	{DMA1_Channel4, DMA1_FLAG_TC4, DMA1_Channel4_IRQn, DMA_CH3_hook_rs},
+	{DMA1_Channel5, DMA1_FLAG_TC5, DMA1_Channel5_IRQn, DMA_CH4_hook_rs},
+	{DMA1_Channel6, DMA1_FLAG_TC6, DMA1_Channel6_IRQn, DMA_CH5_hook_rs},
+	{DMA1_Channel7, DMA1_FLAG_TC7, DMA1_Channel7_IRQn, DMA_CH6_hook_rs},
+	{DMA1_Channel8, DMA1_FLAG_TC8, DMA1_Channel8_IRQn, DMA_CH7_hook_rs},
+};
+
+#define DMA_CH_BIT(ch)		(1 << (ch))
+#define DMA_CH_ALL			((1 << (sizeof(DMA_list)/sizeof(DMA_list[0]))) - 1)
+
+//channels which serve a peripheral request, the DMA1 request table of the CH32V20x RM
+static const uint8_t DMA_REQ_list[DMA_REQ_MAX] = {
+	[DMA_REQ_MEM]       = 0,//any channel, see dma_request_channels()
+	[DMA_REQ_ADC1]      = DMA_CH_BIT(DMA_CH0),
+	[DMA_REQ_SPI1_RX]   = DMA_CH_BIT(DMA_CH1),
+	[DMA_REQ_SPI1_TX]   = DMA_CH_BIT(DMA_CH2),
+	[DMA_REQ_SPI2_RX]   = DMA_CH_BIT(DMA_CH3),
+	[DMA_REQ_SPI2_TX]   = DMA_CH_BIT(DMA_CH4),
+	[DMA_REQ_USART1_TX] = DMA_CH_BIT(DMA_CH3),
+	[DMA_REQ_USART1_RX] = DMA_CH_BIT(DMA_CH4),
+	[DMA_REQ_USART2_RX] = DMA_CH_BIT(DMA_CH5),
+	[DMA_REQ_USART2_TX] = DMA_CH_BIT(DMA_CH6),
+	[DMA_REQ_USART3_TX] = DMA_CH_BIT(DMA_CH1),
+	[DMA_REQ_USART3_RX] = DMA_CH_BIT(DMA_CH2),
+	[DMA_REQ_I2C1_TX]   = DMA_CH_BIT(DMA_CH5),
+	[DMA_REQ_I2C1_RX]   = DMA_CH_BIT(DMA_CH6),
+	[DMA_REQ_I2C2_TX]   = DMA_CH_BIT(DMA_CH3),
+	[DMA_REQ_I2C2_RX]   = DMA_CH_BIT(DMA_CH4),
+	[DMA_REQ_TIM1_UP]   = DMA_CH_BIT(DMA_CH4),
+	[DMA_REQ_TIM2_UP]   = DMA_CH_BIT(DMA_CH1),
+	[DMA_REQ_TIM3_UP]   = DMA_CH_BIT(DMA_CH2),
+	[DMA_REQ_TIM4_UP]   = DMA_CH_BIT(DMA_CH6),
+	[DMA_REQ_TIM1_CH1]  = DMA_CH_BIT(DMA_CH1),
+	[DMA_REQ_TIM2_CH1]  = DMA_CH_BIT(DMA_CH4),
+	[DMA_REQ_TIM3_CH1]  = DMA_CH_BIT(DMA_CH5),
+	[DMA_REQ_TIM4_CH1]  = DMA_CH_BIT(DMA_CH0),
 };
 
-const struct DmaInfo DmaInfoNull = { NULL, 0 };
+static volatile uint32_t dma_done;//bit per channel, TC or TE seen by the irq
+static volatile uint32_t dma_error;//bit per channel, TE seen by the irq
+
+static const DmaSeg *volatile dma_chain_next[DMA_CH_MAX];//next segment, loaded by the TC irq
+static volatile uint16_t dma_chain_left[DMA_CH_MAX];
+
+const struct DmaInfo DmaInfoNull = { NULL, 0, 0, NULL };
 
 static struct DmaInfo get_DMA(uint32_t ch)
 {
@@ -59,10 +115,10 @@ int dma_init(uint32_t dma_ch, uint32_t src_addr, uint32_t src_buff_size,
 	if(dma_info.p_ch == NULL) {
 		return -1;
 	}
-	println("# dma_ch %d", dma_ch);
-	println("# src_addr 0x%X, buff_size: %d", src_addr, src_buff_size);
-	println("# dst_addr 0x%X, buff_size: %d", dst_addr, dst_buff_size);
-	println("# flags 0x%X, extra_flags 0x%X", flags, extra_flags);
+	dma_debug("# dma_ch %d", dma_ch);
+	dma_debug("# src_addr 0x%X, buff_size: %d", src_addr, src_buff_size);
+	dma_debug("# dst_addr 0x%X, buff_size: %d", dst_addr, dst_buff_size);
+	dma_debug("# flags 0x%X, extra_flags 0x%X", flags, extra_flags);
 
 
     DMA_StructInit(&DMA_InitStructure);
@@ -152,17 +208,17 @@ int dma_init(uint32_t dma_ch, uint32_t src_addr, uint32_t src_buff_size,
 
     DMA_InitStructure.DMA_Priority = DMA_Priority_VeryHigh;
 
-	println("@DMA_PeripheralBaseAddr = 0x%X", DMA_InitStructure.DMA_PeripheralBaseAddr);
-	println("@    DMA_MemoryBaseAddr = 0x%X", DMA_InitStructure.DMA_MemoryBaseAddr);
-	println("@               DMA_DIR = 0x%X", DMA_InitStructure.DMA_DIR);
-	println("@        DMA_BufferSize = 0x%X", DMA_InitStructure.DMA_BufferSize);
-	println("@     DMA_PeripheralInc = 0x%X", DMA_InitStructure.DMA_PeripheralInc);
-	println("@         DMA_MemoryInc = 0x%X", DMA_InitStructure.DMA_MemoryInc);
-	println("@DMA_PeripheralDataSize = 0x%X", DMA_InitStructure.DMA_PeripheralDataSize);
-	println("@    DMA_MemoryDataSize = 0x%X", DMA_InitStructure.DMA_MemoryDataSize);
-	println("@              DMA_Mode = 0x%X", DMA_InitStructure.DMA_Mode);
-	println("@          DMA_Priority = 0x%X", DMA_InitStructure.DMA_Priority);
-	println("@               DMA_M2M = 0x%X", DMA_InitStructure.DMA_M2M);
+	dma_debug("@DMA_PeripheralBaseAddr = 0x%X", DMA_InitStructure.DMA_PeripheralBaseAddr);
+	dma_debug("@    DMA_MemoryBaseAddr = 0x%X", DMA_InitStructure.DMA_MemoryBaseAddr);
+	dma_debug("@               DMA_DIR = 0x%X", DMA_InitStructure.DMA_DIR);
+	dma_debug("@        DMA_BufferSize = 0x%X", DMA_InitStructure.DMA_BufferSize);
+	dma_debug("@     DMA_PeripheralInc = 0x%X", DMA_InitStructure.DMA_PeripheralInc);
+	dma_debug("@         DMA_MemoryInc = 0x%X", DMA_InitStructure.DMA_MemoryInc);
+	dma_debug("@DMA_PeripheralDataSize = 0x%X", DMA_InitStructure.DMA_PeripheralDataSize);
+	dma_debug("@    DMA_MemoryDataSize = 0x%X", DMA_InitStructure.DMA_MemoryDataSize);
+	dma_debug("@              DMA_Mode = 0x%X", DMA_InitStructure.DMA_Mode);
+	dma_debug("@          DMA_Priority = 0x%X", DMA_InitStructure.DMA_Priority);
+	dma_debug("@               DMA_M2M = 0x%X", DMA_InitStructure.DMA_M2M);
 
     DMA_Init(dma_info.p_ch, &DMA_InitStructure);
 
@@ -171,7 +227,209 @@ int dma_init(uint32_t dma_ch, uint32_t src_addr, uint32_t src_buff_size,
 	return 0;
 }
 
-int dma_ctrl(uint32_t dma_ch, uint32_t work)
+//program one chain segment, the channel must be disabled
+static void dma_seg_load(DMA_Channel_TypeDef *p_ch, const DmaSeg *seg)
+{
+	uint32_t size = (seg->width == 4) ? 2 : (seg->width == 2) ? 1 : 0;
+	uint32_t cfgr = p_ch->CFGR & ~(DMA_CFGR1_EN | DMA_CFGR1_PSIZE | DMA_CFGR1_MSIZE | DMA_CFGR1_PINC | DMA_CFGR1_MINC);
+
+	cfgr |= (size << 8) | (size << 10);//PSIZE, MSIZE
+	if(cfgr & DMA_CFGR1_DIR) {//memory to peripheral
+		p_ch->MADDR = seg->src;
+		p_ch->PADDR = seg->dst;
+		cfgr |= ((seg->flags & DMA_SEG_SRC_INC) ? DMA_CFGR1_MINC : 0) | ((seg->flags & DMA_SEG_DST_INC) ? DMA_CFGR1_PINC : 0);
+	} else {
+		p_ch->PADDR = seg->src;
+		p_ch->MADDR = seg->dst;
+		cfgr |= ((seg->flags & DMA_SEG_SRC_INC) ? DMA_CFGR1_PINC : 0) | ((seg->flags & DMA_SEG_DST_INC) ? DMA_CFGR1_MINC : 0);
+	}
+	p_ch->CNTR = seg->count;
+	p_ch->CFGR = cfgr;
+	p_ch->CFGR = cfgr | DMA_CFGR1_EN;
+}
+
+//run segs back to back on one channel, the TC irq loads the next segment
+//flags: DMA_FLAG_MEM_TO_MEM / DMA_FLAG_PERIPH_TO_MEM / DMA_FLAG_MEM_TO_PERIPH, peripheral side is the register of the request
+int dma_chain_start(uint32_t dma_ch, uint32_t flags, const DmaSeg *segs, uint32_t count)
+{
+	struct DmaInfo dma_info = get_DMA(dma_ch);
+	DMA_Channel_TypeDef *p_ch = dma_info.p_ch;
+	uint32_t x2x = flags & DMA_FLAG_X_TO_X_MASK;
+	uint32_t cfgr = DMA_CFGR1_PL | DMA_CFGR1_TCIE | DMA_CFGR1_TEIE;//very high priority
+
+	if(p_ch == NULL) {
+		return -1;
+	}
+	if((segs == NULL) || (count == 0) || (count > 0xFFFF)) {
+		return -5;
+	}
+	for(uint32_t i = 0; i < count; i++) {
+		if(segs[i].count == 0) {
+			return -5;
+		}
+	}
+	if(x2x == DMA_FLAG_MEM_TO_MEM) {
+		cfgr |= DMA_CFGR1_MEM2MEM;
+	} else if(x2x == DMA_FLAG_MEM_TO_PERIPH) {
+		cfgr |= DMA_CFGR1_DIR;
+	} else if(x2x != DMA_FLAG_PERIPH_TO_MEM) {
+		return -2;
+	}
+
+	p_ch->CFGR = cfgr;
+	DMA1->INTFCR = DMA_CH_FLAGS(dma_ch, 0x0F);
+	dma_done &= ~(1 << dma_ch);
+	dma_error &= ~(1 << dma_ch);
+	dma_chain_next[dma_ch] = segs + 1;
+	dma_chain_left[dma_ch] = count - 1;
+
+	NVIC_InitTypeDef NVIC_InitStructure = {0};
+	NVIC_InitStructure.NVIC_IRQChannel = dma_info.irqn;
+	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 1;
+	NVIC_InitStructure.NVIC_IRQChannelSubPriority = 2;
+	NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_Init(&NVIC_InitStructure);
+
+	dma_seg_load(p_ch, segs);
+
+	return 0;
+}
+
+//bit mask of the channels able to serve the request, memory to memory may use any channel
+int dma_request_channels(uint32_t request)
+{
+	if(request >= DMA_REQ_MAX) {
+		return -1;
+	}
+	if(request == DMA_REQ_MEM) {
+		return DMA_CH_ALL;
+	}
+
+	return DMA_REQ_list[request];
+}
+
+//re-arm a channel set up by dma_init() with new addresses and count, the other settings are kept
+int dma_reload(uint32_t dma_ch, uint32_t src_addr, uint32_t dst_addr, uint32_t count)
+{
+	struct DmaInfo dma_info = get_DMA(dma_ch);
+	DMA_Channel_TypeDef *p_ch = dma_info.p_ch;
+
+	if(p_ch == NULL) {
+		return -1;
+	}
+	if((count == 0) || (count > 0xFFFF)) {
+		return -5;
+	}
+
+	p_ch->CFGR &= ~DMA_CFGR1_EN;//PADDR/MADDR/CNTR are writable only while the channel is disabled
+	if(p_ch->CFGR & DMA_CFGR1_DIR) {//memory to peripheral
+		p_ch->MADDR = src_addr;
+		p_ch->PADDR = dst_addr;
+	} else {
+		p_ch->PADDR = src_addr;
+		p_ch->MADDR = dst_addr;
+	}
+	p_ch->CNTR = count;
+
+	DMA1->INTFCR = DMA_CH_FLAGS(dma_ch, 0x0F);
+	dma_done &= ~(1 << dma_ch);
+	dma_error &= ~(1 << dma_ch);
+	p_ch->CFGR |= DMA_CFGR1_EN;
+
+	return 0;
+}
+
+//mask: DMA_IRQ_TC | DMA_IRQ_HT | DMA_IRQ_TE, 0 disables the channel irq
+static int dma_irq_config(uint32_t dma_ch, struct DmaInfo *dma_info, uint32_t mask)
+{
+	uint32_t ie = DMA_CFGR1_TCIE | DMA_CFGR1_HTIE | DMA_CFGR1_TEIE;
+
+	if(mask & ~(uint32_t)DMA_IRQ_MASK) {
+		return -3;
+	}
+
+	dma_info->p_ch->CFGR = (dma_info->p_ch->CFGR & ~ie) | (mask & ie);
+	if(mask) {
+		NVIC_InitTypeDef NVIC_InitStructure = {0};
+		NVIC_InitStructure.NVIC_IRQChannel = dma_info->irqn;
+		NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 1;
+		NVIC_InitStructure.NVIC_IRQChannelSubPriority = 2;
+		NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+		NVIC_Init(&NVIC_InitStructure);
+	} else {
+		NVIC_DisableIRQ(dma_info->irqn);
+		dma_done &= ~(1 << dma_ch);
+	}
+
+	return 0;
+}
+
+static void dma_irq(uint32_t dma_ch)
+{
+	uint32_t latched = (DMA1->INTFR >> (4 * dma_ch)) & DMA_IRQ_MASK;
+	//DMA_IRQ_TC/HT/TE share the bit positions of CFGR TCIE/HTIE/TEIE, flags of irqs not
+	//enabled stay latched for polling and are not reported
+	uint32_t flags = latched & DMA_list[dma_ch].p_ch->CFGR;
+
+	DMA1->INTFCR = DMA_CH_FLAGS(dma_ch, flags | (flags == latched ? 0x01 : 0));
+	if(flags == 0) {
+		return;
+	}
+	if(dma_chain_left[dma_ch]) {
+		if(flags & DMA_IRQ_TE) {
+			dma_chain_left[dma_ch] = 0;
+		} else if(flags & DMA_IRQ_TC) {
+			dma_seg_load(DMA_list[dma_ch].p_ch, dma_chain_next[dma_ch]);
+			dma_chain_next[dma_ch]++;
+			dma_chain_left[dma_ch]--;
+			return;//the chain reports its end only
+		}
+	}
+	if(flags & DMA_IRQ_TE) {
+		dma_error |= 1 << dma_ch;
+	}
+	if(flags & (DMA_IRQ_TC | DMA_IRQ_TE)) {
+		dma_done |= 1 << dma_ch;
+	}
+	DMA_list[dma_ch].hook(flags);
+}
+
+//stops the channel, disables its irq and clears its flags, so a released channel neither runs
+//nor reports to the next owner
+int dma_deinit(uint32_t dma_ch)
+{
+	struct DmaInfo dma_info = get_DMA(dma_ch);
+
+	if(dma_info.p_ch == NULL) {
+		return -1;
+	}
+	dma_chain_left[dma_ch] = 0;
+	DMA_Cmd(dma_info.p_ch, DISABLE);
+	dma_irq_config(dma_ch, &dma_info, 0);
+	DMA1->INTFCR = DMA_CH_FLAGS(dma_ch, 0x0F);
+	dma_done &= ~(1 << dma_ch);
+	dma_error &= ~(1 << dma_ch);
+
+	return 0;
+}
+
+#define DMA_IRQ_HANDLER(n, dma_ch) \
+void DMA1_Channel##n##_IRQHandler(void) __attribute__((interrupt("WCH-Interrupt-fast"))); \
+void DMA1_Channel##n##_IRQHandler(void) \
+{ \
+	dma_irq(dma_ch); \
+}
+
+DMA_IRQ_HANDLER(1, DMA_CH0)
+DMA_IRQ_HANDLER(2, DMA_CH1)
+DMA_IRQ_HANDLER(3, DMA_CH2)
+DMA_IRQ_HANDLER(4, DMA_CH3)
+DMA_IRQ_HANDLER(5, DMA_CH4)
+DMA_IRQ_HANDLER(6, DMA_CH5)
+DMA_IRQ_HANDLER(7, DMA_CH6)
+DMA_IRQ_HANDLER(8, DMA_CH7)
+
+int dma_ctrl(uint32_t dma_ch, uint32_t work, uint32_t param)
 {
 	struct DmaInfo dma_info = get_DMA(dma_ch);
 
@@ -181,17 +439,32 @@ int dma_ctrl(uint32_t dma_ch, uint32_t work)
 
 	switch(work) {
 	case DMA_CTRL_START:
+		DMA1->INTFCR = DMA_CH_FLAGS(dma_ch, 0x0F);
+		dma_done &= ~(1 << dma_ch);
+		dma_error &= ~(1 << dma_ch);
 		DMA_Cmd(dma_info.p_ch, ENABLE);
 	break;
 	case DMA_CTRL_STOP:
+		dma_chain_left[dma_ch] = 0;
 		DMA_Cmd(dma_info.p_ch, DISABLE);
 	break;
 	case DMA_CTRL_WAIT:
 		if(dma_info.p_ch->CFGR & DMA_CFGR1_EN)
 		{
-			while(DMA_GetFlagStatus(dma_info.TC_mask) == RESET);
+			if(dma_info.p_ch->CFGR & DMA_CFGR1_TCIE) {//the irq clears the flags
+				while((dma_done & (1 << dma_ch)) == 0);
+			} else {//TC stays latched, a TE irq still reports errors
+				while(DMA_GetFlagStatus(dma_info.TC_mask) == RESET && (dma_error & (1 << dma_ch)) == 0);
+			}
+			if(dma_error & (1 << dma_ch)) {
+				return -4;
+			}
 		}
 	break;
+	case DMA_CTRL_IRQ:
+		return dma_irq_config(dma_ch, &dma_info, param);
+	case DMA_CTRL_GET_COUNT://items left until the end of the buffer
+		return dma_info.p_ch->CNTR;
 	default:
 		return -2;
 	}
@@ -1,7 +1,20 @@
 #ifndef __DMA_H__
 #define __DMA_H__
 
+//one segment of a chain, laid out as DmaSegment in the HAL
+typedef struct {
+	uint32_t src;
+	uint32_t dst;
+	uint16_t count;//data items
+	uint8_t width;//bytes per item: 1, 2 or 4
+	uint8_t flags;//DMA_SEG_SRC_INC | DMA_SEG_DST_INC
+} DmaSeg;
+
 int dma_init(uint32_t dma_ch, uint32_t src_addr, uint32_t src_buff_size, uint32_t dst_addr, uint32_t dst_buff_size, uint32_t flags, uint32_t extra_flags);
-int dma_ctrl(uint32_t dma_ch, uint32_t work);
+int dma_deinit(uint32_t dma_ch);
+int dma_ctrl(uint32_t dma_ch, uint32_t work, uint32_t param);
+int dma_reload(uint32_t dma_ch, uint32_t src_addr, uint32_t dst_addr, uint32_t count);
+int dma_request_channels(uint32_t request);
+int dma_chain_start(uint32_t dma_ch, uint32_t flags, const DmaSeg *segs, uint32_t count);
 
 #endif //__DMA_H__
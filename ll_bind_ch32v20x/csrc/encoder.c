@@ -0,0 +1,137 @@
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include "ch32v20x.h"
+#include "wrapper.h"
+#include "encoder.h"
+#include "timer.h"
+
+extern uint32_t ll_irq_save(void);
+extern void ll_irq_restore(uint32_t state);
+
+//the counter is sampled at 0, 1/3 and 2/3 of its range, so it moves less than half the range
+//between two samples and the signed 16-bit difference is exact in both directions
+#define ENCODER_MARK_1 0x5555
+#define ENCODER_MARK_2 0xAAAA
+
+static int32_t encoder_pos[TIM_ID_MAX];
+static uint16_t encoder_last[TIM_ID_MAX];
+
+static void encoder_sample(uint32_t id, TIM_TypeDef *tim)
+{
+	uint16_t cnt = tim->CNT;
+
+	encoder_pos[id] += (int16_t)(uint16_t)(cnt - encoder_last[id]);
+	encoder_last[id] = cnt;
+}
+
+static void encoder_irq(uint32_t id, TIM_TypeDef *tim)
+{
+	tim->INTFR = (uint16_t)~(TIM_FLAG_Update | TIM_FLAG_CC3 | TIM_FLAG_CC4);
+	encoder_sample(id, tim);
+}
+
+/**
+ * Quadrature decoder on CH1/CH2 of timer id. The inputs clock the counter, edges cost no CPU
+ * time; the timer interrupts only when the counter passes 0, 0x5555 or 0xAAAA to extend the
+ * position to 32 bits.
+ * flags: ENCODER_MODE_X2 counts the edges of CH1 only, input filter 0..15 in bits 4..7.
+ * -3 if the timer is run by another driver, see tim_claim()
+ */
+int encoder_init(uint32_t id, uint32_t flags)
+{
+	TIM_TypeDef *tim = tim_get(id);
+	TIM_TimeBaseInitTypeDef TIM_TimeBaseInitStructure = {0};
+	TIM_ICInitTypeDef TIM_ICInitStructure = {0};
+	uint16_t mode = (flags & ENCODER_MODE_X2) ? TIM_EncoderMode_TI1 : TIM_EncoderMode_TI12;
+
+	if(tim == NULL) {
+		return -1;
+	}
+	//PWM channels, the ADC trigger or another driver on the timer
+	if(tim_claim(id, TIM_OWNER_ENCODER) != 0) {
+		return -3;
+	}
+
+	tim_clock_enable(tim);
+	TIM_DeInit(tim);
+	TIM_TimeBaseInitStructure.TIM_Period = 0xFFFF;
+	TIM_TimeBaseInitStructure.TIM_Prescaler = 0;
+	TIM_TimeBaseInitStructure.TIM_ClockDivision = TIM_CKD_DIV1;
+	TIM_TimeBaseInitStructure.TIM_CounterMode = TIM_CounterMode_Up;
+	TIM_TimeBaseInit(tim, &TIM_TimeBaseInitStructure);
+
+	TIM_EncoderInterfaceConfig(tim, mode, TIM_ICPolarity_Rising, TIM_ICPolarity_Rising);
+	TIM_ICStructInit(&TIM_ICInitStructure);
+	TIM_ICInitStructure.TIM_ICFilter = (flags >> ENCODER_FILTER_SHIFT) & 0x0F;
+	TIM_ICInitStructure.TIM_Channel = TIM_Channel_1;
+	TIM_ICInit(tim, &TIM_ICInitStructure);
+	TIM_ICInitStructure.TIM_Channel = TIM_Channel_2;
+	TIM_ICInit(tim, &TIM_ICInitStructure);
+
+	//CH3/CH4 stay frozen outputs, their compare flags mark the sample points
+	tim->CH3CVR = ENCODER_MARK_1;
+	tim->CH4CVR = ENCODER_MARK_2;
+	tim->CNT = 0;
+	tim->INTFR = 0;
+	encoder_pos[id] = 0;
+	encoder_last[id] = 0;
+
+	TIM_ITConfig(tim, TIM_IT_Update | TIM_IT_CC3 | TIM_IT_CC4, ENABLE);
+	tim_irq_attach(id, encoder_irq);
+	TIM_Cmd(tim, ENABLE);
+
+	return 0;
+}
+
+int encoder_deinit(uint32_t id)
+{
+	TIM_TypeDef *tim = tim_get(id);
+
+	if(tim == NULL) {
+		return -1;
+	}
+	if(tim_release(id, TIM_OWNER_ENCODER) != 0) {
+		return -3;
+	}
+	tim_irq_attach(id, NULL);
+	TIM_Cmd(tim, DISABLE);
+	TIM_DeInit(tim);
+
+	return 0;
+}
+
+int encoder_ctrl(uint32_t id, uint32_t ctrl, uint32_t *p_out)
+{
+	TIM_TypeDef *tim = tim_get(id);
+	uint32_t state;
+
+	if(tim == NULL) {
+		return -1;
+	}
+
+	switch (ctrl)
+	{
+	case ENCODER_CTRL_READ://p_out[0]: position, p_out[1]: SysTick->CNT at the read
+		state = ll_irq_save();
+		encoder_sample(id, tim);
+		p_out[0] = (uint32_t)encoder_pos[id];
+		p_out[1] = (uint32_t)SysTick->CNT;
+		ll_irq_restore(state);
+	break;
+	case ENCODER_CTRL_SET://p_out[0]: new position
+		state = ll_irq_save();
+		tim->CNT = (uint16_t)p_out[0];
+		encoder_last[id] = (uint16_t)p_out[0];
+		encoder_pos[id] = (int32_t)p_out[0];
+		ll_irq_restore(state);
+	break;
+	case ENCODER_CTRL_GET_CLOCK://p_out[0]: SysTick rate of the timestamps
+		p_out[0] = SystemCoreClock;
+	break;
+	default:
+		return -2;
+	}
+
+	return 0;
+}
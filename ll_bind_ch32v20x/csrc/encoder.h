@@ -0,0 +1,8 @@
+#ifndef __ENCODER_H__
+#define __ENCODER_H__
+
+int encoder_init(uint32_t id, uint32_t flags);
+int encoder_deinit(uint32_t id);
+int encoder_ctrl(uint32_t id, uint32_t ctrl, uint32_t *p_out);
+
+#endif //__ENCODER_H__
@@ -0,0 +1,167 @@
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include "ch32v20x.h"
+#include "wrapper.h"
+#include "hwtimer.h"
+#include "timer.h"
+
+extern uint32_t ll_irq_save(void);
+extern void ll_irq_restore(uint32_t state);
+extern void TIM_HWTIMER_hook_rs(uint32_t id);
+
+//upper 16 bits of the 32-bit time, counter overflows
+static uint16_t hwtimer_high[TIM_ID_MAX];
+static uint32_t hwtimer_deadline[TIM_ID_MAX];
+static bool hwtimer_armed[TIM_ID_MAX];
+
+//called with irqs masked, an overflow not serviced yet counts once the counter wrapped
+static uint32_t hwtimer_now(uint32_t id, TIM_TypeDef *tim)
+{
+	uint16_t cnt = tim->CNT;
+	uint32_t high = hwtimer_high[id];
+
+	if((tim->INTFR & TIM_FLAG_Update) && cnt < 0x8000) {
+		high++;
+	}
+
+	return (high << 16) | cnt;
+}
+
+//the compare matches the low 16 bits, it is armed once the deadline is less than a counter
+//period ahead; a deadline already passed fires at once by a software compare event
+static void hwtimer_arm(uint32_t id, TIM_TypeDef *tim)
+{
+	uint32_t deadline = hwtimer_deadline[id];
+	int32_t left = (int32_t)(deadline - hwtimer_now(id, tim));
+
+	if(left >= 0x10000) {
+		return;//armed by the overflow irq
+	}
+	tim->CH1CVR = (uint16_t)deadline;
+	tim->INTFR = (uint16_t)~TIM_FLAG_CC1;
+	tim->DMAINTENR |= TIM_IT_CC1;
+	//the counter may have passed the compare value while it was written
+	if(left <= 0 || (int32_t)(deadline - hwtimer_now(id, tim)) <= 0) {
+		tim->SWEVGR = TIM_EventSource_CC1;
+	}
+}
+
+static void hwtimer_irq(uint32_t id, TIM_TypeDef *tim)
+{
+	bool due = false;
+
+	if(tim->INTFR & TIM_FLAG_Update) {
+		tim->INTFR = (uint16_t)~TIM_FLAG_Update;
+		hwtimer_high[id]++;
+		if(hwtimer_armed[id] && !(tim->DMAINTENR & TIM_IT_CC1)) {
+			hwtimer_arm(id, tim);
+		}
+	}
+	if((tim->DMAINTENR & TIM_IT_CC1) && (tim->INTFR & TIM_FLAG_CC1)) {
+		tim->DMAINTENR &= ~TIM_IT_CC1;
+		tim->INTFR = (uint16_t)~TIM_FLAG_CC1;
+		hwtimer_armed[id] = false;
+		due = true;
+	}
+	if(due) {
+		TIM_HWTIMER_hook_rs(id);
+	}
+}
+
+/**
+ * Free running 32-bit time of timer id at tick_hz, with one alarm. The counter overflow
+ * interrupts once per 65536 ticks, the alarm calls TIM_HWTIMER_hook_rs at its deadline.
+ * -3 if the timer is run by another driver, see tim_claim()
+ */
+int hwtimer_init(uint32_t id, uint32_t tick_hz)
+{
+	TIM_TypeDef *tim = tim_get(id);
+	TIM_TimeBaseInitTypeDef TIM_TimeBaseInitStructure = {0};
+	uint32_t psc;
+
+	if(tim == NULL || tick_hz == 0) {
+		return -1;
+	}
+	psc = (tim_clock_hz(tim) + tick_hz / 2) / tick_hz;
+	if(psc == 0 || psc > 0x10000) {
+		return -2;
+	}
+	//PWM channels, the ADC trigger or another driver on the timer
+	if(tim_claim(id, TIM_OWNER_HWTIMER) != 0) {
+		return -3;
+	}
+
+	tim_clock_enable(tim);
+	TIM_DeInit(tim);
+	TIM_TimeBaseInitStructure.TIM_Period = 0xFFFF;
+	TIM_TimeBaseInitStructure.TIM_Prescaler = psc - 1;
+	TIM_TimeBaseInitStructure.TIM_ClockDivision = TIM_CKD_DIV1;
+	TIM_TimeBaseInitStructure.TIM_CounterMode = TIM_CounterMode_Up;
+	TIM_TimeBaseInit(tim, &TIM_TimeBaseInitStructure);
+
+	//CH1 stays a frozen output, its compare flag is the alarm
+	tim->CNT = 0;
+	tim->INTFR = 0;
+	hwtimer_high[id] = 0;
+	hwtimer_armed[id] = false;
+
+	TIM_ITConfig(tim, TIM_IT_Update, ENABLE);
+	tim_irq_attach(id, hwtimer_irq);
+	TIM_Cmd(tim, ENABLE);
+
+	return 0;
+}
+
+int hwtimer_deinit(uint32_t id)
+{
+	TIM_TypeDef *tim = tim_get(id);
+
+	if(tim == NULL) {
+		return -1;
+	}
+	if(tim_release(id, TIM_OWNER_HWTIMER) != 0) {
+		return -3;
+	}
+	tim_irq_attach(id, NULL);
+	TIM_Cmd(tim, DISABLE);
+	TIM_DeInit(tim);
+	hwtimer_armed[id] = false;
+
+	return 0;
+}
+
+int hwtimer_ctrl(uint32_t id, uint32_t ctrl, uint32_t *p_out)
+{
+	TIM_TypeDef *tim = tim_get(id);
+	uint32_t state;
+	int result = 0;
+
+	if(tim == NULL) {
+		return -1;
+	}
+
+	state = ll_irq_save();
+	switch (ctrl)
+	{
+	case HWTIMER_CTRL_NOW://p_out[0]: time in ticks
+		p_out[0] = hwtimer_now(id, tim);
+	break;
+	case HWTIMER_CTRL_SET_ALARM://p_out[0]: deadline, replaces the alarm
+		tim->DMAINTENR &= ~TIM_IT_CC1;
+		hwtimer_deadline[id] = p_out[0];
+		hwtimer_armed[id] = true;
+		hwtimer_arm(id, tim);
+	break;
+	case HWTIMER_CTRL_CANCEL:
+		tim->DMAINTENR &= ~TIM_IT_CC1;
+		hwtimer_armed[id] = false;
+	break;
+	default:
+		result = -2;
+	break;
+	}
+	ll_irq_restore(state);
+
+	return result;
+}
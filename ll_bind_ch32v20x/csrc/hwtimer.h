@@ -0,0 +1,8 @@
+#ifndef __HWTIMER_H__
+#define __HWTIMER_H__
+
+int hwtimer_init(uint32_t id, uint32_t tick_hz);
+int hwtimer_deinit(uint32_t id);
+int hwtimer_ctrl(uint32_t id, uint32_t ctrl, uint32_t *p_out);
+
+#endif //__HWTIMER_H__
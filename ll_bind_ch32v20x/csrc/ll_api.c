@@ -11,6 +11,9 @@
 #include "spi_bus.h"
 #include "i2c.h"
 #include "pwm.h"
+#include "capture.h"
+#include "encoder.h"
+#include "hwtimer.h"
 #include "usart.h"
 #include "adc.h"
 #include "print.h"
@@ -65,10 +68,33 @@ static void hw_config(void)
 }
 
 
+#if(DEBUG == DEBUG_UART1)
+#define LOG_USART       USART1
+#define LOG_USART_IRQn  USART1_IRQn
+#elif(DEBUG == DEBUG_UART2)
+#define LOG_USART       USART2
+#define LOG_USART_IRQn  USART2_IRQn
+#elif(DEBUG == DEBUG_UART3)
+#define LOG_USART       USART3
+#define LOG_USART_IRQn  USART3_IRQn
+#endif
+
+static void log_irq_config(void)
+{
+    NVIC_InitTypeDef NVIC_InitStructure = {0};
+
+    NVIC_InitStructure.NVIC_IRQChannel = LOG_USART_IRQn;
+    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 1;
+    NVIC_InitStructure.NVIC_IRQChannelSubPriority = 3;
+    NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+    NVIC_Init(&NVIC_InitStructure);
+}
+
 void hal_hw_init(void)
 {
 	hw_config();
 	USART_Printf_Init(115200);
+	log_irq_config();
 }
 
 void delay_ns(uint32_t ns)
@@ -85,20 +111,61 @@ void delay_ns(uint32_t ns)
 	while(SysTick->CNT < target);
 }
 
+uint32_t ll_irq_save(void)
+{
+	uint32_t gintenr;
+	__asm volatile("csrrci %0, 0x800, 0x8" : "=r"(gintenr));
+	return gintenr;
+}
+
+void ll_irq_restore(uint32_t state)
+{
+	if(state & 0x8) {
+		__asm volatile("csrsi 0x800, 0x8");
+	}
+}
+
 void ll_putc(char c)
 {
-	USART_TypeDef *USARTx;
+	while(USART_GetFlagStatus(LOG_USART, USART_FLAG_TXE) == 0);
+	USART_SendData(LOG_USART, (uint8_t)c);
+}
+
+void ll_log_tx_start(void)
+{
+	LOG_USART->CTLR1 |= USART_CTLR1_TXEIE;
+}
+
+void ll_log_tx_wait_done(void)
+{
+	while(USART_GetFlagStatus(LOG_USART, USART_FLAG_TC) == 0);
+}
+
+void ll_log_tx_irq(void)
+{
+	if((LOG_USART->CTLR1 & USART_CTLR1_TXEIE) && USART_GetFlagStatus(LOG_USART, USART_FLAG_TXE)) {
+		int c = ll_log_pop();
+		if(c < 0) {
+			LOG_USART->CTLR1 &= ~USART_CTLR1_TXEIE;
+		} else {
+			USART_SendData(LOG_USART, (uint8_t)c);
+		}
+	}
+}
+
 #if(DEBUG == DEBUG_UART1)
-	USARTx = USART1;
-#elif(DEBUG == DEBUG_UART2)
-	USARTx = USART2;
+void USART1_IRQHandler(void) __attribute__((interrupt("WCH-Interrupt-fast")));
+void USART1_IRQHandler(void)
+{
+	ll_log_tx_irq();
+}
 #elif(DEBUG == DEBUG_UART3)
-	USARTx = USART3;
-#endif
-
-	USART_SendData(USARTx, (uint8_t)c);
-	while(USART_GetFlagStatus(USARTx, USART_FLAG_TC) == 0);
+void USART3_IRQHandler(void) __attribute__((interrupt("WCH-Interrupt-fast")));
+void USART3_IRQHandler(void)
+{
+	ll_log_tx_irq();
 }
+#endif //DEBUG_UART2: USART2_IRQHandler in usart.c calls ll_log_tx_irq()
 
 int ll_invoke(enum INVOKE invoke_id, ...)
 {
@@ -112,6 +179,7 @@ int ll_invoke(enum INVOKE invoke_id, ...)
 		//system inited in start asm.
 	break;
 	case ID_SYSTEM_RESET:
+		ll_log_flush();
 		NVIC_SystemReset();
 	break;
 	case ID_LL_DRV_INIT:
@@ -132,9 +200,7 @@ int ll_invoke(enum INVOKE invoke_id, ...)
 		uint8_t* p_str = va_arg(args, uint8_t*);
 		uint32_t len = va_arg(args, uint32_t);
 
-		while (len--) {
-			ll_putc(*p_str++);
-		}
+		ll_log_write((const char*)p_str, len);
 	}
 	break;
 	case ID_LOG_PRINT:
@@ -143,6 +209,22 @@ int ll_invoke(enum INVOKE invoke_id, ...)
 		ll_vprintf(fmt, args);
 	}
 	break;
+	case ID_LOG_CTRL:
+	{
+		uint32_t ctrl = va_arg(args, uint32_t);
+		uint32_t param = va_arg(args, uint32_t);
+
+		result = ll_log_ctrl(ctrl, param);
+	}
+	break;
+	case ID_LOG_PUT_FRAME:
+	{
+		uint8_t* p_frame = va_arg(args, uint8_t*);
+		uint32_t len = va_arg(args, uint32_t);
+
+		result = ll_log_write_frame((const char*)p_frame, len);
+	}
+	break;
 	case ID_GPIO_INIT:
 	{
 		uint32_t port = va_arg(args, uint32_t);
@@ -232,6 +314,21 @@ int ll_invoke(enum INVOKE invoke_id, ...)
 		result = usart_blocking_write(usart_id, p_buff, size);
 	}
 	break;
+	case ID_USART_SET_BAUDRATE:
+	{
+		uint32_t usart_id = va_arg(args, uint32_t);
+		uint32_t baud_rate = va_arg(args, uint32_t);
+		result = usart_set_baudrate(usart_id, baud_rate);
+	}
+	break;
+	case ID_USART_AUTOBAUD:
+	{
+		uint32_t usart_id = va_arg(args, uint32_t);
+		uint32_t mode = va_arg(args, uint32_t);
+		uint32_t timeout_ms = va_arg(args, uint32_t);
+		result = usart_autobaud(usart_id, mode, timeout_ms);
+	}
+	break;
 	case ID_ADC_INIT:
 	{
 		uint32_t adc_ch = va_arg(args, uint32_t);
@@ -265,18 +362,95 @@ int ll_invoke(enum INVOKE invoke_id, ...)
 				p_buf[idx] = Get_ConversionVal(adc_ch);
 			}
 		} else if(ctrl == ADC_CTRL_START) {
-			adc_buffered_init(adc_ch);
+			result = adc_buffered_init(adc_ch);
 		} else if(ctrl == ADC_CTRL_STOP) {
 			adc_buffered_deinit(adc_ch);
+		} else if(ctrl == ADC_CTRL_SET_RATE) {
+			uint32_t rate_hz = va_arg(args, uint32_t);
+			result = adc_set_rate(rate_hz);
+		}
+	}
+	break;
+	case ID_ADC_SCAN_INIT:
+	{
+		const uint8_t *inputs = va_arg(args, const uint8_t *);
+		uint32_t count        = va_arg(args, uint32_t);
+		uint32_t sample_time  = va_arg(args, uint32_t);
+		uint32_t flags        = va_arg(args, uint32_t);
+		uint32_t *p_data_reg  = va_arg(args, uint32_t *);
+
+		result = adc_scan_init(inputs, count, sample_time, flags, p_data_reg);
+	}
+	break;
+	case ID_ADC_SCAN_CTRL:
+	{
+		uint32_t ctrl = va_arg(args, uint32_t);
+
+		if(ctrl == ADC_SCAN_CTRL_SET_RATE) {
+			uint32_t rate_hz = va_arg(args, uint32_t);
+			result = adc_scan_set_rate(rate_hz);
+		} else {
+			result = adc_scan_ctrl(ctrl);
+		}
+	}
+	break;
+	case ID_ADC_DUAL_INIT:
+	{
+		const uint8_t *pairs  = va_arg(args, const uint8_t *);
+		uint32_t count        = va_arg(args, uint32_t);
+		uint32_t sample_time  = va_arg(args, uint32_t);
+		uint32_t *p_data_reg  = va_arg(args, uint32_t *);
+
+		result = adc_dual_init(pairs, count, sample_time, p_data_reg);
+	}
+	break;
+	case ID_ADC_INJECT_START:
+	{
+		const uint8_t *inputs = va_arg(args, const uint8_t *);
+		uint32_t count        = va_arg(args, uint32_t);
+		uint32_t sample_time  = va_arg(args, uint32_t);
+		uint32_t flags        = va_arg(args, uint32_t);
+
+		result = adc_inject_start(inputs, count, sample_time, flags);
+	}
+	break;
+	case ID_ADC_INJECT_READ:
+	{
+		uint16_t *p_buf = va_arg(args, uint16_t *);
+		uint32_t count  = va_arg(args, uint32_t);
+		uint32_t wait   = va_arg(args, uint32_t);
+
+		result = adc_inject_read(p_buf, count, wait);
+	}
+	break;
+	case ID_ADC_WATCHDOG:
+	{
+		uint32_t ctrl = va_arg(args, uint32_t);
+		uint32_t input = 0, low = 0, high = 0;
+
+		if(ctrl == ADC_WATCHDOG_CTRL_SET) {
+			input = va_arg(args, uint32_t);
+			low   = va_arg(args, uint32_t);
+			high  = va_arg(args, uint32_t);
 		}
+		result = adc_watchdog_ctrl(ctrl, input, low, high);
+	}
+	break;
+	case ID_ADC_GET_CALIBRATION:
+	{
+		struct AdcCalibration *p_cal = va_arg(args, struct AdcCalibration *);
+
+		result = adc_get_calibration(p_cal);
 	}
 	break;
 	case ID_PWM_INIT:
 	{
 		uint32_t pwm_ch = va_arg(args, uint32_t);
 		uint32_t freq = va_arg(args, uint32_t);
+		uint32_t flags = va_arg(args, uint32_t);
+		uint32_t *p_ccr = va_arg(args, uint32_t *);
 
-		result = pwm_init(pwm_ch, freq);
+		result = pwm_init(pwm_ch, freq, flags, p_ccr);
 	}
 	break;
 	case ID_PWM_DEINIT:
@@ -294,6 +468,27 @@ int ll_invoke(enum INVOKE invoke_id, ...)
 		result = pwm_ctrl(pwm_ch, ctrl, param);
 	}
 	break;
+	case ID_PWM_MOTOR_INIT:
+	{
+		uint32_t freq = va_arg(args, uint32_t);
+		uint32_t dead_ns = va_arg(args, uint32_t);
+		uint32_t flags = va_arg(args, uint32_t);
+		uint32_t *p_ccr = va_arg(args, uint32_t *);
+
+		result = motor_init(freq, dead_ns, flags, p_ccr);
+	}
+	break;
+	case ID_PWM_MOTOR_DEINIT:
+		result = motor_deinit();
+	break;
+	case ID_PWM_MOTOR_CTRL:
+	{
+		uint32_t ctrl = va_arg(args, uint32_t);
+		uint32_t param = va_arg(args, uint32_t);
+
+		result = motor_ctrl(ctrl, param);
+	}
+	break;
 	case ID_I2C_INIT:
 	{
 		//ll_invoke_inner!(INVOKE_ID_I2C_INIT, bus, CLK_HZ, flag_param);
@@ -359,15 +554,121 @@ int ll_invoke(enum INVOKE invoke_id, ...)
 	break;
 	case ID_DMA_DEINIT:
 	{
-		//TODO
+		uint32_t dma_ch = va_arg(args, uint32_t);
+
+		result = dma_deinit(dma_ch);
 	}
 	break;
 	case ID_DMA_CTRL:
 	{
 		uint32_t dma_ch = va_arg(args, uint32_t);
 		uint32_t work   = va_arg(args, uint32_t);
+		uint32_t param  = va_arg(args, uint32_t);
+
+		result = dma_ctrl(dma_ch, work, param);
+	}
+	break;
+	case ID_DMA_RELOAD:
+	{
+		uint32_t dma_ch   = va_arg(args, uint32_t);
+		uint32_t src_addr = va_arg(args, uint32_t);
+		uint32_t dst_addr = va_arg(args, uint32_t);
+		uint32_t count    = va_arg(args, uint32_t);
+
+		result = dma_reload(dma_ch, src_addr, dst_addr, count);
+	}
+	break;
+	case ID_DMA_REQUEST_CHANNELS:
+	{
+		uint32_t request = va_arg(args, uint32_t);
+
+		result = dma_request_channels(request);
+	}
+	break;
+	case ID_DMA_CHAIN_START:
+	{
+		uint32_t dma_ch     = va_arg(args, uint32_t);
+		uint32_t flags      = va_arg(args, uint32_t);
+		const DmaSeg *segs  = va_arg(args, const DmaSeg *);
+		uint32_t count      = va_arg(args, uint32_t);
+
+		result = dma_chain_start(dma_ch, flags, segs, count);
+	}
+	break;
+	case ID_TIM_CAPTURE_INIT:
+	{
+		uint32_t id      = va_arg(args, uint32_t);
+		uint32_t mode    = va_arg(args, uint32_t);
+		uint32_t tick_hz = va_arg(args, uint32_t);
+		uint32_t flags   = va_arg(args, uint32_t);
+		uint32_t dma_ch  = va_arg(args, uint32_t);
+		uint32_t *p_ccr  = va_arg(args, uint32_t *);
+
+		result = capture_init(id, mode, tick_hz, flags, dma_ch, p_ccr);
+	}
+	break;
+	case ID_TIM_CAPTURE_DEINIT:
+	{
+		uint32_t id = va_arg(args, uint32_t);
+
+		result = capture_deinit(id);
+	}
+	break;
+	case ID_TIM_CAPTURE_CTRL:
+	{
+		uint32_t id     = va_arg(args, uint32_t);
+		uint32_t ctrl   = va_arg(args, uint32_t);
+		uint16_t *p_out = va_arg(args, uint16_t *);
+
+		result = capture_ctrl(id, ctrl, p_out);
+	}
+	break;
+	case ID_TIM_ENCODER_INIT:
+	{
+		uint32_t id    = va_arg(args, uint32_t);
+		uint32_t flags = va_arg(args, uint32_t);
+
+		result = encoder_init(id, flags);
+	}
+	break;
+	case ID_TIM_ENCODER_DEINIT:
+	{
+		uint32_t id = va_arg(args, uint32_t);
+
+		result = encoder_deinit(id);
+	}
+	break;
+	case ID_TIM_ENCODER_CTRL:
+	{
+		uint32_t id     = va_arg(args, uint32_t);
+		uint32_t ctrl   = va_arg(args, uint32_t);
+		uint32_t *p_out = va_arg(args, uint32_t *);
+
+		result = encoder_ctrl(id, ctrl, p_out);
+	}
+	break;
+	case ID_TIM_HWTIMER_INIT:
+	{
+		uint32_t id      = va_arg(args, uint32_t);
+		uint32_t tick_hz = va_arg(args, uint32_t);
+
+		result = hwtimer_init(id, tick_hz);
+	}
+	break;
+	case ID_TIM_HWTIMER_DEINIT:
+	{
+		uint32_t id = va_arg(args, uint32_t);
+
+		result = hwtimer_deinit(id);
+	}
+	break;
+	case ID_TIM_HWTIMER_CTRL:
+	{
+		uint32_t id     = va_arg(args, uint32_t);
+		uint32_t ctrl   = va_arg(args, uint32_t);
+		uint32_t *p_out = va_arg(args, uint32_t *);
 
-		result = dma_ctrl(dma_ch, work);
+		result = hwtimer_ctrl(id, ctrl, p_out);
 	}
 	break;
 	default:
@@ -2,112 +2,444 @@
 #include <string.h>
 #include <stdbool.h>
 #include <stdarg.h>
+#include "wrapper.h"
 #include "print.h"
 
 #ifdef PRINT_LOG
-extern void ll_putc(char c);
+//provided by the chip ll_api.c
+extern void ll_putc(char c);//blocking, waits for the tx data register only
+extern void ll_log_tx_start(void);//enable tx empty irq, it drains via ll_log_pop()
+extern void ll_log_tx_wait_done(void);
+extern uint32_t ll_irq_save(void);
+extern void ll_irq_restore(uint32_t state);
 
-const char LOOKUP[16] = {0x30,0x31,0x32,0x33,0x34,0x35,0x36,0x37,0x38,0x39,0x41,0x42,0x43,0x44,0x45,0x46};
+#ifndef LOG_BUF_SIZE
+#define LOG_BUF_SIZE 1024 //power of 2
+#endif
+
+#ifndef LOG_LINE_SIZE
+#define LOG_LINE_SIZE 64 //ll_vprintf stack buffer, longer output is sent in chunks
+#endif
+
+static char log_buf[LOG_BUF_SIZE];
+static volatile uint32_t log_head;//free running, masked on access
+static volatile uint32_t log_tail;
+static volatile uint32_t log_policy = LOG_POLICY_DROP_NEW;
+static volatile uint32_t log_dropped;
 
-static void ll_ch2hex(char ch, char p_hex[2])
+void ll_log_write(const char *p, uint32_t len)
 {
-    p_hex[0] = LOOKUP[(ch >> 4) & 0x0F];
-    p_hex[1] = LOOKUP[ch & 0x0F];
+    while(len) {
+        uint32_t state = ll_irq_save();
+        uint32_t space = LOG_BUF_SIZE - (log_head - log_tail);
+
+        if(space < len) {
+            if(log_policy == LOG_POLICY_DROP_OLD) {
+                if(len > LOG_BUF_SIZE) {//only the tail of the message fits
+                    log_dropped += len - LOG_BUF_SIZE;
+                    p += len - LOG_BUF_SIZE;
+                    len = LOG_BUF_SIZE;
+                }
+                log_dropped += len - space;
+                log_tail += len - space;
+                space = len;
+            } else if(log_policy == LOG_POLICY_BLOCK) {
+                if(space == 0) {//make room by sending the oldest char from here
+                    ll_putc(log_buf[log_tail++ & (LOG_BUF_SIZE - 1)]);
+                    ll_irq_restore(state);
+                    continue;
+                }
+            } else {//LOG_POLICY_DROP_NEW: the whole message or nothing, no half lines
+                log_dropped += len;
+                ll_irq_restore(state);
+                break;
+            }
+        }
+
+        uint32_t n = (len < space) ? len : space;
+        len -= n;
+        while(n--) {
+            log_buf[log_head++ & (LOG_BUF_SIZE - 1)] = *p++;
+        }
+        ll_irq_restore(state);
+    }
+
+    ll_log_tx_start();
 }
 
-static void ll_puts(char *s)
+//a binary frame is queued whole or not at all, a torn frame would desync the host decoder.
+//LOG_POLICY_DROP_OLD may still cut the oldest queued frame, the decoder resyncs after it
+int ll_log_write_frame(const char *p, uint32_t len)
 {
-    char c;
-    while((c = *s++)) {
-        ll_putc(c);
+    uint32_t state, space;
+
+    for(;;) {
+        state = ll_irq_save();
+        space = LOG_BUF_SIZE - (log_head - log_tail);
+
+        if(space < len && len <= LOG_BUF_SIZE) {
+            if(log_policy == LOG_POLICY_DROP_OLD) {
+                log_dropped += len - space;
+                log_tail += len - space;
+                space = len;
+            } else if(log_policy == LOG_POLICY_BLOCK) {//make room by sending the oldest char from here
+                ll_putc(log_buf[log_tail++ & (LOG_BUF_SIZE - 1)]);
+                ll_irq_restore(state);
+                continue;
+            }
+        }
+        break;
     }
+
+    if(space < len) {
+        log_dropped += len;
+        ll_irq_restore(state);
+        return -1;
+    }
+    while(len--) {
+        log_buf[log_head++ & (LOG_BUF_SIZE - 1)] = *p++;
+    }
+    ll_irq_restore(state);
+    ll_log_tx_start();
+
+    return 0;
 }
 
-static int ll_itoa(int32_t value, int32_t radix, char *p_buf, int32_t size)
+int ll_log_pop(void)
 {
-	int32_t index = size;
-	bool neg = false;
-	if ((value < 0) && (radix == 10)) {
-		neg = true;
-		value = -value;
-	}
+    int c = -1;
+    uint32_t state = ll_irq_save();
 
-	p_buf[--index]='\0';
-	while(1) {
-		int32_t rem = value % radix;
-		value /= radix;
-		p_buf[--index] = LOOKUP[rem];
-		if((value == 0) || (index == 0)) {
-			break;
-		}
-	}
-	if(neg && (index > 0)) {
-		p_buf[--index] = '-';
-	}
+    if(log_head != log_tail) {
+        c = (uint8_t)log_buf[log_tail++ & (LOG_BUF_SIZE - 1)];
+    }
+    ll_irq_restore(state);
 
-	return index;
+    return c;
 }
 
-void ll_vprintf(const char *fmt, va_list va)
+void ll_log_flush(void)
+{
+    int c;
+    uint32_t state = ll_irq_save();
+
+    while((c = ll_log_pop()) >= 0) {
+        ll_putc((char)c);
+    }
+    ll_log_tx_wait_done();
+    ll_irq_restore(state);
+}
+
+int ll_log_ctrl(uint32_t ctrl, uint32_t param)
+{
+    switch(ctrl) {
+    case LOG_CTRL_FLUSH:
+        ll_log_flush();
+        return 0;
+    case LOG_CTRL_SET_POLICY:
+        if(param > LOG_POLICY_BLOCK) {
+            return -1;
+        }
+        log_policy = param;
+        return 0;
+    case LOG_CTRL_GET_DROPPED:
+        return (int)log_dropped;
+    default:
+        return -1;
+    }
+}
+
+static const char HEX_UPPER[16] = "0123456789ABCDEF";
+static const char HEX_LOWER[16] = "0123456789abcdef";
+static const char DEC_PAIRS[200] =
+    "00010203040506070809" "10111213141516171819" "20212223242526272829" "30313233343536373839"
+    "40414243444546474849" "50515253545556575859" "60616263646566676869" "70717273747576777879"
+    "80818283848586878889" "90919293949596979899";
+
+typedef struct {
+    char *buf;
+    uint32_t size;  //usable chars in buf
+    uint32_t len;   //chars in buf
+    uint32_t total; //chars produced, including the truncated ones
+    bool to_log;    //send a full buf to the log instead of truncating
+} fmt_out_t;
+
+typedef struct {
+    int32_t width;
+    int32_t prec;   //-1: not given
+    bool left;
+    bool zero;
+    uint8_t longs;  //count of 'l'
+} fmt_spec_t;
+
+static void out_write(fmt_out_t *o, const char *p, uint32_t n)
+{
+    o->total += n;
+    while(n) {
+        if(o->len == o->size) {
+            if(!o->to_log || o->size == 0) {
+                return;
+            }
+            ll_log_write(o->buf, o->len);
+            o->len = 0;
+        }
+        uint32_t room = o->size - o->len;
+        uint32_t cnt = (n < room) ? n : room;
+        memcpy(&o->buf[o->len], p, cnt);
+        o->len += cnt;
+        p += cnt;
+        n -= cnt;
+    }
+}
+
+static void out_fill(fmt_out_t *o, char c, int32_t n)
+{
+    while(n-- > 0) {
+        out_write(o, &c, 1);
+    }
+}
+
+//x / 100 without a divide: 32-bit multiply below 43699, 32x32->64 reciprocal above
+static inline uint32_t div100(uint32_t x)
+{
+    if(x < 43699) {
+        return (x * 5243) >> 19;
+    }
+    return (uint32_t)(((uint64_t)x * 0x51EB851Fu) >> 37);
+}
+
+//writes the decimal digits of x backwards, ending at p, returns the first digit
+static char *u32_to_dec(uint32_t x, char *p)
+{
+    while(x >= 100) {
+        uint32_t q = div100(x);
+        const char *d = &DEC_PAIRS[(x - q * 100) * 2];
+        *--p = d[1];
+        *--p = d[0];
+        x = q;
+    }
+    if(x >= 10) {
+        *--p = DEC_PAIRS[x * 2 + 1];
+        *--p = DEC_PAIRS[x * 2];
+    } else {
+        *--p = (char)('0' + x);
+    }
+    return p;
+}
+
+//*v /= 1000000000 by shift and subtract, returns the remainder, only for values above 32 bits
+static uint32_t u64_divmod_1e9(uint64_t *v)
+{
+    const uint64_t d = 1000000000u;
+    uint64_t n = *v, q = 0, r = 0;
+
+    for(int32_t i = 63; i >= 0; i--) {
+        r = (r << 1) | ((n >> i) & 1);
+        if(r >= d) {
+            r -= d;
+            q |= (uint64_t)1 << i;
+        }
+    }
+    *v = q;
+    return (uint32_t)r;
+}
+
+static char *u64_to_dec(uint64_t x, char *p)
+{
+    while(x >> 32) {
+        char *end = p;
+        p = u32_to_dec(u64_divmod_1e9(&x), p);
+        while(end - p < 9) {
+            *--p = '0';
+        }
+    }
+    return u32_to_dec((uint32_t)x, p);
+}
+
+static char *u64_to_hex(uint64_t x, char *p, bool upper)
+{
+    const char *digits = upper ? HEX_UPPER : HEX_LOWER;
+    do {
+        *--p = digits[x & 0x0F];
+        x >>= 4;
+    } while(x);
+    return p;
+}
+
+static void out_padded(fmt_out_t *o, const fmt_spec_t *sp, const char *sign, const char *p, uint32_t n)
+{
+    uint32_t sign_len = strlen(sign);
+    int32_t pad = sp->width - (int32_t)(sign_len + n);
+
+    if(sp->left) {
+        out_write(o, sign, sign_len);
+        out_write(o, p, n);
+        out_fill(o, ' ', pad);
+    } else if(sp->zero) {
+        out_write(o, sign, sign_len);
+        out_fill(o, '0', pad);
+        out_write(o, p, n);
+    } else {
+        out_fill(o, ' ', pad);
+        out_write(o, sign, sign_len);
+        out_write(o, p, n);
+    }
+}
+
+//'q': value scaled by 10^prec, "%.2q" of 12345 prints 123.45
+static void out_number(fmt_out_t *o, const fmt_spec_t *sp, char conv, uint64_t value, bool neg)
+{
+    char tmp[24 + 2];
+    char *end = &tmp[sizeof(tmp)];
+    char *p;
+
+    if(conv == 'x' || conv == 'X') {
+        p = u64_to_hex(value, end, conv == 'X');
+    } else {
+        p = u64_to_dec(value, end);
+    }
+
+    if(conv == 'q' && sp->prec > 0) {
+        int32_t prec = (sp->prec < 20) ? sp->prec : 20;
+        while(end - p <= prec) {
+            *--p = '0';
+        }
+        char *dot = end - prec;
+        memmove(p - 1, p, dot - p);
+        p--;
+        dot[-1] = '.';
+    }
+
+    out_padded(o, sp, neg ? "-" : "", p, end - p);
+}
+
+static void ll_vformat(fmt_out_t *o, const char *fmt, va_list va)
 {
-    char str[12 + 4];
     char ch;
-    int32_t idx;
 
     while ((ch = *(fmt++))) {
         if (ch != '%') {
-            ll_putc(ch);
+            const char *start = fmt - 1;
+            while (*fmt && *fmt != '%') {
+                fmt++;
+            }
+            out_write(o, start, fmt - start);
             continue;
         }
 
-        char *ptr;
-        ch = *(fmt++);
-
-        while (ch >= '0' && ch <= '9') {
-            ch = *(fmt++);
+        fmt_spec_t sp = { .width = 0, .prec = -1, .left = false, .zero = false, .longs = 0 };
+        for(;; fmt++) {
+            if(*fmt == '-') {
+                sp.left = true;
+            } else if(*fmt == '0') {
+                sp.zero = true;
+            } else {
+                break;
+            }
+        }
+        while (*fmt >= '0' && *fmt <= '9') {
+            sp.width = sp.width * 10 + (*fmt++ - '0');
+        }
+        if (*fmt == '.') {
+            fmt++;
+            sp.prec = 0;
+            while (*fmt >= '0' && *fmt <= '9') {
+                sp.prec = sp.prec * 10 + (*fmt++ - '0');
+            }
+        }
+        while (*fmt == 'l') {
+            sp.longs++;
+            fmt++;
         }
 
+        const char *ptr;
+        uint32_t len;
+        ch = *(fmt++);
         switch (ch)
         {
         case '\0':
             return;
         case 'c':
-            ll_putc((char)(va_arg(va, int32_t)));
+        {
+            char c = (char)va_arg(va, int32_t);
+            out_padded(o, &sp, "", &c, 1);
+        }
         break;
         case 'd':
-            idx = ll_itoa((int32_t)va_arg(va, int32_t), 10, str, sizeof(str));
-            ll_puts(&str[idx]);
-            break;
+        case 'q':
+        {
+            int64_t val = (sp.longs >= 2) ? va_arg(va, int64_t) : (int64_t)va_arg(va, int32_t);
+            bool neg = val < 0;
+            out_number(o, &sp, ch, neg ? (uint64_t)0 - (uint64_t)val : (uint64_t)val, neg);
+        }
+        break;
+        case 'u':
         case 'x':
         case 'X':
-            idx = ll_itoa((uint32_t)va_arg(va, uint32_t), 16, str, sizeof(str));
-            ll_puts(&str[idx]);
-            break;
+        {
+            uint64_t val = (sp.longs >= 2) ? va_arg(va, uint64_t) : (uint64_t)va_arg(va, uint32_t);
+            out_number(o, &sp, ch, val, false);
+        }
+        break;
         case 's':
-            ptr = va_arg(va, char *);
-            ll_puts(ptr);
+            ptr = va_arg(va, const char *);
+            out_padded(o, &sp, "", ptr, strlen(ptr));
             break;
-		 case 'S':
-            ptr = va_arg(va, char *);
-            idx = (int32_t)va_arg(va, int32_t);
-			while(idx--) {
-				ll_putc(*ptr++);
-			}
+        case 'S':
+            ptr = va_arg(va, const char *);
+            len = va_arg(va, uint32_t);
+            out_padded(o, &sp, "", ptr, len);
             break;
         case 'y':
-            ptr = va_arg(va, char *);
-            idx = (int32_t)va_arg(va, int32_t);
-            str[2] = ' ';
-            str[3] = '\0';
-            while (idx--) {
-                ll_ch2hex(*ptr++, str);
-                ll_puts(str);
+        case 'Y':
+        {
+            char hex[3] = { 0, 0, ' ' };
+            ptr = va_arg(va, const char *);
+            len = va_arg(va, uint32_t);
+            while (len--) {
+                hex[0] = HEX_UPPER[(*ptr >> 4) & 0x0F];
+                hex[1] = HEX_UPPER[*ptr++ & 0x0F];
+                out_write(o, hex, 3);
             }
-            break;
+        }
+        break;
         default:
-            ll_putc(ch);
+            out_write(o, &ch, 1);
             break;
         }
     }
 }
+
+int ll_vsnprintf(char *buf, uint32_t size, const char *fmt, va_list va)
+{
+    fmt_out_t o = { .buf = buf, .size = size ? size - 1 : 0, .len = 0, .total = 0, .to_log = false };
+
+    ll_vformat(&o, fmt, va);
+    if(size) {
+        buf[o.len] = '\0';
+    }
+
+    return (int)o.total;
+}
+
+int ll_snprintf(char *buf, uint32_t size, const char *fmt, ...)
+{
+    va_list va;
+    va_start(va, fmt);
+    int n = ll_vsnprintf(buf, size, fmt, va);
+    va_end(va);
+
+    return n;
+}
+
+void ll_vprintf(const char *fmt, va_list va)
+{
+    char buf[LOG_LINE_SIZE];
+    fmt_out_t o = { .buf = buf, .size = sizeof(buf), .len = 0, .total = 0, .to_log = true };
+
+    ll_vformat(&o, fmt, va);
+    if(o.len) {
+        ll_log_write(buf, o.len);
+    }
+}
 #endif
@@ -6,54 +6,216 @@
 #include <stdarg.h>
 #include "ch32v20x.h"
 #include "pwm.h"
+#include "timer.h"
 #include "wrapper.h"
 
-static void pwm_enable(uint32_t ch, bool en)
+//default period of the tick rate mode, in ticks
+#define PWM_TICK_PERIOD    1000
+
+struct PwmInfo {
+	TIM_TypeDef *tim;
+	uint8_t oc; //output compare 1..4
+};
+
+//channels of one timer share its period, the timer is claimed by the first channel and released
+//by the last one, see tim_claim()
+static const struct PwmInfo PWM_list[PWM_CH_MAX] = {
+	[PWM_CH0] = {TIM1, 1}, //PA8
+	[PWM_CH1] = {TIM1, 4}, //PA11
+	[PWM_CH2] = {TIM2, 1}, //PA0
+	[PWM_CH3] = {TIM2, 2}, //PA1
+	[PWM_CH4] = {TIM3, 1}, //PA6
+	[PWM_CH5] = {TIM3, 2}, //PA7
+	[PWM_CH6] = {TIM4, 1}, //PB6
+	[PWM_CH7] = {TIM4, 2}, //PB7
+};
+
+static uint8_t pwm_used; //bit per channel
+static bool motor_used; //TIM1 runs the motor PWM, CH0 and CH1 are not available
+
+//bits of the channels sharing the timer of ch, ch included
+static uint8_t pwm_tim_mask(uint32_t ch)
+{
+	uint8_t mask = 0;
+
+	for(uint32_t idx = 0; idx < PWM_CH_MAX; idx++) {
+		if(PWM_list[idx].tim == PWM_list[ch].tim) {
+			mask |= 1 << idx;
+		}
+	}
+
+	return mask;
+}
+
+static volatile uint16_t *pwm_ccr(const struct PwmInfo *info)
+{
+	switch (info->oc)
+	{
+	case 1:
+		return &info->tim->CH1CVR;
+	case 2:
+		return &info->tim->CH2CVR;
+	case 3:
+		return &info->tim->CH3CVR;
+	default:
+		return &info->tim->CH4CVR;
+	}
+}
+
+static void pwm_oc_init(const struct PwmInfo *info)
 {
 	TIM_OCInitTypeDef TIM_OCInitStructure={0};
 
 	TIM_OCInitStructure.TIM_OCMode = TIM_OCMode_PWM1;
-	TIM_OCInitStructure.TIM_OutputState = en ? TIM_OutputState_Enable : TIM_OutputState_Disable;
+	TIM_OCInitStructure.TIM_OutputState = TIM_OutputState_Disable;
 	TIM_OCInitStructure.TIM_Pulse = 0;
 	TIM_OCInitStructure.TIM_OCPolarity = TIM_OCPolarity_High;
-	if(ch == 0) {
-		TIM_OC1Init( TIM1, &TIM_OCInitStructure );
+
+	//preload: duty and period changes take effect at the next update, no glitches
+	switch (info->oc)
+	{
+	case 1:
+		TIM_OC1Init(info->tim, &TIM_OCInitStructure);
+		TIM_OC1PreloadConfig(info->tim, TIM_OCPreload_Enable);
+	break;
+	case 2:
+		TIM_OC2Init(info->tim, &TIM_OCInitStructure);
+		TIM_OC2PreloadConfig(info->tim, TIM_OCPreload_Enable);
+	break;
+	case 3:
+		TIM_OC3Init(info->tim, &TIM_OCInitStructure);
+		TIM_OC3PreloadConfig(info->tim, TIM_OCPreload_Enable);
+	break;
+	default:
+		TIM_OC4Init(info->tim, &TIM_OCInitStructure);
+		TIM_OC4PreloadConfig(info->tim, TIM_OCPreload_Enable);
+	break;
+	}
+}
+
+static void pwm_enable(const struct PwmInfo *info, bool en)
+{
+	uint16_t shift = (info->oc - 1) * 4;
+
+	TIM_CCxCmd(info->tim, shift, en ? TIM_CCx_Enable : TIM_CCx_Disable);
+}
+
+//update DMA request of the timer, the DMA writes the compare register once per period
+static int pwm_dma_request(TIM_TypeDef *tim)
+{
+	if(tim == TIM1) {
+		return DMA_REQ_TIM1_UP;
+	} else if(tim == TIM2) {
+		return DMA_REQ_TIM2_UP;
+	} else if(tim == TIM3) {
+		return DMA_REQ_TIM3_UP;
+	} else {
+		return DMA_REQ_TIM4_UP;
+	}
+}
+
+static void pwm_polarity(const struct PwmInfo *info, bool active_low)
+{
+	uint16_t ccp = TIM_CC1P << ((info->oc - 1) * 4);
+
+	if(active_low) {
+		info->tim->CCER |= ccp;
+	} else {
+		info->tim->CCER &= ~ccp;
 	}
 }
 
+//ch was set up by pwm_init() and its timer is not taken by the motor PWM
+static bool pwm_owned(uint32_t ch)
+{
+	if((pwm_used & (1 << ch)) == 0) {
+		return false;
+	}
+
+	return !(motor_used && PWM_list[ch].tim == TIM1);
+}
+
 int pwm_deinit(uint32_t ch)
 {
-	if(ch == 0) {
-		pwm_enable(ch, false);
+	if(ch >= PWM_CH_MAX) {
+		return -1;
+	}
+	const struct PwmInfo *info = &PWM_list[ch];
+
+	if(!pwm_owned(ch)) {
+		return -3;
+	}
+	pwm_enable(info, false);
+	pwm_used &= ~(1 << ch);
+	if((pwm_used & pwm_tim_mask(ch)) == 0) {
+		TIM_Cmd(info->tim, DISABLE);
+		tim_release(tim_id(info->tim), TIM_OWNER_PWM);
 	}
-	TIM_Cmd( TIM1, DISABLE );
 	return 0;
 }
 
-int pwm_init(uint32_t ch, uint32_t freq)
+/**
+ * flags 0: freq is the counter tick rate, the period is PWM_TICK_PERIOD ticks
+ * PWM_INIT_OUTPUT_FREQ: freq is the output frequency, the period is as long as the timer allows
+ * a timer already running for another channel must get the same time base, else -3
+ * a timer run by another driver (motor, capture, encoder, hwtimer, ADC trigger) also returns -3
+ */
+int pwm_init(uint32_t ch, uint32_t freq, uint32_t flags, uint32_t *p_ccr)
 {
-	(void)ch;
+	if(ch >= PWM_CH_MAX) {
+		return -1;
+	}
 	if(freq == 0) {
 		return -1;
 	}
 
+	const struct PwmInfo *info = &PWM_list[ch];
 	TIM_TimeBaseInitTypeDef TIM_TimeBaseInitStructure={0};
-	uint32_t prescaler = SystemCoreClock/freq - 1;
+	uint32_t tim_clk = tim_clock_hz(info->tim);
+	uint16_t psc, arr;
 
-	TIM_TimeBaseInitStructure.TIM_Period = 1000;
-	TIM_TimeBaseInitStructure.TIM_Prescaler = prescaler;
-	TIM_TimeBaseInitStructure.TIM_ClockDivision = TIM_CKD_DIV1;
-	TIM_TimeBaseInitStructure.TIM_CounterMode = TIM_CounterMode_Up;
-	TIM_TimeBaseInit( TIM1, &TIM_TimeBaseInitStructure);
+	if(flags & PWM_INIT_OUTPUT_FREQ) {
+		int result = tim_calc_base(tim_clk, freq, &psc, &arr);
+		if(result != 0) {
+			return result;
+		}
+	} else {
+		uint32_t prescaler = (tim_clk + freq / 2) / freq;
+		if(prescaler == 0 || prescaler > 0x10000) {
+			return -2;
+		}
+		psc = prescaler - 1;
+		arr = PWM_TICK_PERIOD - 1;
+	}
+
+	if(tim_claim(tim_id(info->tim), TIM_OWNER_PWM) != 0) {
+		return -3;
+	}
+	if(pwm_used & pwm_tim_mask(ch) & ~(1 << ch)) {
+		if(info->tim->PSC != psc || info->tim->ATRLR != arr) {
+			return -3;
+		}
+	} else {
+		tim_clock_enable(info->tim);
+		TIM_Cmd(info->tim, DISABLE);
+		TIM_TimeBaseInitStructure.TIM_Period = arr;
+		TIM_TimeBaseInitStructure.TIM_Prescaler = psc;
+		TIM_TimeBaseInitStructure.TIM_ClockDivision = TIM_CKD_DIV1;
+		TIM_TimeBaseInitStructure.TIM_CounterMode = TIM_CounterMode_Up;
+		TIM_TimeBaseInit(info->tim, &TIM_TimeBaseInitStructure);
+		TIM_ARRPreloadConfig(info->tim, ENABLE);
+	}
 
-	pwm_enable(ch, false);
+	pwm_oc_init(info);
+	if(info->tim == TIM1) {
+		TIM_CtrlPWMOutputs(TIM1, ENABLE);
+	}
+	TIM_Cmd(info->tim, ENABLE);
+	pwm_used |= 1 << ch;
 
-	TIM_CtrlPWMOutputs(TIM1, ENABLE );
-	if(ch == 0) {
-		TIM_OC1PreloadConfig( TIM1, TIM_OCPreload_Disable );
+	if(p_ccr) {
+		*p_ccr = (uint32_t)pwm_ccr(info);
 	}
-	TIM_ARRPreloadConfig( TIM1, ENABLE );
-	TIM_Cmd( TIM1, ENABLE );
 
 	return 0;
 }
@@ -61,54 +223,277 @@ int pwm_init(uint32_t ch, uint32_t freq)
 
 int pwm_ctrl(uint32_t ch, uint32_t ctrl, uint32_t param)
 {
+	if(ch >= PWM_CH_MAX) {
+		return -1;
+	}
+	const struct PwmInfo *info = &PWM_list[ch];
+
+	if(!pwm_owned(ch)) {
+		return -3;
+	}
+
 	switch (ctrl)
 	{
 	case PWM_CTRL_ON:
-		pwm_enable(ch, true);
+		pwm_enable(info, true);
 	break;
 	case PWM_CTRL_OFF:
-		pwm_enable(ch, false);
+		pwm_enable(info, false);
 	break;
 	case PWM_CTRL_SET_DUTY:
-	{
-		if(ch == 0) {
-			TIM_SetCompare1(TIM1, param);
-		}
-	}
+		*pwm_ccr(info) = param;
 	break;
 	case PWM_CTRL_GET_DUTY:
+		return *pwm_ccr(info);
+	case PWM_CTRL_SET_PERIOD://param: unit:tick, shared by the channels of the timer
 	{
-		if(ch == 0) {
-			return TIM_GetCapture1(TIM1);
+		if(param < 2 || param > 0x10000) {
+			return -2;
 		}
-	}
-	break;
-	case PWM_CTRL_SET_PERIOD://param: unit:tick
-	{
-		TIM1->ATRLR = param - 1;
+		info->tim->ATRLR = param - 1;
 	}
 	break;
 	case PWM_CTRL_GET_PERIOD:
 	{
-		uint32_t arr = TIM1->ATRLR + 1;
+		uint32_t arr = info->tim->ATRLR + 1;
 
 		return arr;
 	}
 	break;
 	case PWM_CTRL_GET_MAXDUTY:
 	{
-		return TIM1->ATRLR + 1;
+		return info->tim->ATRLR + 1;
 	}
 	break;
+	case PWM_CTRL_DMA_ON:
+		TIM_DMACmd(info->tim, TIM_DMA_Update, ENABLE);
+	break;
+	case PWM_CTRL_DMA_OFF:
+		TIM_DMACmd(info->tim, TIM_DMA_Update, DISABLE);
+	break;
+	case PWM_CTRL_GET_DMA_REQ:
+		return pwm_dma_request(info->tim);
 	case PWM_CTRL_ACTIVE_HIGH:
-		TIM_OC1PolarityConfig(TIM1, TIM_OCPolarity_High);
+		pwm_polarity(info, false);
 	break;
 	case PWM_CTRL_ACTIVE_LOW:
-		TIM_OC1PolarityConfig(TIM1, TIM_OCPolarity_Low);
+		pwm_polarity(info, true);
 	break;
 	default:
 	break;
 	}
 
 	return 0;
-}
\ No newline at end of file
+}
+
+extern void PWM_MOTOR_hook_rs(uint32_t events);
+
+//the update irq marks the period boundary (counter at 0), the break irq is one-shot until the
+//outputs are enabled again
+static void motor_irq(uint32_t id, TIM_TypeDef *tim)
+{
+	(void)id;
+	uint32_t events = 0;
+
+	if((tim->DMAINTENR & TIM_IT_Break) && (tim->INTFR & TIM_FLAG_Break)) {
+		tim->DMAINTENR &= ~TIM_IT_Break; //the flag is set again while the input is active
+		events |= MOTOR_EVENT_BREAK;
+	}
+	if(tim->INTFR & TIM_FLAG_Update) {
+		tim->INTFR = (uint16_t)~TIM_FLAG_Update;
+		events |= MOTOR_EVENT_UPDATE;
+	}
+	if(events) {
+		PWM_MOTOR_hook_rs(events);
+	}
+}
+
+//sets the output polarities and the idle levels to the inactive level, outputs must be off
+static void motor_polarity(uint32_t polarity)
+{
+	uint16_t ccer = TIM1->CCER & ~(TIM_CC1P | TIM_CC1NP | TIM_CC2P | TIM_CC2NP | TIM_CC3P | TIM_CC3NP);
+	uint16_t ois = TIM1->CTLR2 & ~(TIM_OIS1 | TIM_OIS1N | TIM_OIS2 | TIM_OIS2N | TIM_OIS3 | TIM_OIS3N);
+
+	for(uint32_t oc = 0; oc < 3; oc++) {
+		if(polarity & MOTOR_POLARITY_HIGH_LOW) {
+			ccer |= TIM_CC1P << (oc * 4);
+			ois |= TIM_OIS1 << (oc * 2);
+		}
+		if(polarity & MOTOR_POLARITY_LOW_LOW) {
+			ccer |= TIM_CC1NP << (oc * 4);
+			ois |= TIM_OIS1N << (oc * 2);
+		}
+	}
+	TIM1->CCER = ccer;
+	TIM1->CTLR2 = ois;
+}
+
+/**
+ * Center-aligned PWM on TIM1 for three half bridges: OC1..3 (PA8, PA9, PA10) drive the high
+ * sides, OC1N..3N (PB13, PB14, PB15) the low sides with dead_ns between them, BKIN (PB12) is the
+ * break input. The outputs stay off until MOTOR_CTRL_ENABLE. OC4 sets TRGO for the ADC at the
+ * counter top, the center of the period. p_ccr receives the address of CH1CVR, CH2CVR and
+ * CH3CVR follow at 4 byte steps, duty 0..ARR
+ */
+int motor_init(uint32_t freq, uint32_t dead_ns, uint32_t flags, uint32_t *p_ccr)
+{
+	TIM_TimeBaseInitTypeDef TIM_TimeBaseInitStructure = {0};
+	TIM_OCInitTypeDef TIM_OCInitStructure = {0};
+	TIM_BDTRInitTypeDef TIM_BDTRInitStructure = {0};
+	uint32_t tim_clk = tim_clock_hz(TIM1);
+	uint16_t psc, arr;
+	uint8_t dtg;
+	int result;
+
+	if(motor_used) {
+		return -3;
+	}
+	if(freq == 0 || freq > tim_clk / 4) {
+		return -1;
+	}
+	//counting up and down, a period is two counter periods of arr + 1 ticks
+	result = tim_calc_base(tim_clk, freq * 2, &psc, &arr);
+	if(result != 0) {
+		return result;
+	}
+	//dead-time clock is the timer clock, CKD_DIV1
+	if(tim_calc_dead_time(tim_clk, dead_ns, &dtg) != 0) {
+		return -4;
+	}
+	//PWM channels or another driver on TIM1
+	if(tim_claim(TIM_ID_1, TIM_OWNER_MOTOR) != 0) {
+		return -3;
+	}
+
+	tim_clock_enable(TIM1);
+	TIM_DeInit(TIM1);
+	TIM_TimeBaseInitStructure.TIM_Period = arr + 1;
+	TIM_TimeBaseInitStructure.TIM_Prescaler = psc;
+	TIM_TimeBaseInitStructure.TIM_ClockDivision = TIM_CKD_DIV1;
+	TIM_TimeBaseInitStructure.TIM_CounterMode = TIM_CounterMode_CenterAligned1;
+	//one update per period, at the underflow
+	TIM_TimeBaseInitStructure.TIM_RepetitionCounter = 1;
+	TIM_TimeBaseInit(TIM1, &TIM_TimeBaseInitStructure);
+	TIM_ARRPreloadConfig(TIM1, ENABLE);
+
+	TIM_OCInitStructure.TIM_OCMode = TIM_OCMode_PWM1;
+	TIM_OCInitStructure.TIM_OutputState = TIM_OutputState_Enable;
+	TIM_OCInitStructure.TIM_OutputNState = TIM_OutputNState_Enable;
+	TIM_OCInitStructure.TIM_Pulse = 0;
+	TIM_OCInitStructure.TIM_OCPolarity = TIM_OCPolarity_High;
+	TIM_OCInitStructure.TIM_OCNPolarity = TIM_OCNPolarity_High;
+	TIM_OCInitStructure.TIM_OCIdleState = TIM_OCIdleState_Reset;
+	TIM_OCInitStructure.TIM_OCNIdleState = TIM_OCNIdleState_Reset;
+	TIM_OC1Init(TIM1, &TIM_OCInitStructure);
+	TIM_OC2Init(TIM1, &TIM_OCInitStructure);
+	TIM_OC3Init(TIM1, &TIM_OCInitStructure);
+	TIM_OC1PreloadConfig(TIM1, TIM_OCPreload_Enable);
+	TIM_OC2PreloadConfig(TIM1, TIM_OCPreload_Enable);
+	TIM_OC3PreloadConfig(TIM1, TIM_OCPreload_Enable);
+
+	//OC4REF rises when the counter passes CCR4 counting down, no output
+	TIM_OCInitStructure.TIM_OutputState = TIM_OutputState_Disable;
+	TIM_OCInitStructure.TIM_OutputNState = TIM_OutputNState_Disable;
+	TIM_OCInitStructure.TIM_Pulse = arr + 1;
+	TIM_OC4Init(TIM1, &TIM_OCInitStructure);
+	TIM_OC4PreloadConfig(TIM1, TIM_OCPreload_Enable);
+	TIM_SelectOutputTrigger(TIM1, TIM_TRGOSource_OC4Ref);
+
+	//outputs go to the idle level on a break and stay off until enabled again
+	TIM_BDTRInitStructure.TIM_OSSRState = TIM_OSSRState_Enable;
+	TIM_BDTRInitStructure.TIM_OSSIState = TIM_OSSIState_Enable;
+	TIM_BDTRInitStructure.TIM_LOCKLevel = TIM_LOCKLevel_OFF;
+	TIM_BDTRInitStructure.TIM_DeadTime = dtg;
+	TIM_BDTRInitStructure.TIM_Break = (flags & MOTOR_BREAK_ENABLE) ? TIM_Break_Enable : TIM_Break_Disable;
+	TIM_BDTRInitStructure.TIM_BreakPolarity = (flags & MOTOR_BREAK_ACTIVE_HIGH) ? TIM_BreakPolarity_High : TIM_BreakPolarity_Low;
+	TIM_BDTRInitStructure.TIM_AutomaticOutput = TIM_AutomaticOutput_Disable;
+	TIM_BDTRConfig(TIM1, &TIM_BDTRInitStructure);
+
+	TIM1->INTFR = 0;
+	tim_irq_attach(TIM_ID_1, motor_irq);
+	TIM_Cmd(TIM1, ENABLE);
+	motor_used = true;
+
+	if(p_ccr) {
+		*p_ccr = (uint32_t)&TIM1->CH1CVR;
+	}
+
+	return 0;
+}
+
+int motor_deinit(void)
+{
+	if(!motor_used) {
+		return -1;
+	}
+	TIM_CtrlPWMOutputs(TIM1, DISABLE);
+	tim_irq_attach(TIM_ID_1, NULL);
+	TIM_Cmd(TIM1, DISABLE);
+	TIM_DeInit(TIM1);
+	motor_used = false;
+	tim_release(TIM_ID_1, TIM_OWNER_MOTOR);
+
+	return 0;
+}
+
+int motor_ctrl(uint32_t ctrl, uint32_t param)
+{
+	if(!motor_used) {
+		return -1;
+	}
+
+	switch (ctrl)
+	{
+	case MOTOR_CTRL_ENABLE:
+		TIM_ClearFlag(TIM1, TIM_FLAG_Break);
+		TIM_CtrlPWMOutputs(TIM1, ENABLE);
+		if((TIM1->BDTR & TIM_MOE) == 0) {
+			return -6;//the break input is still active
+		}
+		if(TIM1->BDTR & TIM_BKE) {
+			TIM_ITConfig(TIM1, TIM_IT_Break, ENABLE);
+		}
+	break;
+	case MOTOR_CTRL_DISABLE:
+		TIM_CtrlPWMOutputs(TIM1, DISABLE);
+	break;
+	case MOTOR_CTRL_GET_STATUS:
+	{
+		int status = 0;
+
+		if(TIM1->BDTR & TIM_MOE) {
+			status |= MOTOR_STATUS_ENABLED;
+		}
+		if(TIM1->INTFR & TIM_FLAG_Break) {
+			status |= MOTOR_STATUS_BREAK;
+		}
+		return status;
+	}
+	case MOTOR_CTRL_UPDATE_IRQ:
+		TIM_ClearFlag(TIM1, TIM_FLAG_Update);
+		TIM_ITConfig(TIM1, TIM_IT_Update, param ? ENABLE : DISABLE);
+	break;
+	case MOTOR_CTRL_SAMPLE_DELAY://param: ticks after the center
+	{
+		uint32_t top = TIM1->ATRLR;
+
+		if(param >= top) {
+			return -2;
+		}
+		TIM1->CH4CVR = top - param;
+	}
+	break;
+	case MOTOR_CTRL_POLARITY:
+		if(TIM1->BDTR & TIM_MOE) {
+			return -3;
+		}
+		motor_polarity(param);
+	break;
+	case MOTOR_CTRL_GET_MAX_DUTY:
+		return TIM1->ATRLR;
+	default:
+		return -2;
+	}
+
+	return 0;
+}
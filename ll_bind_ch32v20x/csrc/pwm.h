@@ -3,7 +3,10 @@
 
 
 int pwm_ctrl(uint32_t ch, uint32_t ctrl, uint32_t param);
-int pwm_init(uint32_t ch, uint32_t freq);
+int pwm_init(uint32_t ch, uint32_t freq, uint32_t flags, uint32_t *p_ccr);
 int pwm_deinit(uint32_t ch);
+int motor_init(uint32_t freq, uint32_t dead_ns, uint32_t flags, uint32_t *p_ccr);
+int motor_deinit(void);
+int motor_ctrl(uint32_t ctrl, uint32_t param);
 
 #endif //__PWM_H__
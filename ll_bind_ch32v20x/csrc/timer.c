@@ -0,0 +1,217 @@
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include "ch32v20x.h"
+#include "timer.h"
+#include "wrapper.h"
+
+static TIM_TypeDef *const TIM_list[TIM_ID_MAX] = {
+	[TIM_ID_1] = TIM1,
+	[TIM_ID_2] = TIM2,
+	[TIM_ID_3] = TIM3,
+	[TIM_ID_4] = TIM4,
+};
+
+extern uint32_t ll_irq_save(void);
+extern void ll_irq_restore(uint32_t state);
+
+//update/compare irq of the driver owning the timer
+static tim_irq_fn tim_irq_list[TIM_ID_MAX];
+//driver running each timer, one of enum TimOwner
+static uint8_t tim_owner[TIM_ID_MAX];
+
+TIM_TypeDef *tim_get(uint32_t id)
+{
+	if(id < TIM_ID_MAX) {
+		return TIM_list[id];
+	}
+
+	return NULL;
+}
+
+//TIM_ID_MAX if tim is not in the list
+uint32_t tim_id(TIM_TypeDef *tim)
+{
+	uint32_t id;
+
+	for(id = 0; id < TIM_ID_MAX; id++) {
+		if(TIM_list[id] == tim) {
+			break;
+		}
+	}
+
+	return id;
+}
+
+/**
+ * Claims timer id for owner before a driver resets or reprograms it. A timer already claimed by
+ * the same owner is claimed again, so the PWM channels of one timer share it.
+ * -3 if another driver runs the timer
+ */
+int tim_claim(uint32_t id, uint32_t owner)
+{
+	uint32_t state;
+	int result = 0;
+
+	if(id >= TIM_ID_MAX) {
+		return -1;
+	}
+	state = ll_irq_save();
+	if(tim_owner[id] == TIM_OWNER_NONE) {
+		tim_owner[id] = owner;
+	} else if(tim_owner[id] != owner) {
+		result = -3;
+	}
+	ll_irq_restore(state);
+
+	return result;
+}
+
+//-3 if owner does not run the timer
+int tim_release(uint32_t id, uint32_t owner)
+{
+	if(id >= TIM_ID_MAX) {
+		return -1;
+	}
+	if(tim_owner[id] != owner) {
+		return -3;
+	}
+	tim_owner[id] = TIM_OWNER_NONE;
+
+	return 0;
+}
+
+static void tim_nvic(IRQn_Type irq, bool en)
+{
+	if(en) {
+		NVIC_EnableIRQ(irq);
+	} else {
+		NVIC_DisableIRQ(irq);
+	}
+}
+
+//handler NULL detaches and disables the timer irq
+void tim_irq_attach(uint32_t id, tim_irq_fn handler)
+{
+	bool en = handler != NULL;
+
+	if(id >= TIM_ID_MAX) {
+		return;
+	}
+	tim_irq_list[id] = handler;
+	switch (id)
+	{
+	case TIM_ID_1:
+		tim_nvic(TIM1_BRK_IRQn, en);
+		tim_nvic(TIM1_UP_IRQn, en);
+		tim_nvic(TIM1_CC_IRQn, en);
+	break;
+	case TIM_ID_2:
+		tim_nvic(TIM2_IRQn, en);
+	break;
+	case TIM_ID_3:
+		tim_nvic(TIM3_IRQn, en);
+	break;
+	default:
+		tim_nvic(TIM4_IRQn, en);
+	break;
+	}
+}
+
+static void tim_irq(uint32_t id)
+{
+	tim_irq_fn handler = tim_irq_list[id];
+
+	if(handler) {
+		handler(id, TIM_list[id]);
+	} else {
+		TIM_list[id]->INTFR = 0;
+	}
+}
+
+#define TIM_IRQ_HANDLER(name, id) \
+void name(void) __attribute__((interrupt("WCH-Interrupt-fast"))); \
+void name(void) \
+{ \
+	tim_irq(id); \
+}
+
+TIM_IRQ_HANDLER(TIM1_BRK_IRQHandler, TIM_ID_1)
+TIM_IRQ_HANDLER(TIM1_UP_IRQHandler, TIM_ID_1)
+TIM_IRQ_HANDLER(TIM1_CC_IRQHandler, TIM_ID_1)
+TIM_IRQ_HANDLER(TIM2_IRQHandler, TIM_ID_2)
+TIM_IRQ_HANDLER(TIM3_IRQHandler, TIM_ID_3)
+TIM_IRQ_HANDLER(TIM4_IRQHandler, TIM_ID_4)
+
+//counter clock of a timer before the prescaler
+uint32_t tim_clock_hz(TIM_TypeDef *tim)
+{
+	RCC_ClocksTypeDef clocks;
+	uint32_t pclk;
+
+	RCC_GetClocksFreq(&clocks);
+	pclk = (tim == TIM1) ? clocks.PCLK2_Frequency : clocks.PCLK1_Frequency;
+	if(pclk != clocks.HCLK_Frequency) {
+		pclk *= 2; //APB prescaler > 1 doubles the timer clock
+	}
+
+	return pclk;
+}
+
+void tim_clock_enable(TIM_TypeDef *tim)
+{
+	if(tim == TIM1) {
+		RCC_APB2PeriphClockCmd(RCC_APB2Periph_TIM1, ENABLE);
+	} else if(tim == TIM2) {
+		RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM2, ENABLE);
+	} else if(tim == TIM3) {
+		RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM3, ENABLE);
+	} else if(tim == TIM4) {
+		RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM4, ENABLE);
+	}
+}
+
+//prescaler and auto reload for an update rate of freq_hz with the smallest prescaler, so the
+//longest period. arr stays <= 0xFFFE, a full scale duty of arr + 1 still fits 16 bits
+int tim_calc_base(uint32_t clk_hz, uint32_t freq_hz, uint16_t *p_psc, uint16_t *p_arr)
+{
+	uint32_t ticks, psc;
+
+	if(freq_hz == 0) {
+		return -1;
+	}
+	ticks = (clk_hz + freq_hz / 2) / freq_hz;
+	if(ticks < 2) {
+		return -2;
+	}
+	psc = (ticks - 1) / 0xFFFF;
+	if(psc > 0xFFFF) {
+		return -2;
+	}
+
+	*p_psc = psc;
+	*p_arr = (ticks + (psc + 1) / 2) / (psc + 1) - 1;
+
+	return 0;
+}
+
+//dead-time generator setting of at least ns for a dead-time clock of clk_hz (CKD_DIV1), up to
+//1008 clocks
+int tim_calc_dead_time(uint32_t clk_hz, uint32_t ns, uint8_t *p_dtg)
+{
+	uint32_t ticks = ((uint64_t)ns * clk_hz + 999999999) / 1000000000;
+
+	if(ticks <= 127) {
+		*p_dtg = ticks;
+	} else if(ticks <= 254) {
+		*p_dtg = 0x80 | ((ticks + 1) / 2 - 64);
+	} else if(ticks <= 504) {
+		*p_dtg = 0xC0 | ((ticks + 7) / 8 - 32);
+	} else if(ticks <= 1008) {
+		*p_dtg = 0xE0 | ((ticks + 15) / 16 - 32);
+	} else {
+		return -1;
+	}
+
+	return 0;
+}
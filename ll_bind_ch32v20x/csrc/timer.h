@@ -0,0 +1,27 @@
+#ifndef __TIMER_H__
+#define __TIMER_H__
+
+typedef void (*tim_irq_fn)(uint32_t id, TIM_TypeDef *tim);
+
+//driver running a timer, see tim_claim()
+enum TimOwner {
+	TIM_OWNER_NONE = 0,
+	TIM_OWNER_PWM,
+	TIM_OWNER_MOTOR,
+	TIM_OWNER_CAPTURE,
+	TIM_OWNER_ENCODER,
+	TIM_OWNER_HWTIMER,
+	TIM_OWNER_ADC,
+};
+
+TIM_TypeDef *tim_get(uint32_t id);
+uint32_t tim_id(TIM_TypeDef *tim);
+int tim_claim(uint32_t id, uint32_t owner);
+int tim_release(uint32_t id, uint32_t owner);
+void tim_irq_attach(uint32_t id, tim_irq_fn handler);
+uint32_t tim_clock_hz(TIM_TypeDef *tim);
+void tim_clock_enable(TIM_TypeDef *tim);
+int tim_calc_base(uint32_t clk_hz, uint32_t freq_hz, uint16_t *p_psc, uint16_t *p_arr);
+int tim_calc_dead_time(uint32_t clk_hz, uint32_t ns, uint8_t *p_dtg);
+
+#endif //__TIMER_H__
@@ -5,10 +5,14 @@
 #include <string.h>
 #include <stdarg.h>
 #include "ch32v20x.h"
+#include "debug.h"
 #include "usart.h"
 #include "wrapper.h"
 
 extern void USART2_rx_hook_rs(uint8_t data);
+extern void ll_log_tx_irq(void);
+extern uint32_t ll_irq_save(void);
+extern void ll_irq_restore(uint32_t state);
 
 void USART2_IRQHandler(void) __attribute__((interrupt("WCH-Interrupt-fast")));
 void USART2_IRQHandler(void)
@@ -18,6 +22,9 @@ void USART2_IRQHandler(void)
         uint8_t data = USART_ReceiveData(USART2);
         USART2_rx_hook_rs(data);
     }
+#if(DEBUG == DEBUG_UART2)
+    ll_log_tx_irq();
+#endif
 }
 
 const USART_TypeDef* USART_LIST[] = { NULL, USART1, USART2, USART3, UART4 };
@@ -79,6 +86,242 @@ int usart_blocking_write(uint32_t usart_id, const uint8_t* p_buff, uint32_t size
     return 0;
 }
 
+static uint32_t usart_pclk(USART_TypeDef* usart)
+{
+    RCC_ClocksTypeDef clocks;
+
+    RCC_GetClocksFreq(&clocks);
+    return (usart == USART1) ? clocks.PCLK2_Frequency : clocks.PCLK1_Frequency;
+}
+
+static void usart_write_brr(USART_TypeDef* usart, uint32_t brr)
+{
+    //let the last frame leave the shift register before the bit clock changes
+    while(USART_GetFlagStatus(usart, USART_FLAG_TC) == RESET);
+    usart->BRR = (uint16_t)brr;
+}
+
+int usart_set_baudrate(uint32_t usart_id, uint32_t baud_rate)
+{
+    USART_TypeDef* usart = get_USARTx(usart_id);
+    if(usart == NULL || baud_rate == 0) {
+        return -1;
+    }
+
+    //16x oversampling: BRR = mantissa.fraction(4bit) = PCLK / baud
+    uint32_t brr = (usart_pclk(usart) + baud_rate / 2) / baud_rate;
+    if(brr < 16 || brr > 0xFFFF) {
+        return -2;
+    }
+    usart_write_brr(usart, brr);
+
+    return 0;
+}
+
+/*
+ * Autobaud: the RX pin is sampled directly while the receiver is switched off,
+ * edges are timestamped with SysTick->CNT (HCLK). IRQs are masked only while
+ * an edge is expected, in short windows, so the system tick keeps running.
+ */
+typedef struct {
+    GPIO_TypeDef* port;
+    uint16_t pin;
+} UsartRxPin;
+
+//default mapping, see usart_rx_pin() for the AFIO remaps
+static const UsartRxPin USART_RX_PIN_LIST[] = {
+    { NULL,  0 },
+    { GPIOA, GPIO_Pin_10 },
+    { GPIOA, GPIO_Pin_3 },
+    { GPIOB, GPIO_Pin_11 },
+    { GPIOC, GPIO_Pin_11 },
+};
+
+#define AFIO_PCFR2_USART1_REMAP1 ((uint32_t)0x04000000) //USART1 remap high bit
+#define AFIO_PCFR2_UART4_REMAP   ((uint32_t)0x00000003)
+
+//RX pin of usart_id as remapped by AFIO PCFR1/PCFR2, port NULL for a remap that is not handled
+static UsartRxPin usart_rx_pin(uint32_t usart_id)
+{
+    UsartRxPin rx = USART_RX_PIN_LIST[usart_id];
+    uint32_t pcfr1 = AFIO->PCFR1;
+    uint32_t pcfr2 = AFIO->PCFR2;
+
+    switch(usart_id) {
+    case 1:
+        if(pcfr2 & AFIO_PCFR2_USART1_REMAP1) {
+            rx.port = NULL;
+        } else if(pcfr1 & AFIO_PCFR1_USART1_REMAP) {
+            rx = (UsartRxPin){ GPIOB, GPIO_Pin_7 };
+        }
+    break;
+    case 2:
+        if(pcfr1 & AFIO_PCFR1_USART2_REMAP) {
+            rx = (UsartRxPin){ GPIOD, GPIO_Pin_6 };
+        }
+    break;
+    case 3:
+        if((pcfr1 & AFIO_PCFR1_USART3_REMAP) == AFIO_PCFR1_USART3_REMAP_PARTIALREMAP) {
+            rx = (UsartRxPin){ GPIOC, GPIO_Pin_11 };
+        } else if((pcfr1 & AFIO_PCFR1_USART3_REMAP) == AFIO_PCFR1_USART3_REMAP_FULLREMAP) {
+            rx = (UsartRxPin){ GPIOD, GPIO_Pin_9 };
+        } else if(pcfr1 & AFIO_PCFR1_USART3_REMAP) {
+            rx.port = NULL;
+        }
+    break;
+    case 4:
+        if(pcfr2 & AFIO_PCFR2_UART4_REMAP) {
+            rx.port = NULL;
+        }
+    break;
+    default:
+    break;
+    }
+
+    return rx;
+}
+
+#define AUTOBAUD_WINDOW_MS 2 //edge wait slice with IRQs masked
+#define AUTOBAUD_FRAME_MS  10 //longest measured pattern, 0x55 at 800 baud
+
+#define RX_LEVEL(p) (((p)->port->INDR & (p)->pin) != 0)
+
+//wait until the RX line has been idle (high) for one window
+static int autobaud_wait_idle(const UsartRxPin* rx, uint64_t deadline)
+{
+    uint64_t window = (uint64_t)(SystemCoreClock / 1000) * AUTOBAUD_WINDOW_MS;
+    uint64_t idle_since = SysTick->CNT;
+
+    while(SysTick->CNT - idle_since < window) {
+        if(!RX_LEVEL(rx)) {
+            idle_since = SysTick->CNT;
+        }
+        if(SysTick->CNT > deadline) {
+            return -3;
+        }
+    }
+    return 0;
+}
+
+//returns the measured bit time of `bits` bits in HCLK ticks, 0 when the line went busy
+static uint64_t autobaud_measure(const UsartRxPin* rx, uint32_t mode, uint64_t deadline)
+{
+    uint64_t window = (uint64_t)(SystemCoreClock / 1000) * AUTOBAUD_WINDOW_MS;
+    uint64_t start, edge;
+    uint32_t falling = 0;
+    bool level = true;
+
+    while(1) {
+        uint32_t gintenr = ll_irq_save();
+        uint64_t window_end = SysTick->CNT + window;
+
+        if(!RX_LEVEL(rx)) {//edge fell while IRQs were open, timestamp is lost
+            ll_irq_restore(gintenr);
+            return 0;
+        }
+        while(RX_LEVEL(rx)) {
+            if(SysTick->CNT > window_end) {
+                break;
+            }
+        }
+        start = SysTick->CNT;
+        if(RX_LEVEL(rx)) {//nothing in this window, let pending IRQs run
+            ll_irq_restore(gintenr);
+            if(start > deadline) {
+                return UINT64_MAX;
+            }
+            continue;
+        }
+
+        //start bit is in progress, stay masked until the measurement is done
+        window_end = start + (uint64_t)(SystemCoreClock / 1000) * AUTOBAUD_FRAME_MS;
+        edge = start;
+        falling = 1;
+        level = false;
+        while(SysTick->CNT < window_end) {
+            bool now = RX_LEVEL(rx);
+            if(now == level) {
+                continue;
+            }
+            edge = SysTick->CNT;
+            level = now;
+            if(mode == USART_AUTOBAUD_START_BIT) {
+                if(level) {
+                    break;//rising edge ends the start bit
+                }
+            } else if(!level) {
+                if(++falling == 5) {
+                    break;//1st..5th falling edge of 0x55 spans 8 bits
+                }
+            }
+        }
+        ll_irq_restore(gintenr);
+
+        if(edge == start || (mode != USART_AUTOBAUD_START_BIT && falling != 5)) {
+            return 0;
+        }
+        return edge - start;
+    }
+}
+
+int usart_autobaud(uint32_t usart_id, uint32_t mode, uint32_t timeout_ms)
+{
+    USART_TypeDef* usart = get_USARTx(usart_id);
+    if(usart == NULL || usart_id >= sizeof(USART_RX_PIN_LIST)/sizeof(USART_RX_PIN_LIST[0])) {
+        return -1;
+    }
+
+    UsartRxPin rx_pin = usart_rx_pin(usart_id);
+    const UsartRxPin* rx = &rx_pin;
+    uint32_t bits = (mode == USART_AUTOBAUD_START_BIT) ? 1 : 8;
+    uint64_t deadline = SysTick->CNT + (uint64_t)(SystemCoreClock / 1000) * timeout_ms;
+    uint64_t ticks;
+    int result;
+
+    if(rx->port == NULL) {//remapped to pins autobaud does not sample
+        return -4;
+    }
+    usart->CTLR1 &= ~USART_CTLR1_RE;//keep the sync char out of the rx hook
+    while(1) {
+        result = autobaud_wait_idle(rx, deadline);
+        if(result < 0) {
+            break;
+        }
+        ticks = autobaud_measure(rx, mode, deadline);
+        if(ticks == UINT64_MAX) {
+            result = -3;
+            break;
+        }
+        if(ticks != 0) {
+            break;
+        }
+    }
+
+    if(result == 0) {
+        //baud = HCLK * bits / ticks, BRR = PCLK / baud
+        uint64_t hclk = SystemCoreClock;
+        uint64_t brr = ((uint64_t)usart_pclk(usart) * ticks + hclk * bits / 2) / (hclk * bits);
+        if(brr < 16 || brr > 0xFFFF) {
+            result = -2;
+        } else {
+            usart_write_brr(usart, (uint32_t)brr);
+            result = (int)((hclk * bits + ticks / 2) / ticks);
+        }
+
+        //let the rest of the measured char pass before the receiver comes back
+        uint64_t bit_ticks = ticks / bits;
+        uint64_t frame_end = SysTick->CNT + bit_ticks * ((mode == USART_AUTOBAUD_START_BIT) ? 9 : 1);
+        while(SysTick->CNT < frame_end);
+        frame_end += bit_ticks * 2;
+        while(!RX_LEVEL(rx) && SysTick->CNT < frame_end);
+    }
+
+    (void)USART_ReceiveData(usart);
+    usart->CTLR1 |= USART_CTLR1_RE;
+
+    return result;
+}
+
 // extern void delay_ns(uint32_t ns);
 // int usart_blocking_read(uint32_t usart_id, uint8_t* p_buff, uint32_t size, uint32_t timeout)
 // {
@@ -3,5 +3,7 @@
 
 int usart_init(uint32_t usart_id, uint32_t flags, uint32_t baud_rate);
 int usart_blocking_write(uint32_t usart_id, const uint8_t* p_buff, uint32_t size);
+int usart_set_baudrate(uint32_t usart_id, uint32_t baud_rate);
+int usart_autobaud(uint32_t usart_id, uint32_t mode, uint32_t timeout_ms);
 
 #endif //__USART_H__
@@ -35,6 +35,9 @@ enum {
 
 	USART_DATA_BITS8    = 0x00 << 8,
 	USART_DATA_BITS9    = 0x01 << 8,
+
+	USART_AUTOBAUD_SYNC_0X55 = 0,//0x55 sync char, 1st..5th falling edge
+	USART_AUTOBAUD_START_BIT = 1,//start bit width, needs a char with bit0 = 1
 };
 
 enum {
@@ -103,9 +106,34 @@ enum {
 	PWM_CTRL_GET_MAXDUTY = 4,
 	PWM_CTRL_SET_PERIOD = 5,
 	PWM_CTRL_GET_PERIOD = 6,
+	PWM_CTRL_DMA_ON = 7,
+	PWM_CTRL_DMA_OFF = 8,
+	PWM_CTRL_GET_DMA_REQ = 9,
 
     PWM_CTRL_ACTIVE_HIGH = 10,
     PWM_CTRL_ACTIVE_LOW  = 11,
+
+	PWM_INIT_OUTPUT_FREQ = 0x01,
+
+    MOTOR_BREAK_ENABLE      = 0x01,
+    MOTOR_BREAK_ACTIVE_HIGH = 0x02,
+
+    MOTOR_CTRL_ENABLE = 0,
+    MOTOR_CTRL_DISABLE = 1,
+    MOTOR_CTRL_GET_STATUS = 2,
+    MOTOR_CTRL_UPDATE_IRQ = 3,
+    MOTOR_CTRL_SAMPLE_DELAY = 4,
+    MOTOR_CTRL_POLARITY = 5,
+    MOTOR_CTRL_GET_MAX_DUTY = 6,
+
+    MOTOR_POLARITY_HIGH_LOW = 0x01,//high side switches active low
+    MOTOR_POLARITY_LOW_LOW  = 0x02,//low side switches active low
+
+    MOTOR_STATUS_ENABLED = 0x01,
+    MOTOR_STATUS_BREAK   = 0x02,
+
+    MOTOR_EVENT_UPDATE = 0x01,
+    MOTOR_EVENT_BREAK  = 0x02,
 };
 
 enum {
@@ -122,6 +150,34 @@ enum {
     ADC_CTRL_START = 0,
     ADC_CTRL_STOP = 1,
     ADC_CTRL_CONVERT = 2,
+    ADC_CTRL_SET_RATE = 3,
+
+    ADC_IN0 = 0,//ADC_IN0..ADC_IN15 are the analog inputs of the chip
+    ADC_IN15 = 15,
+    ADC_IN_TEMP = 16,
+    ADC_IN_VREF = 17,
+    ADC_IN_MAX,
+
+    ADC_SAMPLE_1_5 = 0,
+    ADC_SAMPLE_7_5 = 1,
+    ADC_SAMPLE_13_5 = 2,
+    ADC_SAMPLE_28_5 = 3,
+    ADC_SAMPLE_41_5 = 4,
+    ADC_SAMPLE_55_5 = 5,
+    ADC_SAMPLE_71_5 = 6,
+    ADC_SAMPLE_239_5 = 7,
+
+    ADC_SCAN_CTRL_ONE_SHOT = 0,
+    ADC_SCAN_CTRL_CONTINUOUS = 1,
+    ADC_SCAN_CTRL_STOP = 2,
+    ADC_SCAN_CTRL_SET_RATE = 3,
+
+    ADC_INJECT_IRQ = 0x01,
+    ADC_INJECT_TRIG_PWM = 0x02,
+
+    ADC_WATCHDOG_CTRL_SET = 0,
+    ADC_WATCHDOG_CTRL_ARM = 1,
+    ADC_WATCHDOG_CTRL_DISABLE = 2,
 };
 
 enum {
@@ -150,6 +206,13 @@ enum {
     DMA_CTRL_START = 0,
     DMA_CTRL_STOP = 1,
     DMA_CTRL_WAIT = 2,
+    DMA_CTRL_IRQ = 3,
+    DMA_CTRL_GET_COUNT = 4,
+
+    DMA_IRQ_TC             = 0x02,
+    DMA_IRQ_HT             = 0x04,
+    DMA_IRQ_TE             = 0x08,
+    DMA_IRQ_MASK           = 0x0E,
 
     DMA_FLAG_SRC_BYTE      = 0x01 << 0,
     DMA_FLAG_SRC_HALFWORD  = 0x02 << 0,
@@ -174,6 +237,84 @@ enum {
 
     DMA_FLAG_CIRCULAR_OFF  = 0x00 << 8,
     DMA_FLAG_CIRCULAR_ON   = 0x01 << 8,
+
+    DMA_SEG_SRC_INC        = 0x01,
+    DMA_SEG_DST_INC        = 0x02,
+};
+
+enum {
+    DMA_REQ_MEM,//memory to memory
+    DMA_REQ_ADC1,
+    DMA_REQ_SPI1_RX,
+    DMA_REQ_SPI1_TX,
+    DMA_REQ_SPI2_RX,
+    DMA_REQ_SPI2_TX,
+    DMA_REQ_USART1_RX,
+    DMA_REQ_USART1_TX,
+    DMA_REQ_USART2_RX,
+    DMA_REQ_USART2_TX,
+    DMA_REQ_USART3_RX,
+    DMA_REQ_USART3_TX,
+    DMA_REQ_I2C1_RX,
+    DMA_REQ_I2C1_TX,
+    DMA_REQ_I2C2_RX,
+    DMA_REQ_I2C2_TX,
+    DMA_REQ_TIM1_UP,
+    DMA_REQ_TIM2_UP,
+    DMA_REQ_TIM3_UP,
+    DMA_REQ_TIM4_UP,
+    DMA_REQ_TIM1_CH1,
+    DMA_REQ_TIM2_CH1,
+    DMA_REQ_TIM3_CH1,
+    DMA_REQ_TIM4_CH1,
+    DMA_REQ_MAX,
+};
+
+enum {
+    TIM_ID_1,
+    TIM_ID_2,
+    TIM_ID_3,
+    TIM_ID_4,
+    TIM_ID_MAX,
+
+    CAPTURE_MODE_PWM_INPUT = 0,
+    CAPTURE_MODE_EDGES = 1,
+
+    CAPTURE_EDGE_RISING  = 0x00,
+    CAPTURE_EDGE_FALLING = 0x01,
+    CAPTURE_EDGE_BOTH    = 0x02,
+    CAPTURE_EDGE_MASK    = 0x03,
+    CAPTURE_FILTER_SHIFT = 4,//input filter 0..15 in bits 4..7
+
+    CAPTURE_CTRL_START = 0,
+    CAPTURE_CTRL_STOP = 1,
+    CAPTURE_CTRL_READ_PWM = 2,
+    CAPTURE_CTRL_EDGE_IRQ = 3,
+
+    CAPTURE_EVENT_OVERFLOW = 0x01,
+    CAPTURE_EVENT_EDGE = 0x02,
+
+    ENCODER_MODE_X4 = 0x00,
+    ENCODER_MODE_X2 = 0x01,
+    ENCODER_FILTER_SHIFT = 4,//input filter 0..15 in bits 4..7
+
+    ENCODER_CTRL_READ = 0,
+    ENCODER_CTRL_SET = 1,
+    ENCODER_CTRL_GET_CLOCK = 2,
+
+    HWTIMER_CTRL_NOW = 0,
+    HWTIMER_CTRL_SET_ALARM = 1,
+    HWTIMER_CTRL_CANCEL = 2,
+};
+
+enum {
+	LOG_CTRL_FLUSH       = 0,
+	LOG_CTRL_SET_POLICY  = 1,
+	LOG_CTRL_GET_DROPPED = 2,
+
+	LOG_POLICY_DROP_NEW  = 0,
+	LOG_POLICY_DROP_OLD  = 1,
+	LOG_POLICY_BLOCK     = 2,
 };
 
 enum INVOKE {
@@ -184,6 +325,8 @@ enum INVOKE {
 	ID_DELAY_NANO  = 201,
 	ID_LOG_PUTS    = 202,
 	ID_LOG_PRINT   = 203,
+	ID_LOG_CTRL    = 204,
+	ID_LOG_PUT_FRAME = 205,
 
 	ID_GPIO_INIT = 300,
 	ID_GPIO_SET,
@@ -199,14 +342,26 @@ enum INVOKE {
 	ID_USART_INIT  = 500,
 	ID_USART_DEINIT,
 	ID_USART_WRITE,
+	ID_USART_SET_BAUDRATE,
+	ID_USART_AUTOBAUD,
 
 	ID_PWM_INIT  = 600,
 	ID_PWM_DEINIT,
 	ID_PWM_CTRL,
+	ID_PWM_MOTOR_INIT,
+	ID_PWM_MOTOR_DEINIT,
+	ID_PWM_MOTOR_CTRL,
 
     ID_ADC_INIT = 700,
     ID_ADC_DEINIT,
     ID_ADC_CTRL,
+    ID_ADC_SCAN_INIT,
+    ID_ADC_SCAN_CTRL,
+    ID_ADC_DUAL_INIT,
+    ID_ADC_INJECT_START,
+    ID_ADC_INJECT_READ,
+    ID_ADC_WATCHDOG,
+    ID_ADC_GET_CALIBRATION,
 
     ID_I2C_INIT = 800,
     ID_I2C_DEINIT,
@@ -217,6 +372,19 @@ enum INVOKE {
     ID_DMA_INIT = 900,
     ID_DMA_DEINIT,
     ID_DMA_CTRL,
+    ID_DMA_RELOAD,
+    ID_DMA_REQUEST_CHANNELS,
+    ID_DMA_CHAIN_START,
+
+    ID_TIM_CAPTURE_INIT = 1000,
+    ID_TIM_CAPTURE_DEINIT,
+    ID_TIM_CAPTURE_CTRL,
+    ID_TIM_ENCODER_INIT,
+    ID_TIM_ENCODER_DEINIT,
+    ID_TIM_ENCODER_CTRL,
+    ID_TIM_HWTIMER_INIT,
+    ID_TIM_HWTIMER_DEINIT,
+    ID_TIM_HWTIMER_CTRL,
 };
 
 int ll_invoke(enum INVOKE invoke_id, ...);
@@ -0,0 +1,244 @@
+//Host test and benchmark of the csrc/print.c formatter, not part of the crate build
+//gcc -O2 -I../csrc print_test.c ../csrc/print.c -o print_test && ./print_test
+//the same print.c is used by ll_bind_hk32F0301mxxc, build with -I../../ll_bind_hk32F0301mxxc/csrc to check that copy
+#include <stdio.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include "wrapper.h"
+#include "print.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_NOW()     __rdtsc()
+#define BENCH_UNIT      "cycles"
+#else
+static uint64_t bench_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+#define BENCH_NOW()     bench_ns()
+#define BENCH_UNIT      "ns"
+#endif
+
+static char uart[1 << 16];
+static uint32_t uart_len;
+
+void ll_putc(char c) { if(uart_len < sizeof(uart)) uart[uart_len++] = c; }
+void ll_log_tx_start(void) {}
+void ll_log_tx_wait_done(void) {}
+uint32_t ll_irq_save(void) { return 0; }
+void ll_irq_restore(uint32_t state) { (void)state; }
+
+static int failed;
+static int checked;
+
+static void log_print(const char *fmt, ...)
+{
+    va_list va;
+    va_start(va, fmt);
+    ll_vprintf(fmt, va);
+    va_end(va);
+}
+
+static void expect(const char *got, const char *want, const char *what)
+{
+    checked++;
+    if(strcmp(got, want)) {
+        failed++;
+        printf("FAIL %s: got \"%s\" want \"%s\"\n", what, got, want);
+    }
+}
+
+//formats the same spec with ll_snprintf and the C library, both must match
+#define SAME(fmt, ...) do { \
+    char a[96], b[96]; \
+    int na = ll_snprintf(a, sizeof(a), fmt, __VA_ARGS__); \
+    int nb = snprintf(b, sizeof(b), fmt, __VA_ARGS__); \
+    expect(a, b, fmt); \
+    if(na != nb) { failed++; printf("FAIL %s: len %d want %d\n", fmt, na, nb); } \
+} while(0)
+
+#define LL(want, fmt, ...) do { \
+    char a[96]; \
+    ll_snprintf(a, sizeof(a), fmt, __VA_ARGS__); \
+    expect(a, want, fmt); \
+} while(0)
+
+static uint32_t rnd_state = 0x12345678;
+static uint32_t rnd(void)
+{
+    rnd_state ^= rnd_state << 13;
+    rnd_state ^= rnd_state >> 17;
+    rnd_state ^= rnd_state << 5;
+    return rnd_state;
+}
+
+static void test_ints(void)
+{
+    static const int32_t ints[] = { 0, 1, -1, 9, 10, 99, 100, 101, 999, 1000, 43698, 43699, 65535, 65536,
+                                    99999, 100000, 123456789, 999999999, 1000000000, INT32_MAX, INT32_MIN };
+    for(uint32_t i = 0; i < sizeof(ints) / sizeof(ints[0]); i++) {
+        int32_t v = ints[i];
+        SAME("%d", v);
+        SAME("%u", (uint32_t)v);
+        SAME("%x", (uint32_t)v);
+        SAME("%X", (uint32_t)v);
+        SAME("%ld", (long)v);
+        SAME("%lu", (unsigned long)(uint32_t)v);
+        SAME("[%8d]", v);
+        SAME("[%-8d]", v);
+        SAME("[%08d]", v);
+        SAME("[%012u]", (uint32_t)v);
+        SAME("[%08x]", (uint32_t)v);
+        SAME("[%-10X]", (uint32_t)v);
+    }
+    for(int i = 0; i < 200000; i++) {
+        uint32_t v = rnd() >> (rnd() & 31);
+        SAME("%u", v);
+        SAME("%d", (int32_t)v);
+    }
+}
+
+static void test_ints64(void)
+{
+    static const int64_t ints[] = { 0, -1, 4294967295LL, 4294967296LL, 999999999999LL, 1000000000000000000LL,
+                                    INT64_MAX, INT64_MIN };
+    for(uint32_t i = 0; i < sizeof(ints) / sizeof(ints[0]); i++) {
+        long long v = ints[i];
+        SAME("%lld", v);
+        SAME("%llu", (unsigned long long)v);
+        SAME("%llx", (unsigned long long)v);
+        SAME("[%24lld]", v);
+        SAME("[%-24lld]", v);
+        SAME("[%022llu]", (unsigned long long)v);
+    }
+    for(int i = 0; i < 100000; i++) {
+        unsigned long long v = ((unsigned long long)rnd() << 32 | rnd()) >> (rnd() & 63);
+        SAME("%llu", v);
+        SAME("%lld", (long long)v);
+        SAME("%d %llu %d", 7, v, -7);
+    }
+}
+
+static void test_fixed_point(void)
+{
+    LL("123.45", "%.2q", 12345);
+    LL("-123.45", "%.2q", -12345);
+    LL("0.05", "%.2q", 5);
+    LL("-0.005", "%.3q", -5);
+    LL("0.0", "%.1q", 0);
+    LL("42", "%q", 42);
+    LL("[  21.5]", "[%6.1q]", 215);
+    LL("[-021.5]", "[%06.1q]", -215);
+    LL("[21.5  ]", "[%-6.1q]", 215);
+    LL("-92233720368.54775808", "%.8llq", INT64_MIN);
+}
+
+static void test_strings(void)
+{
+    SAME("[%c]", 'A');
+    SAME("[%3c]", 'A');
+    SAME("[%-3c]", 'A');
+    SAME("[%s]", "abc");
+    SAME("[%6s]", "abc");
+    SAME("[%-6s]", "abc");
+    SAME("100%% %s", "done");
+    LL("[abc]", "[%S]", "abcdef", 3);
+    LL("[   abc]", "[%6S]", "abcdef", 3);
+    LL("01 AB FF ", "%y", "\x01\xAB\xFF", 3);
+    LL("a=1 s=hi", "a=%d s=%S", 1, "hi!", 2);
+}
+
+static void test_truncation(void)
+{
+    char buf[8];
+    int n = ll_snprintf(buf, sizeof(buf), "%d-%s", 123456, "abcdef");
+    expect(buf, "123456-", "truncated");
+    checked++;
+    if(n != 13) {
+        failed++;
+        printf("FAIL truncated len %d\n", n);
+    }
+    n = ll_snprintf(NULL, 0, "%u", 4000000000u);
+    checked++;
+    if(n != 10) {
+        failed++;
+        printf("FAIL size 0 len %d\n", n);
+    }
+}
+
+//ll_vprintf formats into its stack buffer and queues it with one ll_log_write per LOG_LINE_SIZE chunk
+static void test_log(void)
+{
+    char want[512], line[300];
+
+    for(int i = 0; i < (int)sizeof(line) - 1; i++) {
+        line[i] = 'a' + i % 26;
+    }
+    line[sizeof(line) - 1] = '\0';
+
+    uart_len = 0;
+    log_print("x=%d y=%x %s|\r\n", -42, 0xBEEFu, "hi");
+    log_print("%s %05u\r\n", line, 7u);
+    ll_log_flush();
+    uart[uart_len] = '\0';
+    snprintf(want, sizeof(want), "x=%d y=%x %s|\r\n%s %05u\r\n", -42, 0xBEEFu, "hi", line, 7u);
+    expect(uart, want, "ll_vprintf");
+}
+
+static void bench(const char *name, const char *fmt, ...)
+{
+    enum { ROUNDS = 200000 };
+    char buf[96];
+    uint64_t best_ll = UINT64_MAX, best_libc = UINT64_MAX;
+
+    for(int r = 0; r < 5; r++) {
+        va_list va;
+        uint64_t t0 = BENCH_NOW();
+        for(int i = 0; i < ROUNDS; i++) {
+            va_start(va, fmt);
+            ll_vsnprintf(buf, sizeof(buf), fmt, va);
+            va_end(va);
+        }
+        uint64_t t1 = BENCH_NOW();
+        for(int i = 0; i < ROUNDS; i++) {
+            va_start(va, fmt);
+            vsnprintf(buf, sizeof(buf), fmt, va);
+            va_end(va);
+        }
+        uint64_t t2 = BENCH_NOW();
+        if(t1 - t0 < best_ll) best_ll = t1 - t0;
+        if(t2 - t1 < best_libc) best_libc = t2 - t1;
+    }
+    printf("  %-22s %8.1f %s/format", name, (double)best_ll / ROUNDS, BENCH_UNIT);
+    if(strchr(fmt, 'q')) {
+        printf("\n");//libc has no %q
+    } else {
+        printf(" (libc %8.1f)\n", (double)best_libc / ROUNDS);
+    }
+}
+
+int main(void)
+{
+    test_ints();
+    test_ints64();
+    test_fixed_point();
+    test_strings();
+    test_truncation();
+    test_log();
+    printf("%d checks, %d failed\n", checked, failed);
+
+    printf("benchmark:\n");
+    bench("%d small", "%d", 42);
+    bench("%d large", "%d", -2147483647);
+    bench("%08x", "%08x", 0xDEADBEEFu);
+    bench("%llu", "%llu", 18446744073709551615ull);
+    bench("%.2q", "%.2q", -12345);
+    bench("line", "T=%.1q H=%u%% P=%ld\r\n", 215, 45u, 101325L);
+
+    return failed ? 1 : 0;
+}
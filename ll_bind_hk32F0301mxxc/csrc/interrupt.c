@@ -5,6 +5,13 @@
 #include "wrapper.h"
 
 extern void EXTI_IRQ_hook_rs(uint8_t line);
+extern void ll_log_tx_irq(void);
+
+//vector name UART1 clashes with the peripheral macro, bind it by symbol
+void UART1_IRQ(void) __asm__("UART1");
+void UART1_IRQ(void) {
+	ll_log_tx_irq();
+}
 
 void EXTI0(void) {
 	if (EXTI_GetFlagStatus(EXTI_Line0) != RESET)
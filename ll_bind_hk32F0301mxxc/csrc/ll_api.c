@@ -11,6 +11,7 @@ static void uart_config()
 {
 	GPIO_InitTypeDef GPIO_InitStructure;
 	UART_InitTypeDef UART_InitStructure;
+	NVIC_InitTypeDef NVIC_InitStructure;
 
 	UART_InitStructure.UART_BaudRate = 115200;
 	UART_InitStructure.UART_WordLength = UART_WordLength_8b;
@@ -24,6 +25,12 @@ static void uart_config()
 	/* Enable UART */
 	UART_Cmd(UART1, ENABLE);
 
+	/* log output is drained by the TXE interrupt */
+	NVIC_InitStructure.NVIC_IRQChannel = UART1_IRQn;
+	NVIC_InitStructure.NVIC_IRQChannelPriority = 3;
+	NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_Init(&NVIC_InitStructure);
+
 	GPIO_StructInit(&GPIO_InitStructure);
 	//PD2 TX
 	GPIO_InitStructure.GPIO_Mode =GPIO_Mode_AF;
@@ -209,10 +216,46 @@ int gpio_exti(uint32_t port, uint32_t pin, uint32_t flags)
 
 	return 0;
 }
+uint32_t ll_irq_save(void)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	return primask;
+}
+
+void ll_irq_restore(uint32_t state)
+{
+	if(state == 0) {
+		__enable_irq();
+	}
+}
+
 void ll_putc(char c)
 {
-	UART_SendData(UART1, (uint8_t)c);
 	while(UART_GetFlagStatus(UART1, UART_FLAG_TXE) == 0);
+	UART_SendData(UART1, (uint8_t)c);
+}
+
+void ll_log_tx_start(void)
+{
+	UART_ITConfig(UART1, UART_IT_TXE, ENABLE);
+}
+
+void ll_log_tx_wait_done(void)
+{
+	while(UART_GetFlagStatus(UART1, UART_FLAG_TC) == 0);
+}
+
+void ll_log_tx_irq(void)
+{
+	if(UART_GetITStatus(UART1, UART_IT_TXE) != RESET) {
+		int c = ll_log_pop();
+		if(c < 0) {
+			UART_ITConfig(UART1, UART_IT_TXE, DISABLE);
+		} else {
+			UART_SendData(UART1, (uint8_t)c);
+		}
+	}
 }
 int ll_invoke(enum INVOKE invoke_id, ...)
 {
@@ -225,6 +268,10 @@ int ll_invoke(enum INVOKE invoke_id, ...)
 	case ID_SYSTEM_INIT:
 		SystemInit();
 	break;
+	case ID_SYSTEM_RESET:
+		ll_log_flush();
+		NVIC_SystemReset();
+	break;
 	case ID_LL_DRV_INIT:
 		hal_hw_init();
 	break;
@@ -242,9 +289,7 @@ int ll_invoke(enum INVOKE invoke_id, ...)
 	{
 		uint8_t* p_str = va_arg(args, uint8_t*);
 		uint32_t len = va_arg(args, uint32_t);
-		while (len--) {
-			ll_putc(*p_str++);
-		}
+		ll_log_write((const char*)p_str, len);
 	}
 	break;
 	case ID_LOG_PRINT:
@@ -253,6 +298,22 @@ int ll_invoke(enum INVOKE invoke_id, ...)
 		ll_vprintf(fmt, args);
 	}
 	break;
+	case ID_LOG_CTRL:
+	{
+		uint32_t ctrl = va_arg(args, uint32_t);
+		uint32_t param = va_arg(args, uint32_t);
+
+		result = ll_log_ctrl(ctrl, param);
+	}
+	break;
+	case ID_LOG_PUT_FRAME:
+	{
+		uint8_t* p_frame = va_arg(args, uint8_t*);
+		uint32_t len = va_arg(args, uint32_t);
+
+		result = ll_log_write_frame((const char*)p_frame, len);
+	}
+	break;
 	case ID_GPIO_INIT:
 	{
 		uint32_t port = va_arg(args, uint32_t);
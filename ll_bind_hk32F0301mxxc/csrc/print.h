@@ -4,6 +4,13 @@
 #define PRINT_LOG
 
 void ll_vprintf(const char *fmt, va_list va);
+int  ll_vsnprintf(char *buf, uint32_t size, const char *fmt, va_list va);
+int  ll_snprintf(char *buf, uint32_t size, const char *fmt, ...);
+void ll_log_write(const char *p, uint32_t len);
+int  ll_log_write_frame(const char *p, uint32_t len);
+int  ll_log_pop(void);
+void ll_log_flush(void);
+int  ll_log_ctrl(uint32_t ctrl, uint32_t param);
 
 #ifdef PRINT_LOG
 #define println(fmt, ...)    ll_invoke(ID_LOG_PRINT, fmt "\r\n", ##__VA_ARGS__)
@@ -35,6 +35,9 @@ enum {
 
 	USART_DATA_BITS8    = 0x00 << 8,
 	USART_DATA_BITS9    = 0x01 << 8,
+
+	USART_AUTOBAUD_SYNC_0X55 = 0,//0x55 sync char, 1st..5th falling edge
+	USART_AUTOBAUD_START_BIT = 1,//start bit width, needs a char with bit0 = 1
 };
 
 enum {
@@ -136,6 +139,16 @@ enum {
     I2C_TEN_BIT_ADDR = 1,
 };
 
+enum {
+	LOG_CTRL_FLUSH       = 0,
+	LOG_CTRL_SET_POLICY  = 1,
+	LOG_CTRL_GET_DROPPED = 2,
+
+	LOG_POLICY_DROP_NEW  = 0,
+	LOG_POLICY_DROP_OLD  = 1,
+	LOG_POLICY_BLOCK     = 2,
+};
+
 enum INVOKE {
 	ID_SYSTEM_INIT = 100,
 	ID_SYSTEM_RESET = 101,
@@ -144,6 +157,8 @@ enum INVOKE {
 	ID_DELAY_NANO  = 201,
 	ID_LOG_PUTS    = 202,
 	ID_LOG_PRINT   = 203,
+	ID_LOG_CTRL    = 204,
+	ID_LOG_PUT_FRAME = 205,
 
 	ID_GPIO_INIT = 300,
 	ID_GPIO_SET,
@@ -159,6 +174,8 @@ enum INVOKE {
 	ID_USART_INIT  = 500,
 	ID_USART_DEINIT,
 	ID_USART_WRITE,
+	ID_USART_SET_BAUDRATE,
+	ID_USART_AUTOBAUD,
 
 	ID_PWM_INIT  = 600,
 	ID_PWM_DEINIT,
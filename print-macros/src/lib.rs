@@ -90,6 +90,9 @@ fn write(input: TokenStream, newline: bool) -> TokenStream {
                         PCT::Int => {
                             exprs.push(quote!( #arg ));
                         }
+                        PCT::Int64 => {
+                            exprs.push(quote!( #arg ));
+                        }
                         PCT::Ch => {
                             exprs.push(quote!( #arg ));
                         }
@@ -104,7 +107,7 @@ fn write(input: TokenStream, newline: bool) -> TokenStream {
                         }
                     }
                 }
-                Piece::Display => {
+                Piece::Display { spec } => {
                     let mut ok = false;
                     let mut err_msg = "".to_string();
                     let mut lable = "";
@@ -187,7 +190,9 @@ fn write(input: TokenStream, newline: bool) -> TokenStream {
                             .into();
                     }
 
-                    format.push_str(lable);
+                    format.push('%');
+                    format.push_str(&spec);
+                    format.push_str(&lable[1..]);
                 }
                 Piece::Debug => {
                     let buf_x = mk_name_with_idx("buf", i);
@@ -205,11 +210,23 @@ fn write(input: TokenStream, newline: bool) -> TokenStream {
                 }
                 Piece::Hex {
                     upper_case,
-                    // pad_char,
-                    // pad_length,
-                    // prefix,
+                    pad_char,
+                    pad_length,
+                    prefix,
                 } => {
-                    format.push_str(if upper_case { "%X" } else { "%x" });
+                    let mut pad_length = pad_length;
+                    if prefix {
+                        format.push_str("0x");
+                        pad_length = pad_length.saturating_sub(2);
+                    }
+                    format.push('%');
+                    if pad_length > 0 {
+                        if pad_char == b'0' {
+                            format.push('0');
+                        }
+                        format.push_str(&pad_length.to_string());
+                    }
+                    format.push(if upper_case { 'X' } else { 'x' });
                     exprs.push(quote!( #arg ));
                 }
                 Piece::Str(_) => unreachable!(),
@@ -217,12 +234,115 @@ fn write(input: TokenStream, newline: bool) -> TokenStream {
         }
     }
 
+    if cfg!(feature = "interned") {
+        return write_interned(&format, &exprs, &dbgs, literal.span());
+    }
+
+    // `ll` args are passed as 64 bits, everything else as InvokeParam
+    let exprs = exprs
+        .iter()
+        .zip(c_labels(&format))
+        .map(|(expr, (wide, _))| {
+            if wide {
+                quote!( (#expr) as u64 )
+            } else {
+                quote!( #expr as InvokeParam )
+            }
+        })
+        .collect::<Vec<_>>();
+
     quote!(
         unsafe {
             use embedded_c_sdk_bind_hal::*;
             
             #(#dbgs )*
-            ll_invoke( INVOKE_ID_LOG_PRINT, concat!(#format, "\0").as_ptr() as *const _ as InvokeParam, #(#exprs as InvokeParam, )* )
+            ll_invoke( INVOKE_ID_LOG_PRINT, concat!(#format, "\0").as_ptr() as *const _ as InvokeParam, #(#exprs, )* )
+        }
+    )
+    .into()
+}
+
+/// Labels of a C format string in order, as (`ll` given, conversion char), `%%` is skipped.
+fn c_labels(format: &str) -> Vec<(bool, char)> {
+    let mut labels = vec![];
+
+    let chars = &mut format.chars().peekable();
+    while let Some(ch) = chars.next() {
+        if ch != '%' {
+            continue;
+        }
+        let mut longs = 0;
+        while let Some(flag) = chars.next_if(|c| matches!(c, '-' | '.' | 'l' | '0'..='9')) {
+            if flag == 'l' {
+                longs += 1;
+            }
+        }
+        match chars.next() {
+            Some('%') | None => {}
+            Some(lable) => labels.push((longs >= 2, lable)),
+        }
+    }
+
+    labels
+}
+
+/// The C format string goes into the `.csdk_log_str` section and never reaches the target flash,
+/// its address is the string ID. Only the ID and the raw args are sent, in one `print::LogFrame`.
+/// `exprs` is walked in step with the labels of `format`, one entry per label. The args are all
+/// evaluated before the frame is started, bound by a `match` so temporaries outlive the frame.
+fn write_interned(
+    format: &str,
+    exprs: &[proc_macro2::TokenStream],
+    dbgs: &[proc_macro2::TokenStream],
+    span: Span,
+) -> TokenStream {
+    let mut encs = vec![];
+    let mut args = vec![];
+    let mut names = vec![];
+    let mut exprs = exprs.iter();
+
+    for (i, (wide, lable)) in c_labels(format).into_iter().enumerate() {
+        let Some(arg) = exprs.next() else {
+            return parse::Error::new(span, "format string has more labels than arguments")
+                .to_compile_error()
+                .into();
+        };
+        let expr = mk_name_with_idx("arg", i);
+        args.push(quote!( (#arg) ));
+        names.push(expr.clone());
+        encs.push(match lable {
+            'd' | 'q' if wide => quote!( frame.int64((#expr) as i64); ),
+            'd' | 'q' => quote!( frame.int((#expr) as InvokeParam as i32); ),
+            'u' | 'x' | 'X' if wide => quote!( frame.uint64((#expr) as u64); ),
+            's' => quote!( frame.cstr((#expr) as *const u8); ),
+            'S' | 'y' | 'Y' => quote!(
+                let (ptr, len) = (#expr);
+                frame.bytes(ptr as usize as *const u8, len as usize);
+            ),
+            _ => quote!( frame.uint((#expr) as InvokeParam); ),
+        });
+    }
+
+    let mut bytes = format.as_bytes().to_vec();
+    bytes.push(0);
+    let len = bytes.len();
+    let lit = syn::LitByteStr::new(&bytes, span);
+
+    quote!(
+        unsafe {
+            use embedded_c_sdk_bind_hal::*;
+
+            #[link_section = ".csdk_log_str"]
+            static CSDK_LOG_STR: [u8; #len] = *#lit;
+
+            #(#dbgs )*
+            match (#(#args, )*) {
+                (#(#names, )*) => {
+                    let mut frame = print::LogFrame::new(core::ptr::addr_of!(CSDK_LOG_STR) as usize as u32);
+                    #(#encs )*
+                    frame.end();
+                }
+            }
         }
     )
     .into()
@@ -314,6 +434,7 @@ impl Parse for Input {
 #[derive(Debug, PartialEq)]
 enum PCT {
     Int,
+    Int64,
     Ch,
     Str,
     Hex,
@@ -323,14 +444,16 @@ enum PCT {
 #[derive(Debug, PartialEq)]
 enum Piece<'a> {
     Debug,
-    Display,
+    Display {
+        spec: String, // C flags and width, e.g. `-5`, `08`
+    },
     Str(Cow<'a, str>),
     Percent(PCT),
     Hex {
         upper_case: bool,
-        // pad_char: u8,
-        // pad_length: usize,
-        // prefix: bool,
+        pad_char: u8,
+        pad_length: usize,
+        prefix: bool,
     },
 }
 
@@ -382,14 +505,23 @@ fn unescape(mut literal: &str, span: Span) -> parse::Result<Cow<str>> {
 fn parse_c_format(literal: &str, span: Span) -> parse::Result<Vec<Piece>> {
     let mut pieces = vec![];
 
-    let chars = &mut literal.chars();
+    let chars = &mut literal.chars().peekable();
     while let Some(ch) = chars.next() {
         if ch != '%' {
             continue;
         }
+        let mut longs = 0;
+        while let Some(flag) = chars.next_if(|c| matches!(c, '-' | '.' | 'l' | '0'..='9')) {
+            if flag == 'l' {
+                longs += 1;
+            }
+        }
         if let Some(lb) = chars.next() {
             match lb {
-                'd' => {
+                'd' | 'u' | 'q' | 'x' | 'X' if longs >= 2 => {
+                    pieces.push(Piece::Percent(PCT::Int64));
+                }
+                'd' | 'u' | 'q' => {
                     pieces.push(Piece::Percent(PCT::Int));
                 }
                 'c' => {
@@ -408,7 +540,7 @@ fn parse_c_format(literal: &str, span: Span) -> parse::Result<Vec<Piece>> {
                 _ => {
                     return Err(parse::Error::new(
                         span,
-                        "invalid format string: expected `%d`, `%c`, `%s/S`, `%x/X` or `%y`",
+                        "invalid format string: expected `%d`, `%u`, `%q`, `%c`, `%s/S`, `%x/X` or `%y`",
                     ));
                 }
             }
@@ -485,7 +617,9 @@ fn parse(mut literal: &str, span: Span) -> parse::Result<Vec<Piece>> {
                         pieces.push(piece);
                         literal = remainder;
                     } else {
-                        pieces.push(Piece::Display);
+                        pieces.push(Piece::Display {
+                            spec: String::new(),
+                        });
 
                         literal = &tail[DISPLAY.len()..];
                     }
@@ -527,18 +661,25 @@ fn split_number(src: &str) -> (&str, usize) {
 }
 
 /// parses the stuff after a `{:` into a [Piece] and the trailing `&str` (what comes after the `}`)
+///
+/// supported: `{:<5}`, `{:>5}`, `{:05}`, `{:x}`, `{:08X}`, `{:#010x}`, padding and width go to the C format
 fn parse_colon(format: &str, span: Span) -> parse::Result<(Piece, &str)> {
-    let (format, _prefix) = if let Some(tail) = format.strip_prefix('#') {
+    let (format, left) = if let Some(tail) = format.strip_prefix('<') {
+        (tail, true)
+    } else {
+        (format.strip_prefix('>').unwrap_or(format), false)
+    };
+    let (format, prefix) = if let Some(tail) = format.strip_prefix('#') {
         (tail, true)
     } else {
         (format, false)
     };
-    let (format, _pad_char) = if let Some(tail) = format.strip_prefix('0') {
+    let (format, pad_char) = if let Some(tail) = format.strip_prefix('0') {
         (tail, b'0')
     } else {
         (format, b' ')
     };
-    let (format, _pad_length) = if !format.is_empty()
+    let (format, pad_length) = if !format.is_empty()
         && if let Some(ch) = format.chars().next() {
             ch.is_ascii_digit()
         } else {
@@ -552,9 +693,9 @@ fn parse_colon(format: &str, span: Span) -> parse::Result<(Piece, &str)> {
         Ok((
             Piece::Hex {
                 upper_case: false,
-                // pad_char,
-                // pad_length,
-                // prefix,
+                pad_char,
+                pad_length,
+                prefix,
             },
             tail,
         ))
@@ -562,16 +703,27 @@ fn parse_colon(format: &str, span: Span) -> parse::Result<(Piece, &str)> {
         Ok((
             Piece::Hex {
                 upper_case: true,
-                // pad_char,
-                // pad_length,
-                // prefix,
+                pad_char,
+                pad_length,
+                prefix,
             },
             tail,
         ))
+    } else if let (Some(tail), false) = (format.strip_prefix('}'), prefix) {
+        let mut spec = String::new();
+        if left {
+            spec.push('-');
+        } else if pad_char == b'0' {
+            spec.push('0');
+        }
+        if pad_length > 0 {
+            spec.push_str(&pad_length.to_string());
+        }
+        Ok((Piece::Display { spec }, tail))
     } else {
         Err(parse::Error::new(
             span,
-            "invalid format string: expected `{{`, `{}`, `{:?}`, `{:#?}` or '{:x}'",
+            "invalid format string: expected `{{`, `{}`, `{:?}`, `{:#?}`, '{:x}' or '{:<width}'",
         ))
     }
 }
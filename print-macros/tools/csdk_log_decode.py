@@ -0,0 +1,192 @@
+# Decode print!/println! output of the print-log-interned feature.
+#
+# usage: python csdk_log_decode.py app.elf < /dev/ttyUSB0
+#        (set the port to raw first, e.g. stty -F /dev/ttyUSB0 115200 raw)
+#
+# Frames are SLIP framed: END id args.. END, id is the address of the format string in
+# the .csdk_log_str section of the ELF, ints are LEB128 varints (%d zigzag first),
+# %s/%S/%y args are a varint length followed by the bytes.
+import struct
+import sys
+
+SLIP_END = 0xC0
+SLIP_ESC = 0xDB
+SLIP_ESC_END = 0xDC
+SLIP_ESC_ESC = 0xDD
+
+SECTION = '.csdk_log_str'
+
+
+def load_strings(path):
+    with open(path, 'rb') as f:
+        elf = f.read()
+    if elf[:4] != b'\x7fELF':
+        sys.exit(f'{path}: not an ELF file')
+    is64 = elf[4] == 2
+    endian = '<' if elf[5] == 1 else '>'
+    if is64:
+        shoff, = struct.unpack_from(endian + 'Q', elf, 0x28)
+        shentsize, shnum, shstrndx = struct.unpack_from(endian + 'HHH', elf, 0x3A)
+        sh_fmt = endian + 'IIQQQQ'
+    else:
+        shoff, = struct.unpack_from(endian + 'I', elf, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from(endian + 'HHH', elf, 0x2E)
+        sh_fmt = endian + 'IIIIII'
+
+    sections = []
+    for i in range(shnum):
+        name, _type, _flags, addr, offset, size = struct.unpack_from(sh_fmt, elf, shoff + i * shentsize)
+        sections.append((name, addr, offset, size))
+    names_off = sections[shstrndx][2]
+
+    strings = {}
+    for name, addr, offset, size in sections:
+        end = elf.index(b'\0', names_off + name)
+        if elf[names_off + name:end].decode() != SECTION:
+            continue
+        data = elf[offset:offset + size]
+        pos = 0
+        while pos < len(data):
+            end = data.find(b'\0', pos)
+            if end < 0:
+                end = len(data)
+            strings[addr + pos] = data[pos:end].decode('utf-8', 'replace')
+            pos = end + 1
+    if not strings:
+        sys.exit(f'{path}: no {SECTION} section, build with the print-log-interned feature')
+    return strings
+
+
+class Args:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def uint(self):
+        val = 0
+        shift = 0
+        while True:
+            byte = self.data[self.pos]
+            self.pos += 1
+            val |= (byte & 0x7F) << shift
+            shift += 7
+            if byte < 0x80:
+                return val
+
+    def int(self):
+        val = self.uint()
+        return (val >> 1) ^ -(val & 1)
+
+    def bytes(self):
+        size = self.uint()
+        if self.pos + size > len(self.data):
+            raise IndexError
+        val = self.data[self.pos:self.pos + size]
+        self.pos += size
+        return val
+
+
+def pad(text, flags, width, sign=''):
+    fill = width - len(sign) - len(text)
+    if '-' in flags:
+        return sign + text + ' ' * fill
+    if '0' in flags:
+        return sign + '0' * fill + text
+    return ' ' * fill + sign + text
+
+
+def expand(fmt, args):
+    out = []
+    i = 0
+    while i < len(fmt):
+        ch = fmt[i]
+        i += 1
+        if ch != '%':
+            out.append(ch)
+            continue
+        flags = ''
+        while i < len(fmt) and fmt[i] in '-0':
+            flags += fmt[i]
+            i += 1
+        width = 0
+        while i < len(fmt) and fmt[i].isdigit():
+            width = width * 10 + int(fmt[i])
+            i += 1
+        prec = 0
+        if i < len(fmt) and fmt[i] == '.':
+            i += 1
+            while i < len(fmt) and fmt[i].isdigit():
+                prec = prec * 10 + int(fmt[i])
+                i += 1
+        while i < len(fmt) and fmt[i] == 'l':
+            i += 1
+        if i >= len(fmt):
+            break
+        ch = fmt[i]
+        i += 1
+        if ch in 'dq':
+            val = args.int()
+            text = str(abs(val))
+            if ch == 'q' and prec:
+                text = text.rjust(prec + 1, '0')
+                text = text[:-prec] + '.' + text[-prec:]
+            out.append(pad(text, flags, width, '-' if val < 0 else ''))
+        elif ch == 'u':
+            out.append(pad(str(args.uint()), flags, width))
+        elif ch == 'x':
+            out.append(pad(f'{args.uint():x}', flags, width))
+        elif ch == 'X':
+            out.append(pad(f'{args.uint():X}', flags, width))
+        elif ch == 'c':
+            out.append(pad(chr(args.uint()), flags.replace('0', ''), width))
+        elif ch in 'sS':
+            out.append(pad(args.bytes().decode('utf-8', 'replace'), flags.replace('0', ''), width))
+        elif ch in 'yY':
+            out.append(''.join(f'{b:02X} ' for b in args.bytes()))
+        else:
+            out.append(ch)
+    return ''.join(out)
+
+
+def decode(frame, strings):
+    args = Args(frame)
+    try:
+        str_id = args.uint()
+        fmt = strings.get(str_id)
+        if fmt is None:
+            return f'<unknown string id 0x{str_id:X}>\n'
+        return expand(fmt, args)
+    except IndexError:
+        return '<truncated frame>\n'
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit('usage: csdk_log_decode.py app.elf < log_port')
+    strings = load_strings(sys.argv[1])
+
+    frame = bytearray()
+    esc = False
+    stream = sys.stdin.buffer
+    while True:
+        data = stream.read(1)
+        if not data:
+            break
+        byte = data[0]
+        if byte == SLIP_END:
+            if frame:
+                sys.stdout.write(decode(bytes(frame), strings))
+                sys.stdout.flush()
+                frame.clear()
+            esc = False
+        elif esc:
+            frame.append(SLIP_END if byte == SLIP_ESC_END else SLIP_ESC if byte == SLIP_ESC_ESC else byte)
+            esc = False
+        elif byte == SLIP_ESC:
+            esc = True
+        else:
+            frame.append(byte)
+
+
+if __name__ == '__main__':
+    main()